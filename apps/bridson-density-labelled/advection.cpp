@@ -1,10 +1,20 @@
 #include "advection.hpp"
 
+#include "util/memory.hpp"
+
 Advection::Advection(Grid& q, Grid& u, Grid& v, LabelGrid& label)
-    : mQ(q), mU(u), mV(v), mLabel(label), mBack(q) {
+    : mTag(memory::Tag::Advection),
+      mQ(q),
+      mU(u),
+      mV(v),
+      mLabel(label),
+      mBack(q) {
+    mTag.end();
 }
 
 void Advection::operator()(const f64 dt) {
+    const memory::TagScope tag(memory::Tag::Advection);
+
     // Page 32.
     for (i32 j = 0; j < mQ.ny(); ++j) {
         for (i32 i = 0; i < mQ.nx(); ++i) {
@@ -2,6 +2,7 @@
 
 #include "grid.hpp"
 #include "label_grid.hpp"
+#include "util/memory.hpp"
 
 class Advection {
 public:
@@ -16,6 +17,10 @@ public:
     void swap();
 
 private:
+    /// @brief Tags the allocations of the members below while they are
+    /// built.
+    memory::TagScope mTag;
+
     Grid& mQ;
     Grid& mU;
     Grid& mV;
@@ -13,6 +13,7 @@ Config Config::loadFromJson(const std::string& path) {
     config.timestep = config_file["timestep"];
     config.density = config_file["density"];
     config.saveFrames = config_file["save_frames"];
+    config.cflBand = config_file.value("cfl_band", false);
 
     return config;
 }
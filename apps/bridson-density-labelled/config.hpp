@@ -9,6 +9,7 @@ struct Config {
     f64 timestep;
     f64 density;
     bool saveFrames;
+    bool cflBand;
 
     static Config loadFromJson(const std::string& path);
 };
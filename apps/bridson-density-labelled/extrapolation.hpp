@@ -1,7 +1,11 @@
 #pragma once
 
+#include <limits>
+#include <vector>
+
 #include "grid.hpp"
 #include "label_grid.hpp"
+#include "util/memory.hpp"
 
 class Extrapolation {
 public:
@@ -12,22 +16,46 @@ public:
     /// @brief Fully extrapolates the grid into empty cells.
     void operator()(const LabelGrid& label);
 
-    /// @brief Extrapolates the grid `n` times.
+    /// @brief Extrapolates the grid `n` layers into empty cells.
     void operator()(const u32 n, const LabelGrid& label);
 
 private:
-    enum class Result {
-        Updated = 0,
-        FixedPoint
+    /// @brief Layer count used for a full extrapolation.
+    static constexpr u32 cUnbounded = std::numeric_limits<u32>::max();
+
+    struct Cell {
+        i32 i;
+        i32 j;
     };
 
-    /// @brief Performs a single extrapolation step.
-    Result step();
+    /// @brief Extrapolates outward from the near-fluid cells one layer at a
+    /// time. Each layer is a wavefront queued from the previous one, so only
+    /// cells within `max_depth` layers of the fluid are visited.
+    void extrapolate(const LabelGrid& label, const u32 max_depth);
 
-    Grid& mQ;
+    /// @brief Sets every empty cell to zero before the first layer.
+    void clearEmpty();
+
+    /// @brief Queues cell (i, j) if it is empty and not already queued.
+    void enqueue(const i32 i, const i32 j);
+
+    /// @brief Averages the near-fluid neighbours of cell (i, j) into the grid.
+    void average(const i32 i, const i32 j);
 
-    Grid mBack;
+    /// @brief Tags the allocations of the members below while they are
+    /// built.
+    memory::TagScope mTag;
+
+    Grid& mQ;
 
     LabelGrid mLabel;
-    LabelGrid mLabelBack;
+
+    /// @brief Initial wavefront. Empty cells with a near-fluid neighbour.
+    CellMask mFrontier;
+
+    /// @brief Queued cells, one layer after the other.
+    std::vector<Cell> mCells;
+
+    /// @brief Marks the cells in mCells so they are only queued once.
+    std::vector<u8, memory::Allocator<u8>> mQueued;
 };
@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "math/numeric.hpp"
+#include "util/memory.hpp"
 
 namespace {
 
@@ -18,60 +19,76 @@ f64 cerp_clamped(
 Grid::Grid(const i32 rows,
            const i32 cols,
            const Vector2D& cell_center,
-           const f64 cell_size)
+           const f64 cell_size,
+           const i32 ghost)
     : mNx(cols),
       mNy(rows),
+      mGhost(ghost),
+      mStride(cols + 2 * ghost),
       mCellCenter(cell_center.clamped(0.0, 1.0)),
       mCellSize(cell_size) {
     assertm(mNy > 0, "number of rows must be positive");
     assertm(mNx > 0, "number of cols must be positive");
+    assertm(mGhost >= 0, "number of ghost layers must be non-negative");
     assertm(mCellSize > 0.0, "cell size must be positive");
 
-    mData = new f64[mNx * mNy];
+    mData = memory::allocate<f64>(paddedCount());
 }
 
 Grid::Grid(const Grid& other)
     : mNx(other.mNx),
       mNy(other.mNy),
+      mGhost(other.mGhost),
+      mStride(other.mStride),
       mCellCenter(other.mCellCenter),
       mCellSize(other.mCellSize),
-      mData(new f64[other.mNx * other.mNy]) {
-    std::copy(other.mData, other.mData + (mNx * mNy), mData);
+      mData(memory::allocate<f64>(other.paddedCount())) {
+    std::copy(other.mData, other.mData + paddedCount(), mData);
 }
 
 Grid& Grid::operator=(const Grid& other) {
+    if (this == &other)
+        return *this;
+
+    // Keep the buffer when the padded size matches, so repeated copies of a
+    // grid, such as solver snapshots, do not allocate.
+    if (paddedCount() != other.paddedCount()) {
+        memory::release(mData);
+        mData = memory::allocate<f64>(other.paddedCount());
+    }
+
     mNx = other.mNx;
     mNy = other.mNy;
+    mGhost = other.mGhost;
+    mStride = other.mStride;
     mCellCenter = other.mCellCenter;
     mCellSize = other.mCellSize;
 
-    delete[] mData;
-    mData = new f64[mNx * mNy];
-    std::copy(other.mData, other.mData + (mNx * mNy), mData);
+    std::copy(other.mData, other.mData + paddedCount(), mData);
 
     return *this;
 }
 
 Grid::~Grid() {
-    delete[] mData;
+    memory::release(mData);
 }
 
 f64 Grid::operator()(const i32 i, const i32 j) const {
-    assertm(i >= 0, "i out of bounds");
-    assertm(i < mNx, "i out of bounds");
-    assertm(j >= 0, "j out of bounds");
-    assertm(j < mNy, "j out of bounds");
+    assertm(i >= -mGhost, "i out of bounds");
+    assertm(i < mNx + mGhost, "i out of bounds");
+    assertm(j >= -mGhost, "j out of bounds");
+    assertm(j < mNy + mGhost, "j out of bounds");
 
-    return mData[j * mNx + i];
+    return mData[offset(i, j)];
 }
 
 f64& Grid::operator()(const i32 i, const i32 j) {
-    assertm(i >= 0, "i out of bounds");
-    assertm(i < mNx, "i out of bounds");
-    assertm(j >= 0, "j out of bounds");
-    assertm(j < mNy, "j out of bounds");
+    assertm(i >= -mGhost, "i out of bounds");
+    assertm(i < mNx + mGhost, "i out of bounds");
+    assertm(j >= -mGhost, "j out of bounds");
+    assertm(j < mNy + mGhost, "j out of bounds");
 
-    return mData[j * mNx + i];
+    return mData[offset(i, j)];
 }
 
 i32 Grid::nx() const {
@@ -86,6 +103,10 @@ i32 Grid::cellCount() const {
     return mNx * mNy;
 }
 
+i32 Grid::ghost() const {
+    return mGhost;
+}
+
 f64 Grid::cellSize() const {
     return mCellSize;
 }
@@ -98,6 +119,13 @@ f64* Grid::data() {
     return mData;
 }
 
+const f64* Grid::row(const i32 j) const {
+    assertm(j >= -mGhost, "j out of bounds");
+    assertm(j < mNy + mGhost, "j out of bounds");
+
+    return mData + offset(0, j);
+}
+
 Vector2D Grid::toGridSpace(const Vector2D& world_pos) const {
     return world_pos / mCellSize - mCellCenter;
 }
@@ -111,7 +139,43 @@ f64 Grid::interp(const Vector2D& grid_pos) const {
 }
 
 void Grid::fill(const f64 value) {
-    std::fill_n(mData, mNy * mNx, value);
+    std::fill_n(mData, paddedCount(), value);
+}
+
+void Grid::fillGhosts(const Boundary boundary) {
+    if (mGhost == 0)
+        return;
+
+    switch (boundary) {
+    case Boundary::Neumann:
+        // Columns first, then whole padded rows, so the corners pick up the
+        // nearest interior corner value.
+        for (i32 j = 0; j < mNy; ++j) {
+            f64* row = mData + offset(0, j);
+            std::fill_n(row - mGhost, mGhost, row[0]);
+            std::fill_n(row + mNx, mGhost, row[mNx - 1]);
+        }
+        for (i32 g = 1; g <= mGhost; ++g) {
+            std::copy_n(mData + offset(-mGhost, 0),
+                        mStride,
+                        mData + offset(-mGhost, -g));
+            std::copy_n(mData + offset(-mGhost, mNy - 1),
+                        mStride,
+                        mData + offset(-mGhost, mNy - 1 + g));
+        }
+        break;
+    case Boundary::Zero:
+        for (i32 j = 0; j < mNy; ++j) {
+            f64* row = mData + offset(0, j);
+            std::fill_n(row - mGhost, mGhost, 0.0);
+            std::fill_n(row + mNx, mGhost, 0.0);
+        }
+        std::fill_n(mData, mGhost * mStride, 0.0);
+        std::fill_n(mData + offset(-mGhost, mNy), mGhost * mStride, 0.0);
+        break;
+    default:
+        unreachable;
+    }
 }
 
 void Grid::add(const Vector2D& world_pos,
@@ -147,11 +211,21 @@ void Grid::add(const Vector2D& world_pos,
 }
 
 f64 Grid::max() const {
-    return *std::max_element(mData, mData + cellCount());
+    f64 result = (*this)(0, 0);
+    for (i32 j = 0; j < mNy; ++j) {
+        const f64* row = mData + offset(0, j);
+        result = std::max(result, *std::max_element(row, row + mNx));
+    }
+    return result;
 }
 
 f64 Grid::min() const {
-    return *std::min_element(mData, mData + cellCount());
+    f64 result = (*this)(0, 0);
+    for (i32 j = 0; j < mNy; ++j) {
+        const f64* row = mData + offset(0, j);
+        result = std::min(result, *std::min_element(row, row + mNx));
+    }
+    return result;
 }
 
 Vector2D Grid::clampToGrid(const Vector2D& grid_pos) const {
@@ -217,3 +291,11 @@ f64 Grid::width() const {
 f64 Grid::height() const {
     return static_cast<f64>(mNy) * mCellSize;
 }
+
+i32 Grid::offset(const i32 i, const i32 j) const {
+    return (j + mGhost) * mStride + (i + mGhost);
+}
+
+i32 Grid::paddedCount() const {
+    return mStride * (mNy + 2 * mGhost);
+}
@@ -4,12 +4,26 @@
 #include "util/common.hpp"
 #include "util/format.hpp"
 
+/// @brief Boundary condition used to fill the ghost layer of a grid.
+enum class Boundary {
+    /// @brief Ghost cells copy the nearest interior cell (zero normal
+    /// derivative).
+    Neumann = 0,
+    /// @brief Ghost cells are set to zero.
+    Zero
+};
+
 class Grid {
 public:
+    /// @brief Constructs a grid with `ghost` layers of padding cells around
+    /// the interior. Ghost cells are addressable with indices in
+    /// [-ghost, nx + ghost) and [-ghost, ny + ghost), which lets stencils read
+    /// neighbours at the boundary without bounds checks.
     Grid(const i32 nx,
          const i32 ny,
          const Vector2D& cell_center,
-         const f64 cell_size);
+         const f64 cell_size,
+         const i32 ghost = 0);
 
     Grid(const Grid& other);
 
@@ -32,15 +46,23 @@ public:
     /// @brief Number of cells in the grid. Equal to nx() * ny().
     i32 cellCount() const;
 
+    /// @brief Number of ghost layers around the interior.
+    i32 ghost() const;
+
     /// @brief Size of a cell in world space.
     f64 cellSize() const;
 
     /// @brief Center of a cell normalized to [0, 1].
     Vector2D cellCenter() const;
 
-    /// @brief Retrieve a pointer to the internal buffer.
+    /// @brief Retrieve a pointer to the internal buffer, including the ghost
+    /// layer.
     f64* data();
 
+    /// @brief Retrieve a pointer to the first interior value of row `j`. The
+    /// row is contiguous, with nx() values.
+    const f64* row(const i32 j) const;
+
     /// @brief Converts a worldspace position to a normalized gridspace
     /// position.
     Vector2D toGridSpace(const Vector2D& world_pos) const;
@@ -61,6 +83,11 @@ public:
     /// @param value Fill value.
     void fill(const f64 value);
 
+    /// @brief Fills the ghost layer from the interior according to the
+    /// boundary condition.
+    /// @param boundary Boundary condition.
+    void fillGhosts(const Boundary boundary);
+
     /// @brief Add a constant value to a rectangular region in the grid.
     /// @param world_pos Position of the region.
     /// @param size Size of the region.
@@ -92,19 +119,31 @@ private:
     /// @brief Height of the grid in world space. Equal to ny() * cellSize().
     f64 height() const;
 
+    /// @brief Offset of cell (i, j) in the padded buffer.
+    i32 offset(const i32 i, const i32 j) const;
+
+    /// @brief Number of cells in the padded buffer.
+    i32 paddedCount() const;
+
     /// @brief Number of columns in the grid.
     i32 mNx;
 
     /// @brief Number of rows in the grid.
     i32 mNy;
 
+    /// @brief Number of ghost layers around the interior.
+    i32 mGhost;
+
+    /// @brief Row stride of the padded buffer. Equal to nx() + 2 * ghost().
+    i32 mStride;
+
     /// @brief Normalized (on [0, 1]) coordinates of the cell center.
     Vector2D mCellCenter;
 
     /// @brief Size of a cell.
     f64 mCellSize;
 
-    /// @brief Grid data.
+    /// @brief Grid data, including the ghost layer.
     f64* mData;
 };
 
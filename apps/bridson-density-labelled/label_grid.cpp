@@ -1,65 +1,128 @@
 #include "label_grid.hpp"
 
-#include <algorithm>
-
-LabelGrid::LabelGrid(const i32 nx, const i32 ny) : mNx(nx), mNy(ny) {
+LabelGrid::LabelGrid(const i32 nx, const i32 ny, const i32 ghost)
+    : mNx(nx),
+      mNy(ny),
+      mGhost(ghost),
+      mStride(nx + 2 * ghost),
+      mRowWords((nx + 2 * ghost + cWordBits - 1) / cWordBits),
+      mRows(ny + 2 * ghost),
+      mColumns(mRowWords, 0),
+      mInterior(mRowWords, 0),
+      mFluid(static_cast<Size>(mRows) * mRowWords, 0),
+      mExtrapolated(static_cast<Size>(mRows) * mRowWords, 0),
+      mSolid(static_cast<Size>(mRows) * mRowWords, 0) {
     assertm(mNy > 0, "number of rows must be positive");
     assertm(mNx > 0, "number of cols must be positive");
+    assertm(mGhost > 0, "number of ghost layers must be positive");
+
+    for (i32 c = 0; c < mStride; ++c) {
+        mColumns[c / cWordBits] |= u64(1) << (c % cWordBits);
+        if (c >= mGhost && c < mGhost + mNx)
+            mInterior[c / cWordBits] |= u64(1) << (c % cWordBits);
+    }
 
-    mData = new Label[mNx * mNy];
+    // Slack bits are permanently solid.
+    for (i32 r = 0; r < mRows; ++r) {
+        for (i32 w = 0; w < mRowWords; ++w)
+            mSolid[static_cast<Index>(r) * mRowWords + w] = ~mColumns[w];
+    }
+
+    fillGhosts(Label::Solid);
 }
 
-LabelGrid::LabelGrid(const LabelGrid& other)
-    : mNx(other.mNx), mNy(other.mNy), mData(new Label[other.mNx * other.mNy]) {
-    std::copy(other.mData, other.mData + (mNx * mNy), mData);
+Label LabelGrid::operator()(const i32 i, const i32 j) const {
+    const Index w = word(i, j);
+    const u64 b = bit(i, j);
+
+    // The planes are disjoint, so the set bits combine into the label value.
+    const u32 fluid = (mFluid[w] & b) != 0;
+    const u32 extrapolated = (mExtrapolated[w] & b) != 0;
+    const u32 solid = (mSolid[w] & b) != 0;
+    return static_cast<Label>(fluid | (extrapolated << 1) | (solid * 3));
 }
 
-LabelGrid& LabelGrid::operator=(const LabelGrid& other) {
-    mNx = other.mNx;
-    mNy = other.mNy;
+void LabelGrid::set(const i32 i, const i32 j, const Label label) {
+    assertm(i >= -mGhost, "i out of bounds");
+    assertm(i < mNx + mGhost, "i out of bounds");
+    assertm(j >= -mGhost, "j out of bounds");
+    assertm(j < mNy + mGhost, "j out of bounds");
 
-    delete[] mData;
-    mData = new Label[mNx * mNy];
-    std::copy(other.mData, other.mData + (mNx * mNy), mData);
+    const Index w = word(i, j);
+    const u64 b = bit(i, j);
 
-    return *this;
-}
+    mFluid[w] &= ~b;
+    mExtrapolated[w] &= ~b;
+    mSolid[w] &= ~b;
 
-Label LabelGrid::operator()(const i32 i, const i32 j) const {
-    if (0 <= i && i < mNx && 0 <= j && j < mNy) {
-        return mData[j * mNx + i];
-    } else {
-        return Label::Solid;
+    switch (label) {
+    case Label::Empty:
+        break;
+    case Label::Fluid:
+        mFluid[w] |= b;
+        break;
+    case Label::Extrapolated:
+        mExtrapolated[w] |= b;
+        break;
+    case Label::Solid:
+        mSolid[w] |= b;
+        break;
+    default:
+        unreachable;
     }
 }
 
-void LabelGrid::set(const i32 i, const i32 j, const Label label) {
-    assertm(i >= 0, "i out of bounds");
-    assertm(i < mNx, "i out of bounds");
-    assertm(j >= 0, "j out of bounds");
-    assertm(j < mNy, "j out of bounds");
+void LabelGrid::set(const CellMask& mask, const Label label) {
+    assertm(mask.size() == mFluid.size(), "mask dimensions must match");
 
-    mData[j * mNx + i] = label;
+    CellMask* plane = nullptr;
+    switch (label) {
+    case Label::Empty:
+        break;
+    case Label::Fluid:
+        plane = &mFluid;
+        break;
+    case Label::Extrapolated:
+        plane = &mExtrapolated;
+        break;
+    case Label::Solid:
+        plane = &mSolid;
+        break;
+    default:
+        unreachable;
+    }
+
+    for (Index w = 0; w < mask.size(); ++w) {
+        mFluid[w] &= ~mask[w];
+        mExtrapolated[w] &= ~mask[w];
+        mSolid[w] &= ~mask[w];
+    }
+
+    if (plane != nullptr) {
+        for (Index w = 0; w < mask.size(); ++w) (*plane)[w] |= mask[w];
+    }
 }
 
 bool LabelGrid::isEmpty(const i32 i, const i32 j) const {
-    return (*this)(i, j) == Label::Empty;
+    const Index w = word(i, j);
+    return ((mFluid[w] | mExtrapolated[w] | mSolid[w]) & bit(i, j)) == 0;
 }
 
 bool LabelGrid::isFluid(const i32 i, const i32 j) const {
-    return (*this)(i, j) == Label::Fluid;
+    return (mFluid[word(i, j)] & bit(i, j)) != 0;
 }
 
 bool LabelGrid::isExtrapolated(const i32 i, const i32 j) const {
-    return (*this)(i, j) == Label::Extrapolated;
+    return (mExtrapolated[word(i, j)] & bit(i, j)) != 0;
 }
 
 bool LabelGrid::isSolid(const i32 i, const i32 j) const {
-    return (*this)(i, j) == Label::Solid;
+    return (mSolid[word(i, j)] & bit(i, j)) != 0;
 }
 
 bool LabelGrid::isNearFluid(const i32 i, const i32 j) const {
-    return isFluid(i, j) || isExtrapolated(i, j);
+    const Index w = word(i, j);
+    return ((mFluid[w] | mExtrapolated[w]) & bit(i, j)) != 0;
 }
 
 i32 LabelGrid::nx() const {
@@ -74,12 +137,42 @@ i32 LabelGrid::cellCount() const {
     return mNx * mNy;
 }
 
-Label* LabelGrid::data() {
-    return mData;
+i32 LabelGrid::ghost() const {
+    return mGhost;
+}
+
+i32 LabelGrid::count(const Label label) const {
+    i32 result = 0;
+    for (i32 r = mGhost; r < mGhost + mNy; ++r) {
+        for (i32 w = 0; w < mRowWords; ++w) {
+            const u64 bits =
+                labelWord(label, static_cast<Index>(r) * mRowWords + w);
+            result += std::popcount(bits & mInterior[w]);
+        }
+    }
+    return result;
 }
 
 void LabelGrid::fill(const Label label) {
-    std::fill_n(mData, mNy * mNx, label);
+    CellMask interior(mFluid.size(), 0);
+    for (i32 r = mGhost; r < mGhost + mNy; ++r) {
+        std::copy(mInterior.begin(),
+                  mInterior.end(),
+                  interior.begin() + static_cast<Index>(r) * mRowWords);
+    }
+    set(interior, label);
+}
+
+void LabelGrid::fillGhosts(const Label label) {
+    CellMask ghosts(mFluid.size(), 0);
+    for (i32 r = 0; r < mRows; ++r) {
+        const bool ghost_row = r < mGhost || r >= mGhost + mNy;
+        for (i32 w = 0; w < mRowWords; ++w) {
+            ghosts[static_cast<Index>(r) * mRowWords + w] =
+                ghost_row ? mColumns[w] : mColumns[w] & ~mInterior[w];
+        }
+    }
+    set(ghosts, label);
 }
 
 void LabelGrid::setSolidBorder() {
@@ -95,10 +188,71 @@ void LabelGrid::setSolidBorder() {
 }
 
 void LabelGrid::reset() {
-    for (i32 j = 0; j < mNy; ++j) {
-        for (i32 i = 0; i < mNx; ++i) {
-            if (isNearFluid(i, j))
-                set(i, j, Label::Empty);
+    for (i32 r = mGhost; r < mGhost + mNy; ++r) {
+        for (i32 w = 0; w < mRowWords; ++w) {
+            const Index index = static_cast<Index>(r) * mRowWords + w;
+            mFluid[index] &= ~mInterior[w];
+            mExtrapolated[index] &= ~mInterior[w];
         }
     }
 }
+
+void LabelGrid::mask(const Label label, CellMask& dst) const {
+    dst.resize(mFluid.size());
+    for (Index w = 0; w < dst.size(); ++w) dst[w] = labelWord(label, w);
+}
+
+void LabelGrid::frontier(CellMask& dst) const {
+    dst.assign(mFluid.size(), 0);
+
+    // The outermost rows are ghost rows, which always have a row on each side
+    // once they are skipped.
+    for (i32 r = 1; r < mRows - 1; ++r) {
+        for (i32 w = 0; w < mRowWords; ++w) {
+            const Index index = static_cast<Index>(r) * mRowWords + w;
+
+            const u64 near = mFluid[index] | mExtrapolated[index];
+            const u64 prev =
+                w > 0 ? mFluid[index - 1] | mExtrapolated[index - 1] : 0;
+            const u64 next = w < mRowWords - 1
+                                 ? mFluid[index + 1] | mExtrapolated[index + 1]
+                                 : 0;
+            const u64 below = mFluid[index - mRowWords] |
+                              mExtrapolated[index - mRowWords];
+            const u64 above = mFluid[index + mRowWords] |
+                              mExtrapolated[index + mRowWords];
+
+            // Shift the near-fluid bits onto their left and right neighbours,
+            // carrying across word boundaries.
+            const u64 horizontal = (near << 1) | (prev >> (cWordBits - 1)) |
+                                   (near >> 1) | (next << (cWordBits - 1));
+
+            dst[index] = (horizontal | below | above) & labelWord(Label::Empty,
+                                                                  index);
+        }
+    }
+}
+
+Index LabelGrid::word(const i32 i, const i32 j) const {
+    return static_cast<Index>(j + mGhost) * mRowWords +
+           (i + mGhost) / cWordBits;
+}
+
+u64 LabelGrid::bit(const i32 i, const i32 j) const {
+    return u64(1) << ((i + mGhost) % cWordBits);
+}
+
+u64 LabelGrid::labelWord(const Label label, const Index w) const {
+    switch (label) {
+    case Label::Empty:
+        return ~(mFluid[w] | mExtrapolated[w] | mSolid[w]);
+    case Label::Fluid:
+        return mFluid[w];
+    case Label::Extrapolated:
+        return mExtrapolated[w];
+    case Label::Solid:
+        return mSolid[w];
+    default:
+        unreachable;
+    }
+}
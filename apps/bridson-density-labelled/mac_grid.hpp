@@ -40,6 +40,14 @@ public:
     /// @brief Updates cell labels.
     void updateLabels();
 
+    /// @brief Number of cell layers the fluid can cross in `dt` at the current
+    /// maximum velocity, plus a margin for the interpolation stencil. Velocity
+    /// extrapolated this far covers every semi-Lagrangian lookup.
+    u32 extrapolationDepth(const f64 dt) const;
+
+    /// @brief Largest magnitude of a velocity component.
+    f64 maxSpeed() const;
+
 private:
     /// @brief Width of the MAC grid in world space. Equal to nx() * cellSize().
     f32 width() const;
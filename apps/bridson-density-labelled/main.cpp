@@ -1,10 +1,21 @@
 #include "bridson_density_labelled.hpp"
 
-int main() {
-    BridsonDensityLabelled::launch<BridsonDensityLabelled>(
-        800,
-        600,
-        "Labelled density solver (Bridson)",
-        60.0f,
-        "apps/bridson-density-labelled");
+int main(int argc, char** argv) {
+    const RunOptions options = RunOptions::parse(argc, argv);
+    Application::startServices(options);
+
+    if (options.headless.enabled) {
+        BridsonDensityLabelled::runHeadless(options.headless,
+                                            "apps/bridson-density-labelled");
+    } else {
+        BridsonDensityLabelled::launch<BridsonDensityLabelled>(
+            800,
+            600,
+            "Labelled density solver (Bridson)",
+            60.0f,
+            "apps/bridson-density-labelled",
+            options);
+    }
+
+    Application::finishServices();
 }
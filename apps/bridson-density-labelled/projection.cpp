@@ -3,9 +3,12 @@
 #include <algorithm>
 
 #include "util/log.hpp"
+#include "util/memory.hpp"
+#include "util/profiler.hpp"
 
 Projection::Projection(MACGrid& mac)
-    : mMac(mac),
+    : mTag(memory::Tag::Projection),
+      mMac(mac),
       mDiv(mMac.cellCount()),
       mAdiag(mMac.cellCount()),
       mAx(mMac.cellCount()),
@@ -15,10 +18,15 @@ Projection::Projection(MACGrid& mac)
       mPressure(mMac.cellCount()),
       mAux(mMac.cellCount()),
       mSearch(mMac.cellCount()),
-      mPreconditioner(mMac.cellCount()) {
+      mPreconditioner(mMac.cellCount()),
+      mIterations(0),
+      mResidual(0.0) {
+    mTag.end();
 }
 
 void Projection::operator()(const f64 dt, const f64 density) {
+    const memory::TagScope tag(memory::Tag::Projection);
+
     // In general, projection subtracts the pressure gradient from the advected
     // velocity field with external forces applied and enforces the velocity
     // field to be divergence-free. Following Bridson, it also enforces
@@ -35,50 +43,54 @@ void Projection::operator()(const f64 dt, const f64 density) {
     mMac.p.fill(0.0);
 
     // Populate pressure grid with pressure solutions.
-    for (i32 j = 0; j < mMac.ny(); ++j) {
-        for (i32 i = 0; i < mMac.nx(); ++i) {
-            if (mMac.label.isFluid(i, j)) {
-                const Index index = mFluidIndices[j * mMac.nx() + i];
-                mMac.p(i, j) = mPressure[index];
-            }
-        }
-    }
+    mMac.label.forEach(Label::Fluid, [&](const i32 i, const i32 j) {
+        const Index index = mFluidIndices[j * mMac.nx() + i];
+        mMac.p(i, j) = mPressure[index];
+    });
 
     applyPressureUpdate(dt, density);
 }
 
+Size Projection::iterations() const {
+    return mIterations;
+}
+
+f64 Projection::residual() const {
+    return mResidual;
+}
+
+Size Projection::fluidCount() const {
+    return static_cast<Size>(mFluidCount);
+}
+
 void Projection::indexFluidCells() {
     mFluidCount = 0;
     std::fill(mFluidIndices.begin(), mFluidIndices.end(), -1);
-    for (i32 j = 0; j < mMac.ny(); ++j) {
-        for (i32 i = 0; i < mMac.nx(); ++i) {
-            if (mMac.label.isFluid(i, j)) {
-                const Index index = j * mMac.nx() + i;
-                mFluidIndices[index] = mFluidCount;
-                ++mFluidCount;
-            }
-        }
-    }
+
+    // Fluid cells are visited in row-major order, so the indices match a scan
+    // over the whole grid.
+    mMac.label.forEach(Label::Fluid, [&](const i32 i, const i32 j) {
+        mFluidIndices[j * mMac.nx() + i] = mFluidCount;
+        ++mFluidCount;
+    });
 }
 
 void Projection::buildDivergences() {
+    PROFILE_SCOPE("divergence");
+
     const f64 scale = 1.0 / mMac.cellSize();
 
     mDiv.resize(mFluidCount);
     mDiv.fill(0.0);
 
     // Page 72, Figure 5.3.
-    for (i32 j = 0; j < mMac.ny(); ++j) {
-        for (i32 i = 0; i < mMac.nx(); ++i) {
-            if (mMac.label.isFluid(i, j)) {
-                // Equation 5.4
-                const Index index = mFluidIndices[j * mMac.nx() + i];
+    mMac.label.forEach(Label::Fluid, [&](const i32 i, const i32 j) {
+        // Equation 5.4
+        const Index index = mFluidIndices[j * mMac.nx() + i];
 
-                mDiv[index] = -scale * (mMac.u(i + 1, j) - mMac.u(i, j) +
-                                        mMac.v(i, j + 1) - mMac.v(i, j));
-            }
-        }
-    }
+        mDiv[index] = -scale * (mMac.u(i + 1, j) - mMac.u(i, j) +
+                                mMac.v(i, j + 1) - mMac.v(i, j));
+    });
 
     // Page 76, Figure 5.4.
     for (i32 j = 0; j < mMac.ny(); ++j) {
@@ -105,6 +117,8 @@ void Projection::buildDivergences() {
 }
 
 void Projection::buildPressureMatrix(const f64 dt, const f64 density) {
+    PROFILE_SCOPE("pressure matrix");
+
     // Page 78, Figure 5.5.
 
     const f64 scale = dt / (density * mMac.cellSize() * mMac.cellSize());
@@ -152,6 +166,8 @@ void Projection::buildPressureMatrix(const f64 dt, const f64 density) {
 }
 
 void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
+    PROFILE_SCOPE("cg");
+
     buildPreconditioner(tuning, safety);
 
     mPressure.resize(mFluidCount);
@@ -160,6 +176,7 @@ void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
 
     // Initial guess of zeros.
     mPressure.fill(0.0);
+    mIterations = 0;
 
     // Tolerance for early return.
     const f64 tol = 1e-5;
@@ -167,12 +184,16 @@ void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
     applyPreconditioner(mAux, mDiv);
     mSearch = mAux;
 
-    if (mDiv.infinityNorm() < tol)
+    mResidual = mDiv.infinityNorm();
+    if (mResidual < tol)
         return;
 
     f64 sigma = dot(mAux, mDiv);
 
     for (i32 iter = 0; iter < cNumberOfCGIterations; ++iter) {
+        PROFILE_SCOPE("cg iteration");
+
+        mIterations = iter + 1;
         applyA(mAux, mSearch);
 
         const f64 alpha = sigma / dot(mAux, mSearch);
@@ -180,7 +201,8 @@ void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
         mPressure = mPressure + alpha * mSearch;
         mDiv = mDiv + -alpha * mAux;
 
-        if (mDiv.infinityNorm() < tol) {
+        mResidual = mDiv.infinityNorm();
+        if (mResidual < tol) {
             Log::d("CG solved after {} iterations", iter);
             return;
         }
@@ -198,6 +220,8 @@ void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
 }
 
 void Projection::applyPressureUpdate(const f64 dt, const f64 density) {
+    PROFILE_SCOPE("pressure update");
+
     // Based on page 71, Figure 5.2.
 
     const f64 scale = dt / (density * mMac.cellSize());
@@ -227,6 +251,8 @@ void Projection::applyPressureUpdate(const f64 dt, const f64 density) {
 }
 
 void Projection::buildPreconditioner(const f64 tuning, const f64 safety) {
+    PROFILE_SCOPE("preconditioner");
+
     // Page 87, Figure 5.7.
     // `tuning` is referred to as tau, and `safety` is referred to as sigma.
 
@@ -240,7 +266,7 @@ void Projection::buildPreconditioner(const f64 tuning, const f64 safety) {
 
                 f64 e = mAdiag[index];
 
-                if (i > 0) {
+                if (mMac.label.isFluid(i - 1, j)) {
                     const Index prev = mFluidIndices[j * mMac.nx() + (i - 1)];
 
                     const f64 x = mAx[prev] * mPreconditioner[prev];
@@ -249,7 +275,7 @@ void Projection::buildPreconditioner(const f64 tuning, const f64 safety) {
                     e = e - (x * x) - tuning * (x * y);
                 }
 
-                if (j > 0) {
+                if (mMac.label.isFluid(i, j - 1)) {
                     const Index prev = mFluidIndices[(j - 1) * mMac.nx() + i];
 
                     const f64 x = mAx[prev] * mPreconditioner[prev];
@@ -279,14 +305,14 @@ void Projection::applyPreconditioner(VectorXD& dst, const VectorXD& a) {
 
                 f64 t = a[index];
 
-                // Enforce solid-wall boundaries at the edges of the
-                // viewport
-                if (i > 0 && mMac.label.isFluid(i - 1, j)) {
+                // Solid-wall boundaries at the edges of the viewport are
+                // enforced by the solid label ghost layer.
+                if (mMac.label.isFluid(i - 1, j)) {
                     const Index prev = mFluidIndices[j * mMac.nx() + (i - 1)];
                     t -= mAx[prev] * mPreconditioner[prev] * dst[prev];
                 }
 
-                if (j > 0 && mMac.label.isFluid(i, j - 1)) {
+                if (mMac.label.isFluid(i, j - 1)) {
                     const Index prev = mFluidIndices[(j - 1) * mMac.nx() + i];
                     t -= mAy[prev] * mPreconditioner[prev] * dst[prev];
                 }
@@ -304,14 +330,14 @@ void Projection::applyPreconditioner(VectorXD& dst, const VectorXD& a) {
 
                 f64 t = dst[index];
 
-                // Enforce solid-wall boundaries at the edges of the
-                // viewport.
-                if (i < mMac.nx() - 1 && mMac.label.isFluid(i + 1, j)) {
+                // Solid-wall boundaries at the edges of the viewport are
+                // enforced by the solid label ghost layer.
+                if (mMac.label.isFluid(i + 1, j)) {
                     const Index next = mFluidIndices[j * mMac.nx() + (i + 1)];
                     t -= mAx[index] * mPreconditioner[index] * dst[next];
                 }
 
-                if (j < mMac.ny() - 1 && mMac.label.isFluid(i, j + 1)) {
+                if (mMac.label.isFluid(i, j + 1)) {
                     const Index next = mFluidIndices[(j + 1) * mMac.nx() + i];
                     t -= mAy[index] * mPreconditioner[index] * dst[next];
                 }
@@ -323,35 +349,31 @@ void Projection::applyPreconditioner(VectorXD& dst, const VectorXD& a) {
 }
 
 void Projection::applyA(VectorXD& dst, const VectorXD& b) {
-    for (i32 j = 0; j < mMac.ny(); ++j) {
-        for (i32 i = 0; i < mMac.nx(); ++i) {
-            if (mMac.label.isFluid(i, j)) {
-                const Index index = mFluidIndices[j * mMac.nx() + i];
+    mMac.label.forEach(Label::Fluid, [&](const i32 i, const i32 j) {
+        const Index index = mFluidIndices[j * mMac.nx() + i];
 
-                f64 t = mAdiag[index] * b[index];
+        f64 t = mAdiag[index] * b[index];
 
-                if (i > 0 && mMac.label.isFluid(i - 1, j)) {
-                    const Index prev = mFluidIndices[j * mMac.nx() + (i - 1)];
-                    t += mAx[prev] * b[prev];
-                }
-
-                if (j > 0 && mMac.label.isFluid(i, j - 1)) {
-                    const Index prev = mFluidIndices[(j - 1) * mMac.nx() + i];
-                    t += mAy[prev] * b[prev];
-                }
+        if (mMac.label.isFluid(i - 1, j)) {
+            const Index prev = mFluidIndices[j * mMac.nx() + (i - 1)];
+            t += mAx[prev] * b[prev];
+        }
 
-                if (i < mMac.nx() - 1 && mMac.label.isFluid(i + 1, j)) {
-                    const Index next = mFluidIndices[j * mMac.nx() + (i + 1)];
-                    t += mAx[index] * b[next];
-                }
+        if (mMac.label.isFluid(i, j - 1)) {
+            const Index prev = mFluidIndices[(j - 1) * mMac.nx() + i];
+            t += mAy[prev] * b[prev];
+        }
 
-                if (j < mMac.ny() - 1 && mMac.label.isFluid(i, j + 1)) {
-                    const Index next = mFluidIndices[(j + 1) * mMac.nx() + i];
-                    t += mAy[index] * b[next];
-                }
+        if (mMac.label.isFluid(i + 1, j)) {
+            const Index next = mFluidIndices[j * mMac.nx() + (i + 1)];
+            t += mAx[index] * b[next];
+        }
 
-                dst[index] = t;
-            }
+        if (mMac.label.isFluid(i, j + 1)) {
+            const Index next = mFluidIndices[(j + 1) * mMac.nx() + i];
+            t += mAy[index] * b[next];
         }
-    }
+
+        dst[index] = t;
+    });
 }
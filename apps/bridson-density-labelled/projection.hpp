@@ -3,6 +3,7 @@
 #include "grid.hpp"
 #include "mac_grid.hpp"
 #include "math/vectorx.hpp"
+#include "util/memory.hpp"
 
 class Projection {
 public:
@@ -11,7 +12,20 @@ public:
     // Projects using Conjugate Gradient with a Cholesky preconditioner.
     void operator()(const f64 dt, const f64 density);
 
+    /// @brief Number of CG iterations taken by the last projection.
+    Size iterations() const;
+
+    /// @brief Infinity norm of the residual the last projection ended at.
+    f64 residual() const;
+
+    /// @brief Number of fluid cells the last projection solved for.
+    Size fluidCount() const;
+
 private:
+    /// @brief Tags the allocations of the members below while they are
+    /// built.
+    memory::TagScope mTag;
+
     const Size cNumberOfCGIterations = 1000;
 
     /// @brief MAC grid. Projection acts on the pressure component.
@@ -28,7 +42,7 @@ private:
     std::vector<f64> mAy;
 
     /// @brief Fluid cell indices for sparse grid access.
-    std::vector<f64> mFluidIndices;
+    std::vector<i32> mFluidIndices;
     i32 mFluidCount;
 
     /// @brief Pressure solution vector.
@@ -43,6 +57,12 @@ private:
     /// @brief Preconditioner.
     VectorXD mPreconditioner;
 
+    /// @brief CG iterations taken by the last solve.
+    Size mIterations;
+
+    /// @brief Residual infinity norm the last solve ended at.
+    f64 mResidual;
+
     /// @brief Associates an index with every fluid cell.
     void indexFluidCells();
 
@@ -1,8 +1,12 @@
 #include "solver.hpp"
 
+#include "util/metrics.hpp"
+#include "util/profiler.hpp"
+
 Solver::Solver(const Config& config)
     : mMac(config.rows, config.cols, config.cellSize),
       mTimestep(config.timestep),
+      mCflBand(config.cflBand),
       mDensity(config.density),
       mExtrapolateU(mMac.u, mMac.label),
       mExtrapolateV(mMac.v, mMac.label),
@@ -13,13 +17,27 @@ Solver::Solver(const Config& config)
 }
 
 void Solver::step() {
+    PROFILE_SCOPE("step");
+
     // See Page 20.
 
     // 1. Advect density and velocity
-    mMac.updateLabels();
-
-    mExtrapolateU(mMac.label);
-    mExtrapolateV(mMac.label);
+    {
+        PROFILE_SCOPE("labels");
+        mMac.updateLabels();
+    }
+
+    {
+        PROFILE_SCOPE("extrapolate");
+        if (mCflBand) {
+            const u32 depth = mMac.extrapolationDepth(mTimestep);
+            mExtrapolateU(depth, mMac.label);
+            mExtrapolateV(depth, mMac.label);
+        } else {
+            mExtrapolateU(mMac.label);
+            mExtrapolateV(mMac.label);
+        }
+    }
 
     advect();
 
@@ -27,11 +45,17 @@ void Solver::step() {
 
     addForces();
 
-    mMac.updateLabels();
+    {
+        PROFILE_SCOPE("labels");
+        mMac.updateLabels();
+    }
 
     // 3. Project the pressure to make the velocity field divergence free.
 
     project();
+
+    if (Metrics::enabled())
+        publishMetrics();
 }
 
 const Grid& Solver::density() const {
@@ -50,11 +74,29 @@ const Grid& Solver::v() const {
     return mMac.v;
 }
 
+Size Solver::cgIterations() const {
+    return mProject.iterations();
+}
+
+void Solver::publishMetrics() const {
+    const f64 speed = mMac.maxSpeed();
+
+    Metrics::StepSample sample;
+    sample.cgIterations = mProject.iterations();
+    sample.cgResidual = mProject.residual();
+    sample.fluidCells = mProject.fluidCount();
+    sample.maxVelocity = speed;
+    sample.cfl = speed * mTimestep / mMac.cellSize();
+    Metrics::step(sample);
+}
+
 const LabelGrid& Solver::label() const {
     return mMac.label;
 }
 
 void Solver::advect() {
+    PROFILE_SCOPE("advect");
+
     mAdvectDensity(mTimestep);
     mAdvectDensity.swap();
 
@@ -66,6 +108,8 @@ void Solver::advect() {
 }
 
 void Solver::addForces() {
+    PROFILE_SCOPE("forces");
+
     const Vector2D pos(0.45, 0.2);
     const Vector2D size(0.1, 0.01);
     const float d = 1.0;
@@ -77,5 +121,7 @@ void Solver::addForces() {
 }
 
 void Solver::project() {
+    PROFILE_SCOPE("project");
+
     mProject(mTimestep, mDensity);
 }
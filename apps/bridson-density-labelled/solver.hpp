@@ -28,6 +28,9 @@ public:
     /// @brief Retrieve a constant reference to the velocity v component grid.
     const Grid& v() const;
 
+    /// @brief Number of CG iterations taken by the last pressure solve.
+    Size cgIterations() const;
+
     /// @brief Retrieve a constant reference to the label grid.
     const LabelGrid& label() const;
 
@@ -42,12 +45,18 @@ private:
     /// divergence free and enforces solid wall boundary conditions.
     void project();
 
+    /// @brief Publishes the state after a step to the metrics exporter.
+    void publishMetrics() const;
+
     /// @brief MAC grid used by this solver.
     MACGrid mMac;
 
     /// @brief Timestep that the solver is advanced by each step.
     f64 mTimestep;
 
+    /// @brief Whether velocity extrapolation stops at the CFL band.
+    bool mCflBand;
+
     /// @brief Fluid density.
     f64 mDensity;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "grid.hpp"
+#include "util/memory.hpp"
 
 class Advection {
 public:
@@ -15,6 +16,10 @@ public:
     void swap();
 
 private:
+    /// @brief Tags the allocations of the members below while they are
+    /// built.
+    memory::TagScope mTag;
+
     Grid& mQ;
     Grid& mU;
     Grid& mV;
@@ -1,16 +1,44 @@
 #include "bridson_density.hpp"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb_image_write.h>
-
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
 
+#include "io/field_recorder.hpp"
 #include "quad.hpp"
 #include "util/files.hpp"
 #include "util/log.hpp"
+#include "util/memory.hpp"
+
+namespace {
 
-BridsonLiquid::BridsonLiquid() : mUpdateOnce(false), mUpdateContinuous(false) {
+/// @brief Uploads the interior of a grid to the texture.
+void upload(FieldTexture& texture, const Grid& q) {
+    f32* texels = texture.map();
+    if (texels == nullptr)
+        return;
+
+    for (i32 j = 0; j < q.ny(); ++j)
+        std::copy_n(q.row(j), q.nx(), texels + static_cast<Index>(j) * q.nx());
+    texture.unmap();
+}
+
+/// @brief Uploads `count` row-major values to the texture.
+void upload(FieldTexture& texture, const f64* values, const Size count) {
+    f32* texels = texture.map();
+    if (texels == nullptr)
+        return;
+
+    std::copy_n(values, count, texels);
+    texture.unmap();
+}
+
+}
+
+BridsonLiquid::BridsonLiquid(const RunOptions& options)
+    : mOptions(options),
+      mFrameCounter(0),
+      mUpdateOnce(false),
+      mUpdateContinuous(false),
+      mRefresh(true) {
 }
 
 void BridsonLiquid::init() {
@@ -19,6 +47,21 @@ void BridsonLiquid::init() {
     // Load config.
     mConfig = Config::loadFromJson(asset("config.json"));
 
+    // A replay draws a cached run, at the size of the cache, in place of the
+    // solver.
+    if (!mOptions.replayPath.empty()) {
+        mReplay = std::make_unique<FieldReplay>(
+            mOptions.replayPath, "d", mOptions.replayFps);
+        if (mReplay->isOpen()) {
+            mConfig.rows = mReplay->ny();
+            mConfig.cols = mReplay->nx();
+        } else {
+            Log::e("Could not replay {}, running the solver",
+                   mOptions.replayPath);
+            mReplay.reset();
+        }
+    }
+
     // Create shader program.
     std::string vertex_shader =
         files::read_to_string(asset("shaders/shader.vs").c_str());
@@ -46,109 +89,263 @@ void BridsonLiquid::init() {
 
     mQuadMesh = Quad();
 
-    mTexData.resize(mConfig.rows * mConfig.cols * 3);
+    // The density is uploaded as is and coloured by the shader.
+    mTexture.allocate(static_cast<u32>(mConfig.cols),
+                      static_cast<u32>(mConfig.rows));
     mProgram.setUniform<i32>("sampler", 0);
 
-    // Initialize the solver.
+    if (mReplay)
+        return;
+
+    // Initialize the solver and hand it to its own thread.
     mSolver = std::make_unique<Solver>(mConfig);
-}
+    if (mConfig.saveFrames) {
+        mEncoder = std::make_unique<FrameEncoder>(
+            root() + "/frames", mConfig.cols, mConfig.rows);
+    }
 
-void BridsonLiquid::update() {
-    if (mUpdateOnce || mUpdateContinuous)
-        mSolver->step();
+    {
+        // The snapshot buffers hold what is drawn, so they count as rendering.
+        const memory::TagScope tag(memory::Tag::Rendering);
+        mSimulation = std::make_unique<SimulationThread<Command, Snapshot>>(
+            Snapshot{mSolver->density(), 0});
+    }
+    mSimulation->start(
+        [this](const Command command) { handle(command); },
+        [this](Snapshot& snapshot) { return step(snapshot); });
 }
 
 void BridsonLiquid::draw() {
-    for (Index row = 0; row < mConfig.rows; ++row) {
-        for (Index col = 0; col < mConfig.cols; ++col) {
-            const f64 d = mSolver->density()(static_cast<i32>(col),
-                                             static_cast<i32>(row));
-
-            const GLubyte b =
-                static_cast<GLubyte>(math::clamp(d, 0.0, 1.0) * 255.0);
-
-            const Index i = row * mConfig.cols + col;
-            mTexData[i * 3] = 0;
-            mTexData[i * 3 + 1] = b;
-            mTexData[i * 3 + 2] = 0;
+    if (mReplay) {
+        if (const f64* values = mReplay->update()) {
+            const Size count = static_cast<Size>(mReplay->nx()) * mReplay->ny();
+            upload(mTexture, values, count);
         }
+    } else if (mSimulation->update()) {
+        upload(mTexture, mSimulation->snapshot().density);
     }
 
-    mTexture.image(mConfig.rows, mConfig.cols, mTexData.data());
     mTexture.bind(0);
 
     mQuadMesh.render();
+}
+
+void BridsonLiquid::cleanup() {
+    if (mSimulation)
+        mSimulation->stop();
+}
+
+void BridsonLiquid::onKeyPress(int key, int action, int mods) {
+    if (mReplay) {
+        onReplayKey(key, action, mods);
+        return;
+    }
 
-    if (mUpdateOnce || mUpdateContinuous) {
-        Log::i("Frame {}", mFrameCounter);
-        if (mConfig.saveFrames)
-            saveCurrentFrame();
+    if (action != GLFW_PRESS)
+        return;
 
-        ++mFrameCounter;
-        mUpdateOnce = false;
+    Command command;
+    switch (key) {
+    case GLFW_KEY_Q:
+        quit();
+        return;
+    case GLFW_KEY_SPACE:
+        command = Command::ToggleContinuous;
+        break;
+    case GLFW_KEY_N:
+        command = Command::Step;
+        break;
+    case GLFW_KEY_R:
+        command = Command::Reset;
+        break;
+    case GLFW_KEY_D:
+        command = Command::PrintDensity;
+        break;
+    case GLFW_KEY_P:
+        command = Command::PrintPressure;
+        break;
+    case GLFW_KEY_U:
+        command = Command::PrintU;
+        break;
+    case GLFW_KEY_V:
+        command = Command::PrintV;
+        break;
+    default:
+        return;
     }
+
+    if (!mSimulation->send(command))
+        Log::w("Solver busy, dropping key press");
 }
 
-void BridsonLiquid::onKeyPress(int key, int action, int mods) {
-    if (action == GLFW_PRESS) {
-        switch (key) {
-        case GLFW_KEY_Q:
-            quit();
-            break;
-        case GLFW_KEY_SPACE:
-            mUpdateContinuous = !mUpdateContinuous;
-            break;
-        case GLFW_KEY_N:
-            mUpdateOnce = true;
-            break;
-        case GLFW_KEY_R:
-            mSolver = std::make_unique<Solver>(mConfig);
-            break;
-        case GLFW_KEY_D:
-            // Print density.
-            println("DENSITY\n{}", mSolver->density());
-            break;
-        case GLFW_KEY_P:
-            // Print pressure.
-            println("PRESSURE\n{}", mSolver->pressure());
-            break;
-        case GLFW_KEY_U:
-            // Print velocity u component.
-            println("U\n{}", mSolver->u());
-            break;
-        case GLFW_KEY_V:
-            // Print velocity v component.
-            println("V\n{}", mSolver->v());
-            break;
-        default:
-            break;
-        }
+void BridsonLiquid::onReplayKey(int key, int action, int mods) {
+    // Scrubbing follows key repeats, so holding an arrow key moves through
+    // the run.
+    const bool scrub = key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT;
+    if (action != GLFW_PRESS && !(scrub && action == GLFW_REPEAT))
+        return;
+
+    const i64 stride = (mods & GLFW_MOD_SHIFT) ? 10 : 1;
+    switch (key) {
+    case GLFW_KEY_Q:
+        quit();
+        return;
+    case GLFW_KEY_SPACE:
+        mReplay->togglePlaying();
+        return;
+    case GLFW_KEY_L:
+        mReplay->toggleLoop();
+        return;
+    case GLFW_KEY_N:
+        mReplay->scrub(1);
+        break;
+    case GLFW_KEY_R:
+        mReplay->seek(0);
+        break;
+    case GLFW_KEY_LEFT:
+        mReplay->scrub(-stride);
+        break;
+    case GLFW_KEY_RIGHT:
+        mReplay->scrub(stride);
+        break;
+    default:
+        return;
     }
+
+    Log::i("Frame {} of {} (step {})",
+           mReplay->position(),
+           mReplay->frameCount(),
+           mReplay->step());
 }
 
 void BridsonLiquid::onFramebufferResize(const u32 width, const u32 height) {
     glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
 }
 
-void BridsonLiquid::saveCurrentFrame() const {
-    if (mTexData.empty()) {
-        Log::f("mTextData empty");
-        return;
+void BridsonLiquid::handle(const Command command) {
+    switch (command) {
+    case Command::Step:
+        mUpdateOnce = true;
+        break;
+    case Command::ToggleContinuous:
+        mUpdateContinuous = !mUpdateContinuous;
+        break;
+    case Command::Reset:
+        mSolver = std::make_unique<Solver>(mConfig);
+        mRefresh = true;
+        break;
+    case Command::PrintDensity:
+        println("DENSITY\n{}", mSolver->density());
+        break;
+    case Command::PrintPressure:
+        println("PRESSURE\n{}", mSolver->pressure());
+        break;
+    case Command::PrintU:
+        println("U\n{}", mSolver->u());
+        break;
+    case Command::PrintV:
+        println("V\n{}", mSolver->v());
+        break;
+    default:
+        unreachable;
+    }
+}
+
+bool BridsonLiquid::step(Snapshot& snapshot) {
+    if (!mUpdateOnce && !mUpdateContinuous) {
+        if (!mRefresh)
+            return false;
+
+        // Publish the reset state without stepping.
+        snapshot.density = mSolver->density();
+        snapshot.frame = mFrameCounter;
+        mRefresh = false;
+        return true;
+    }
+
+    mSolver->step();
+
+    snapshot.density = mSolver->density();
+    snapshot.frame = mFrameCounter;
+
+    Log::i("Frame {}", mFrameCounter);
+    if (mConfig.saveFrames)
+        saveFrame(snapshot);
+
+    ++mFrameCounter;
+    mUpdateOnce = false;
+    mRefresh = false;
+    return true;
+}
+
+void BridsonLiquid::saveFrame(const Snapshot& snapshot) {
+    FrameEncoder::Frame& frame = mEncoder->acquire();
+    fillFrame(snapshot.density, frame.rgb);
+    frame.index = snapshot.frame;
+    mEncoder->submit(frame);
+}
+
+void BridsonLiquid::runHeadless(const HeadlessOptions& options,
+                                const std::string& root) {
+    Config config = Config::loadFromJson(root + "/assets/config.json");
+    if (options.gridSize > 0) {
+        config.rows = options.gridSize;
+        config.cols = options.gridSize;
+        config.cellSize = 1.0 / config.rows;
+    }
+
+    Solver solver(config);
+
+    FieldRecorder cache(options.cachePath, options.cacheErrorBound);
+    cache.addGrid("u", solver.u());
+    cache.addGrid("v", solver.v());
+    cache.addGrid("p", solver.pressure());
+    cache.addGrid("d", solver.density());
+    cache.open(static_cast<i32>(config.cols),
+               static_cast<i32>(config.rows),
+               config.cellSize);
+
+    const auto record = [&](const u32 step) { cache.record(step); };
+
+    u64 cg_iterations = 0;
+    const f64 seconds = Headless::run(
+        options,
+        root,
+        config.cols,
+        config.rows,
+        [&]() {
+            solver.step();
+            cg_iterations += solver.cgIterations();
+        },
+        [&](std::vector<u8>& rgb) { fillFrame(solver.density(), rgb); },
+        record);
+
+    // The solver runs on the calling thread only.
+    Headless::writeSummary(options,
+                           RunSummary{"BridsonDensity",
+                                      options.threads,
+                                      1,
+                                      static_cast<u32>(config.cols),
+                                      static_cast<u32>(config.rows),
+                                      options.steps,
+                                      seconds,
+                                      cg_iterations});
+}
+
+void BridsonLiquid::fillFrame(const Grid& density, std::vector<u8>& rgb) {
+    for (i32 row = 0; row < density.ny(); ++row) {
+        const Index offset = static_cast<Index>(row) * density.nx() * 3;
+        fillRow(density.row(row), density.nx(), rgb.data() + offset);
     }
+}
 
-    std::ostringstream filenameStream;
-    filenameStream << "Frame_" << std::setw(5) << std::setfill('0')
-                   << mFrameCounter << ".png";
-    const std::string filename = filenameStream.str();
-    const std::string path = root() + "/frames/" + filename;
-
-    const int error = stbi_write_png(path.c_str(),
-                                     static_cast<int>(mConfig.cols),
-                                     static_cast<int>(mConfig.rows),
-                                     3,
-                                     mTexData.data(),
-                                     static_cast<int>(mConfig.cols * 3));
-
-    if (!error)
-        Log::f("Failed to save the current frame");
+void BridsonLiquid::fillRow(const f64* density, const i32 count, u8* rgb) {
+    for (i32 col = 0; col < count; ++col) {
+        const f64 d = math::clamp(density[col], 0.0, 1.0);
+        const u8 b = static_cast<u8>(d * 255.0);
+
+        rgb[col * 3] = 0;
+        rgb[col * 3 + 1] = b;
+        rgb[col * 3 + 2] = 0;
+    }
 }
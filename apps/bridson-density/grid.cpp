@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "math/numeric.hpp"
+#include "util/memory.hpp"
 
 namespace {
 
@@ -27,7 +28,7 @@ Grid::Grid(const i32 rows,
     assertm(mNx > 0, "number of cols must be positive");
     assertm(mCellSize > 0.0, "cell size must be positive");
 
-    mData = new f64[mNx * mNy];
+    mData = memory::allocate<f64>(mNx * mNy);
 }
 
 Grid::Grid(const Grid& other)
@@ -35,25 +36,33 @@ Grid::Grid(const Grid& other)
       mNy(other.mNy),
       mCellCenter(other.mCellCenter),
       mCellSize(other.mCellSize),
-      mData(new f64[other.mNx * other.mNy]) {
+      mData(memory::allocate<f64>(other.mNx * other.mNy)) {
     std::copy(other.mData, other.mData + (mNx * mNy), mData);
 }
 
 Grid& Grid::operator=(const Grid& other) {
+    if (this == &other)
+        return *this;
+
+    // Keep the buffer when the size matches, so repeated copies of a grid,
+    // such as solver snapshots, do not allocate.
+    if (mNx * mNy != other.mNx * other.mNy) {
+        memory::release(mData);
+        mData = memory::allocate<f64>(other.mNx * other.mNy);
+    }
+
     mNx = other.mNx;
     mNy = other.mNy;
     mCellCenter = other.mCellCenter;
     mCellSize = other.mCellSize;
 
-    delete[] mData;
-    mData = new f64[mNx * mNy];
     std::copy(other.mData, other.mData + (mNx * mNy), mData);
 
     return *this;
 }
 
 Grid::~Grid() {
-    delete[] mData;
+    memory::release(mData);
 }
 
 f64 Grid::operator()(const i32 i, const i32 j) const {
@@ -98,6 +107,13 @@ f64* Grid::data() {
     return mData;
 }
 
+const f64* Grid::row(const i32 j) const {
+    assertm(j >= 0, "j out of bounds");
+    assertm(j < mNy, "j out of bounds");
+
+    return mData + j * mNx;
+}
+
 Vector2D Grid::toGridSpace(const Vector2D& world_pos) const {
     return world_pos / mCellSize - mCellCenter;
 }
@@ -41,6 +41,10 @@ public:
     /// @brief Retrieve a pointer to the internal buffer.
     f64* data();
 
+    /// @brief Retrieve a pointer to the first value of row `j`. The row is
+    /// contiguous, with nx() values.
+    const f64* row(const i32 j) const;
+
     /// @brief Converts a worldspace position to a normalized gridspace
     /// position.
     Vector2D toGridSpace(const Vector2D& world_pos) const;
@@ -1,5 +1,8 @@
 #include "mac_grid.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 MACGrid::MACGrid(const i32 rows, const i32 cols, const f64 cell_size)
     : u(rows, cols + 1, Vector2D(0.0, 0.5), cell_size),
       v(rows + 1, cols, Vector2D(0.5, 0.0), cell_size),
@@ -38,6 +41,13 @@ f64 MACGrid::height() const {
     return mNy * mCellSize;
 }
 
+f64 MACGrid::maxSpeed() const {
+    return std::max({std::abs(u.max()),
+                     std::abs(u.min()),
+                     std::abs(v.max()),
+                     std::abs(v.min())});
+}
+
 f64 MACGrid::cflTimestep() const {
     return u.cellSize() / std::max(u.max(), v.max());
 }
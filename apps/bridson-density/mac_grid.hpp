@@ -33,6 +33,9 @@ public:
     /// @brief Size of a cell in world space.
     f64 cellSize() const;
 
+    /// @brief Largest magnitude of a velocity component.
+    f64 maxSpeed() const;
+
 private:
     /// @brief Width of the MAC grid in world space. Equal to nx() * cellSize().
     f64 width() const;
@@ -1,9 +1,19 @@
 #include "bridson_density.hpp"
 
-int main() {
-    BridsonLiquid::launch<BridsonLiquid>(800,
-                                         600,
-                                         "Density fluid solver (Bridson)",
-                                         60.0f,
-                                         "apps/bridson-density");
+int main(int argc, char** argv) {
+    const RunOptions options = RunOptions::parse(argc, argv);
+    Application::startServices(options);
+
+    if (options.headless.enabled) {
+        BridsonLiquid::runHeadless(options.headless, "apps/bridson-density");
+    } else {
+        BridsonLiquid::launch<BridsonLiquid>(800,
+                                             600,
+                                             "Density fluid solver (Bridson)",
+                                             60.0f,
+                                             "apps/bridson-density",
+                                             options);
+    }
+
+    Application::finishServices();
 }
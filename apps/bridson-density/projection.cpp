@@ -3,9 +3,12 @@
 #include <algorithm>
 
 #include "util/log.hpp"
+#include "util/memory.hpp"
+#include "util/profiler.hpp"
 
 Projection::Projection(MACGrid& mac)
-    : mMac(mac),
+    : mTag(memory::Tag::Projection),
+      mMac(mac),
       mDiv(mac.cellCount()),
       mAdiag(mac.cellCount()),
       mAx(mac.cellCount()),
@@ -13,10 +16,15 @@ Projection::Projection(MACGrid& mac)
       mPressure(mac.cellCount()),
       mAux(mac.cellCount()),
       mSearch(mac.cellCount()),
-      mPreconditioner(mac.cellCount()) {
+      mPreconditioner(mac.cellCount()),
+      mIterations(0),
+      mResidual(0.0) {
+    mTag.end();
 }
 
 void Projection::operator()(const f64 dt, const f64 density) {
+    const memory::TagScope tag(memory::Tag::Projection);
+
     // In general, projection subtracts the pressure gradient from the advected
     // velocity field with external forces applied and enforces the velocity
     // field to be divergence-free. Following Bridson, it also enforces
@@ -40,7 +48,21 @@ void Projection::operator()(const f64 dt, const f64 density) {
     applyPressureUpdate(dt, density);
 }
 
+Size Projection::iterations() const {
+    return mIterations;
+}
+
+f64 Projection::residual() const {
+    return mResidual;
+}
+
+Size Projection::fluidCount() const {
+    return mMac.cellCount();
+}
+
 void Projection::buildDivergences() {
+    PROFILE_SCOPE("divergence");
+
     // Page 72, Figure 5.3.
 
     const f64 scale = 1.0 / mMac.cellSize();
@@ -56,6 +78,8 @@ void Projection::buildDivergences() {
 }
 
 void Projection::buildPressureMatrix(const f64 dt, const f64 density) {
+    PROFILE_SCOPE("pressure matrix");
+
     // Page 78, Figure 5.5.
 
     const f64 scale = dt / (density * mMac.cellSize() * mMac.cellSize());
@@ -85,10 +109,13 @@ void Projection::buildPressureMatrix(const f64 dt, const f64 density) {
 }
 
 void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
+    PROFILE_SCOPE("cg");
+
     buildPreconditioner(tuning, safety);
 
     // Initial guess of zeros.
     mPressure.fill(0.0);
+    mIterations = 0;
 
     // Tolerance for early return.
     const f64 tol = 1e-5;
@@ -96,12 +123,16 @@ void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
     applyPreconditioner(mAux, mDiv);
     mSearch = mAux;
 
-    if (mDiv.infinityNorm() < tol)
+    mResidual = mDiv.infinityNorm();
+    if (mResidual < tol)
         return;
 
     f64 sigma = dot(mAux, mDiv);
 
     for (i32 iter = 0; iter < cNumberOfCGIterations; ++iter) {
+        PROFILE_SCOPE("cg iteration");
+
+        mIterations = iter + 1;
         applyA(mAux, mSearch);
 
         const f64 alpha = sigma / dot(mAux, mSearch);
@@ -109,7 +140,8 @@ void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
         mPressure = mPressure + alpha * mSearch;
         mDiv = mDiv + -alpha * mAux;
 
-        if (mDiv.infinityNorm() < tol) {
+        mResidual = mDiv.infinityNorm();
+        if (mResidual < tol) {
             Log::d("CG solved after {} iterations", iter);
             return;
         }
@@ -127,6 +159,8 @@ void Projection::solvePressureEquation(const f64 tuning, const f64 safety) {
 }
 
 void Projection::applyPressureUpdate(const f64 dt, const f64 density) {
+    PROFILE_SCOPE("pressure update");
+
     // Based on page 71, Figure 5.2.
 
     const f64 scale = dt / (density * mMac.cellSize());
@@ -156,6 +190,8 @@ void Projection::applyPressureUpdate(const f64 dt, const f64 density) {
 }
 
 void Projection::buildPreconditioner(const f64 tuning, const f64 safety) {
+    PROFILE_SCOPE("preconditioner");
+
     // Page 87, Figure 5.7.
     // `tuning` is tau, `safety` is sigma.
 
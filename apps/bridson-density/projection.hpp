@@ -3,6 +3,7 @@
 #include "grid.hpp"
 #include "mac_grid.hpp"
 #include "math/vectorx.hpp"
+#include "util/memory.hpp"
 
 class Projection {
 public:
@@ -11,7 +12,20 @@ public:
     // Projects using Conjugate Gradient with a Cholesky preconditioner.
     void operator()(const f64 dt, const f64 density);
 
+    /// @brief Number of CG iterations taken by the last projection.
+    Size iterations() const;
+
+    /// @brief Infinity norm of the residual the last projection ended at.
+    f64 residual() const;
+
+    /// @brief Number of cells the last projection solved for.
+    Size fluidCount() const;
+
 private:
+    /// @brief Tags the allocations of the members below while they are
+    /// built.
+    memory::TagScope mTag;
+
     const Size cNumberOfCGIterations = 200;
 
     /// @brief MAC grid. Projection acts on the pressure component.
@@ -39,6 +53,12 @@ private:
     /// @brief Preconditioner.
     VectorXD mPreconditioner;
 
+    /// @brief CG iterations taken by the last solve.
+    Size mIterations;
+
+    /// @brief Residual infinity norm the last solve ended at.
+    f64 mResidual;
+
     /// @brief Builds the divergence vector (div).
     void buildDivergences();
 
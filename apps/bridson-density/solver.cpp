@@ -1,5 +1,8 @@
 #include "solver.hpp"
 
+#include "util/metrics.hpp"
+#include "util/profiler.hpp"
+
 Solver::Solver(const Config& config)
     : mMac(config.rows, config.cols, config.cellSize),
       mTimestep(config.timestep),
@@ -11,6 +14,8 @@ Solver::Solver(const Config& config)
 }
 
 void Solver::step() {
+    PROFILE_SCOPE("step");
+
     // See Page 20.
 
     // 1. Advect density and velocity.
@@ -21,6 +26,9 @@ void Solver::step() {
 
     // 3. Project the pressure to make the velocity field divergence free.
     project();
+
+    if (Metrics::enabled())
+        publishMetrics();
 }
 
 const Grid& Solver::density() const {
@@ -39,11 +47,31 @@ const Grid& Solver::v() const {
     return mMac.v;
 }
 
+Size Solver::cgIterations() const {
+    return mProject.iterations();
+}
+
+void Solver::publishMetrics() const {
+    const f64 speed = mMac.maxSpeed();
+
+    Metrics::StepSample sample;
+    sample.cgIterations = mProject.iterations();
+    sample.cgResidual = mProject.residual();
+    sample.fluidCells = mProject.fluidCount();
+    sample.maxVelocity = speed;
+    sample.cfl = speed * mTimestep / mMac.cellSize();
+    Metrics::step(sample);
+}
+
 void Solver::project() {
+    PROFILE_SCOPE("project");
+
     mProject(mTimestep, mDensity);
 }
 
 void Solver::advect() {
+    PROFILE_SCOPE("advect");
+
     mAdvectDensity(mTimestep);
     mAdvectDensity.swap();
 
@@ -55,6 +83,8 @@ void Solver::advect() {
 }
 
 void Solver::addForces() {
+    PROFILE_SCOPE("forces");
+
     const Vector2D pos(0.45, 0.2);
     const Vector2D size(0.1, 0.01);
     const float d = 1.0;
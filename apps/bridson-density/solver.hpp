@@ -27,6 +27,9 @@ public:
     /// @brief Retrieve a constant reference to the velocity v component grid.
     const Grid& v() const;
 
+    /// @brief Number of CG iterations taken by the last pressure solve.
+    Size cgIterations() const;
+
 private:
     /// @brief Advects density and velocity through the velocity grid.
     void advect();
@@ -38,6 +41,9 @@ private:
     /// divergence free and enforces solid wall boundary conditions.
     void project();
 
+    /// @brief Publishes the state after a step to the metrics exporter.
+    void publishMetrics() const;
+
     /// @brief MAC grid used by this solver.
     MACGrid mMac;
 
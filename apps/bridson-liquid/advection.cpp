@@ -1,10 +1,20 @@
 #include "advection.hpp"
 
+#include "util/memory.hpp"
+
 Advection::Advection(Grid& q, Grid& u, Grid& v, LabelGrid& label)
-    : mQ(q), mU(u), mV(v), mLabel(label), mBack(q) {
+    : mTag(memory::Tag::Advection),
+      mQ(q),
+      mU(u),
+      mV(v),
+      mLabel(label),
+      mBack(q) {
+    mTag.end();
 }
 
 void Advection::operator()(const f64 dt) {
+    const memory::TagScope tag(memory::Tag::Advection);
+
     // Page 32.
     for (i32 j = 0; j < mQ.ny(); ++j) {
         for (i32 i = 0; i < mQ.nx(); ++i) {
@@ -24,10 +34,28 @@ void Advection::operator()(const f64 dt) {
     }
 }
 
+void Advection::operator()(const f64 dt, const NarrowBand& band) {
+    const memory::TagScope tag(memory::Tag::Advection);
+
+    for (const auto [i, j] : band.cells()) {
+        if (mLabel.isSolid(i, j)) {
+            continue;
+        }
+
+        const Vector2D grid_pos = Vector2D(i, j) + mQ.cellCenter();
+        const Vector2D initial_pos = backtrace(grid_pos, dt);
+        mBack(i, j) = mQ.interp(initial_pos);
+    }
+}
+
 void Advection::swap() {
     std::swap(mQ, mBack);
 }
 
+void Advection::swap(const NarrowBand& band) {
+    for (const auto [i, j] : band.cells()) mQ(i, j) = mBack(i, j);
+}
+
 Vector2D Advection::backtrace(const Vector2D& grid_pos, const f64 dt) const {
     return RK3(grid_pos, dt);
 }
@@ -2,6 +2,8 @@
 
 #include "grid.hpp"
 #include "label_grid.hpp"
+#include "narrow_band.hpp"
+#include "util/memory.hpp"
 
 class Advection {
 public:
@@ -11,11 +13,22 @@ public:
     ///  for the given time step, producing a new grid.
     void operator()(const f64 dt);
 
+    /// @brief Advects only the cells of the narrow band. Lookups outside the
+    /// band read the clamped values there.
+    void operator()(const f64 dt, const NarrowBand& band);
+
     /// @brief Swaps the back buffer grid with mQ. This must be a separate
     /// operation to support self-advection.
     void swap();
 
+    /// @brief Copies the band cells of the back buffer into mQ.
+    void swap(const NarrowBand& band);
+
 private:
+    /// @brief Tags the allocations of the members below while they are
+    /// built.
+    memory::TagScope mTag;
+
     Grid& mQ;
     Grid& mU;
     Grid& mV;
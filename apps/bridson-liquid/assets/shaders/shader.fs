@@ -4,7 +4,10 @@ out vec4 FragColor;
 in vec2 TexCoord;
 
 uniform sampler2D sampler;
+uniform float threshold;
 
 void main() {
-    FragColor = texture(sampler, TexCoord, 1.0);
+    // Liquid cells, at or below the surface threshold, are white.
+    float s = texture(sampler, TexCoord, 1.0).r;
+    FragColor = vec4(vec3(s <= threshold ? 1.0 : 0.0), 1.0);
 }
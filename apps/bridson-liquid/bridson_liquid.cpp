@@ -1,24 +1,105 @@
 #include "bridson_liquid.hpp"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb_image_write.h>
-
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
 
+#include "io/field_recorder.hpp"
 #include "quad.hpp"
 #include "util/files.hpp"
 #include "util/log.hpp"
+#include "util/memory.hpp"
+
+namespace {
+
+/// @brief Uploads the interior of a grid to the texture.
+void upload(FieldTexture& texture, const Grid& q) {
+    f32* texels = texture.map();
+    if (texels == nullptr)
+        return;
+
+    for (i32 j = 0; j < q.ny(); ++j)
+        std::copy_n(q.row(j), q.nx(), texels + static_cast<Index>(j) * q.nx());
+    texture.unmap();
+}
+
+/// @brief Uploads `count` row-major values to the texture.
+void upload(FieldTexture& texture, const f64* values, const Size count) {
+    f32* texels = texture.map();
+    if (texels == nullptr)
+        return;
+
+    std::copy_n(values, count, texels);
+    texture.unmap();
+}
+
+/// @brief Creates the solver, restored from `resume_path` if it is set. The
+/// simulation parameters of the checkpoint then replace those in `config`.
+std::unique_ptr<Solver> createSolver(Config& config,
+                                     const std::string& resume_path) {
+    if (resume_path.empty())
+        return std::make_unique<Solver>(config);
+
+    Config resumed = config;
+    if (Solver::readConfig(resume_path, resumed)) {
+        std::unique_ptr<Solver> solver = std::make_unique<Solver>(resumed);
+        if (solver->load(resume_path)) {
+            Log::i("Resumed {} at step {}", resume_path, solver->stepCount());
+            config = resumed;
+            return solver;
+        }
+    }
+
+    Log::e("Could not resume {}, using the initial conditions", resume_path);
+    return std::make_unique<Solver>(config);
+}
+
+/// @brief Saves a checkpoint if the solver is at a checkpoint step.
+void saveCheckpoint(const Solver& solver,
+                    const Config& config,
+                    const std::string& root) {
+    if (config.checkpointInterval == 0 ||
+        solver.stepCount() % config.checkpointInterval != 0)
+        return;
+
+    solver.save(root + "/" + config.checkpointPath);
+}
 
-BridsonLiquid::BridsonLiquid() : mUpdateOnce(false), mUpdateContinuous(false) {
+}
+
+BridsonLiquid::BridsonLiquid(const RunOptions& options)
+    : mOptions(options),
+      mFrameCounter(0),
+      mUpdateOnce(false),
+      mUpdateContinuous(false),
+      mRefresh(true) {
 }
 
 void BridsonLiquid::init() {
     glfwSetInputMode(mWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
-    // Load config.
+    // Load config, and restore the solver before anything is sized from the
+    // config, since a checkpoint brings its own grid size.
     mConfig = Config::loadFromJson(asset("config.json"));
 
+    // A replay draws a cached run, at the size of the cache, in place of the
+    // solver.
+    if (!mOptions.replayPath.empty()) {
+        mReplay = std::make_unique<FieldReplay>(
+            mOptions.replayPath, "s", mOptions.replayFps);
+        if (mReplay->isOpen()) {
+            mConfig.rows = mReplay->ny();
+            mConfig.cols = mReplay->nx();
+        } else {
+            Log::e("Could not replay {}, running the solver",
+                   mOptions.replayPath);
+            mReplay.reset();
+        }
+    }
+
+    if (!mReplay) {
+        mSolver = createSolver(mConfig, mOptions.resumePath);
+        mFrameCounter = static_cast<u32>(mSolver->stepCount());
+    }
+
     // Create shader program.
     std::string vertex_shader =
         files::read_to_string(asset("shaders/shader.vs").c_str());
@@ -46,112 +127,286 @@ void BridsonLiquid::init() {
 
     mQuadMesh = Quad();
 
-    mTexData.resize(mConfig.rows * mConfig.cols * 3);
+    // The surface is uploaded as is and thresholded by the shader.
+    mTexture.allocate(static_cast<u32>(mConfig.cols),
+                      static_cast<u32>(mConfig.rows));
     mProgram.setUniform<i32>("sampler", 0);
+    mProgram.setUniform<f32>("threshold",
+                             static_cast<f32>(cSurfaceThreshold));
 
-    // Initialize the solver.
-    mSolver = std::make_unique<Solver>(mConfig);
-}
+    if (mReplay)
+        return;
+
+    // Hand the solver to its own thread.
+    if (mConfig.saveFrames) {
+        mEncoder = std::make_unique<FrameEncoder>(
+            root() + "/frames", mConfig.cols, mConfig.rows);
+    }
 
-void BridsonLiquid::update() {
-    if (mUpdateOnce || mUpdateContinuous)
-        mSolver->step();
+    {
+        // The snapshot buffers hold what is drawn, so they count as rendering.
+        const memory::TagScope tag(memory::Tag::Rendering);
+        mSimulation = std::make_unique<SimulationThread<Command, Snapshot>>(
+            Snapshot{mSolver->surface(), mFrameCounter});
+    }
+    mSimulation->start(
+        [this](const Command command) { handle(command); },
+        [this](Snapshot& snapshot) { return step(snapshot); });
 }
 
 void BridsonLiquid::draw() {
-    for (Index row = 0; row < mConfig.rows; ++row) {
-        for (Index col = 0; col < mConfig.cols; ++col) {
-            const f64 s = mSolver->surface()(static_cast<i32>(col),
-                                             static_cast<i32>(row));
-
-            const GLubyte b = (s <= 0.01) ? 255 : 0;
-
-            const Index i = row * mConfig.cols + col;
-            mTexData[i * 3] = b;
-            mTexData[i * 3 + 1] = b;
-            mTexData[i * 3 + 2] = b;
+    if (mReplay) {
+        if (const f64* values = mReplay->update()) {
+            const Size count = static_cast<Size>(mReplay->nx()) * mReplay->ny();
+            upload(mTexture, values, count);
         }
+    } else if (mSimulation->update()) {
+        upload(mTexture, mSimulation->snapshot().surface);
     }
 
-    mTexture.image(mConfig.rows, mConfig.cols, mTexData.data());
     mTexture.bind(0);
 
     mQuadMesh.render();
+}
+
+void BridsonLiquid::cleanup() {
+    if (mSimulation)
+        mSimulation->stop();
+}
+
+void BridsonLiquid::onKeyPress(int key, int action, int mods) {
+    if (mReplay) {
+        onReplayKey(key, action, mods);
+        return;
+    }
 
-    if (mUpdateOnce || mUpdateContinuous) {
-        Log::i("Frame {}", mFrameCounter);
-        if (mConfig.saveFrames)
-            saveCurrentFrame();
+    if (action != GLFW_PRESS)
+        return;
 
-        ++mFrameCounter;
-        mUpdateOnce = false;
+    Command command;
+    switch (key) {
+    case GLFW_KEY_Q:
+        quit();
+        return;
+    case GLFW_KEY_SPACE:
+        command = Command::ToggleContinuous;
+        break;
+    case GLFW_KEY_N:
+        command = Command::Step;
+        break;
+    case GLFW_KEY_R:
+        command = Command::Reset;
+        break;
+    case GLFW_KEY_S:
+        command = Command::PrintSurface;
+        break;
+    case GLFW_KEY_P:
+        command = Command::PrintPressure;
+        break;
+    case GLFW_KEY_U:
+        command = Command::PrintU;
+        break;
+    case GLFW_KEY_V:
+        command = Command::PrintV;
+        break;
+    case GLFW_KEY_L:
+        command = Command::PrintLabels;
+        break;
+    case GLFW_KEY_C:
+        command = Command::Checkpoint;
+        break;
+    default:
+        return;
     }
+
+    if (!mSimulation->send(command))
+        Log::w("Solver busy, dropping key press");
 }
 
-void BridsonLiquid::onKeyPress(int key, int action, int mods) {
-    if (action == GLFW_PRESS) {
-        switch (key) {
-        case GLFW_KEY_Q:
-            quit();
-            break;
-        case GLFW_KEY_SPACE:
-            mUpdateContinuous = !mUpdateContinuous;
-            break;
-        case GLFW_KEY_N:
-            mUpdateOnce = true;
-            break;
-        case GLFW_KEY_R:
-            mSolver = std::make_unique<Solver>(mConfig);
-            break;
-        case GLFW_KEY_S:
-            // Print surface.
-            println("SURFACE\n{}", mSolver->surface());
-            break;
-        case GLFW_KEY_P:
-            // Print pressure.
-            println("PRESSURE\n{}", mSolver->pressure());
-            break;
-        case GLFW_KEY_U:
-            // Print velocity u component.
-            println("U\n{}", mSolver->u());
-            break;
-        case GLFW_KEY_V:
-            // Print velocity v component.
-            println("V\n{}", mSolver->v());
-            break;
-        case GLFW_KEY_L:
-            // Print labels.
-            println("LABELS\n{}", mSolver->label());
-            break;
-        default:
-            break;
-        }
+void BridsonLiquid::onReplayKey(int key, int action, int mods) {
+    // Scrubbing follows key repeats, so holding an arrow key moves through
+    // the run.
+    const bool scrub = key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT;
+    if (action != GLFW_PRESS && !(scrub && action == GLFW_REPEAT))
+        return;
+
+    const i64 stride = (mods & GLFW_MOD_SHIFT) ? 10 : 1;
+    switch (key) {
+    case GLFW_KEY_Q:
+        quit();
+        return;
+    case GLFW_KEY_SPACE:
+        mReplay->togglePlaying();
+        return;
+    case GLFW_KEY_L:
+        mReplay->toggleLoop();
+        return;
+    case GLFW_KEY_N:
+        mReplay->scrub(1);
+        break;
+    case GLFW_KEY_R:
+        mReplay->seek(0);
+        break;
+    case GLFW_KEY_LEFT:
+        mReplay->scrub(-stride);
+        break;
+    case GLFW_KEY_RIGHT:
+        mReplay->scrub(stride);
+        break;
+    default:
+        return;
     }
+
+    Log::i("Frame {} of {} (step {})",
+           mReplay->position(),
+           mReplay->frameCount(),
+           mReplay->step());
 }
 
 void BridsonLiquid::onFramebufferResize(const u32 width, const u32 height) {
     glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
 }
 
-void BridsonLiquid::saveCurrentFrame() const {
-    if (mTexData.empty()) {
-        Log::f("mTextData empty");
-        return;
+void BridsonLiquid::handle(const Command command) {
+    switch (command) {
+    case Command::Step:
+        mUpdateOnce = true;
+        break;
+    case Command::ToggleContinuous:
+        mUpdateContinuous = !mUpdateContinuous;
+        break;
+    case Command::Reset:
+        mSolver = std::make_unique<Solver>(mConfig);
+        mRefresh = true;
+        break;
+    case Command::PrintSurface:
+        println("SURFACE\n{}", mSolver->surface());
+        break;
+    case Command::PrintPressure:
+        println("PRESSURE\n{}", mSolver->pressure());
+        break;
+    case Command::PrintU:
+        println("U\n{}", mSolver->u());
+        break;
+    case Command::PrintV:
+        println("V\n{}", mSolver->v());
+        break;
+    case Command::PrintLabels:
+        println("LABELS\n{}", mSolver->label());
+        break;
+    case Command::Checkpoint:
+        if (mSolver->save(root() + "/" + mConfig.checkpointPath))
+            Log::i("Saved checkpoint at step {}", mSolver->stepCount());
+        break;
+    default:
+        unreachable;
+    }
+}
+
+bool BridsonLiquid::step(Snapshot& snapshot) {
+    if (!mUpdateOnce && !mUpdateContinuous) {
+        if (!mRefresh)
+            return false;
+
+        // Publish the reset state without stepping.
+        snapshot.surface = mSolver->surface();
+        snapshot.frame = mFrameCounter;
+        mRefresh = false;
+        return true;
+    }
+
+    mSolver->step();
+    saveCheckpoint(*mSolver, mConfig, root());
+
+    snapshot.surface = mSolver->surface();
+    snapshot.frame = mFrameCounter;
+
+    Log::i("Frame {}", mFrameCounter);
+    if (mConfig.saveFrames)
+        saveFrame(snapshot);
+
+    ++mFrameCounter;
+    mUpdateOnce = false;
+    mRefresh = false;
+    return true;
+}
+
+void BridsonLiquid::saveFrame(const Snapshot& snapshot) {
+    FrameEncoder::Frame& frame = mEncoder->acquire();
+    fillFrame(snapshot.surface, frame.rgb);
+    frame.index = snapshot.frame;
+    mEncoder->submit(frame);
+}
+
+void BridsonLiquid::runHeadless(const RunOptions& options,
+                                const std::string& root) {
+    const HeadlessOptions& headless = options.headless;
+
+    Config config = Config::loadFromJson(root + "/assets/config.json");
+    if (headless.gridSize > 0) {
+        config.rows = headless.gridSize;
+        config.cols = headless.gridSize;
+        config.cellSize = 1.0 / config.rows;
+    }
+    if (headless.threads > 0)
+        config.threads = headless.threads;
+
+    const std::unique_ptr<Solver> created =
+        createSolver(config, options.resumePath);
+    Solver& solver = *created;
+
+    FieldRecorder cache(headless.cachePath, headless.cacheErrorBound);
+    cache.addGrid("u", solver.u());
+    cache.addGrid("v", solver.v());
+    cache.addGrid("p", solver.pressure());
+    cache.addGrid("s", solver.surface());
+    cache.addLabels("labels", solver.label());
+    cache.open(static_cast<i32>(config.cols),
+               static_cast<i32>(config.rows),
+               config.cellSize);
+
+    const auto record = [&](const u32) {
+        saveCheckpoint(solver, config, root);
+        cache.record(solver.stepCount());
+    };
+
+    u64 cg_iterations = 0;
+    const f64 seconds = Headless::run(
+        headless,
+        root,
+        config.cols,
+        config.rows,
+        [&]() {
+            solver.step();
+            cg_iterations += solver.cgIterations();
+        },
+        [&](std::vector<u8>& rgb) { fillFrame(solver.surface(), rgb); },
+        record);
+
+    Headless::writeSummary(headless,
+                           RunSummary{"BridsonLiquid",
+                                      headless.threads,
+                                      solver.threads(),
+                                      static_cast<u32>(config.cols),
+                                      static_cast<u32>(config.rows),
+                                      headless.steps,
+                                      seconds,
+                                      cg_iterations});
+}
+
+void BridsonLiquid::fillFrame(const Grid& surface, std::vector<u8>& rgb) {
+    for (i32 row = 0; row < surface.ny(); ++row) {
+        const Index offset = static_cast<Index>(row) * surface.nx() * 3;
+        fillRow(surface.row(row), surface.nx(), rgb.data() + offset);
     }
+}
 
-    std::ostringstream filenameStream;
-    filenameStream << "Frame_" << std::setw(5) << std::setfill('0')
-                   << mFrameCounter << ".png";
-    const std::string filename = filenameStream.str();
-    const std::string path = root() + "/frames/" + filename;
-
-    const int error = stbi_write_png(path.c_str(),
-                                     static_cast<int>(mConfig.cols),
-                                     static_cast<int>(mConfig.rows),
-                                     3,
-                                     mTexData.data(),
-                                     static_cast<int>(mConfig.cols * 3));
-
-    if (!error)
-        Log::f("Failed to save the current frame");
+void BridsonLiquid::fillRow(const f64* surface, const i32 count, u8* rgb) {
+    for (i32 col = 0; col < count; ++col) {
+        const u8 b = (surface[col] <= cSurfaceThreshold) ? 255 : 0;
+
+        rgb[col * 3] = b;
+        rgb[col * 3 + 1] = b;
+        rgb[col * 3 + 2] = b;
+    }
 }
@@ -4,40 +4,115 @@
 #include <vector>
 
 #include "application/application.hpp"
+#include "application/frame_encoder.hpp"
+#include "application/headless.hpp"
+#include "application/run_options.hpp"
+#include "application/simulation_thread.hpp"
 #include "config.hpp"
 #include "geometry/camera.hpp"
+#include "io/field_replay.hpp"
 #include "platform/mesh.hpp"
+#include "platform/field_texture.hpp"
 #include "platform/shader.hpp"
-#include "platform/texture.hpp"
 #include "solver.hpp"
 
 class BridsonLiquid : public Application {
 public:
-    BridsonLiquid();
+    /// @param options Command line options. Windowed runs use the resume and
+    /// replay options.
+    BridsonLiquid(const RunOptions& options);
     ~BridsonLiquid() = default;
 
+    /// @brief Runs the solver from the app config, or from
+    /// `options.resumePath` if set, without a window.
+    static void runHeadless(const RunOptions& options,
+                            const std::string& root);
+
     virtual void init() override;
-    virtual void update() override;
     virtual void draw() override;
+    virtual void cleanup() override;
 
     virtual void onKeyPress(int key, int action, int mods) override;
     virtual void onFramebufferResize(const u32 width,
                                      const u32 height) override;
 
 private:
-    void saveCurrentFrame() const;
+    /// @brief Requests sent from the render thread to the solver thread.
+    enum class Command {
+        Step = 0,
+        ToggleContinuous,
+        Reset,
+        PrintSurface,
+        PrintPressure,
+        PrintU,
+        PrintV,
+        PrintLabels,
+        Checkpoint
+    };
+
+    /// @brief Cells whose surface value is at most the threshold are drawn
+    /// as liquid.
+    static constexpr f64 cSurfaceThreshold = 0.01;
+
+    /// @brief Solver state published to the render thread.
+    struct Snapshot {
+        Grid surface;
+        u32 frame;
+    };
+
+    /// @brief Fills an RGB image of the surface, bottom row first.
+    static void fillFrame(const Grid& surface, std::vector<u8>& rgb);
+
+    /// @brief Fills `count` RGB pixels from a row of surface values, coloured
+    /// like the fragment shader.
+    static void fillRow(const f64* surface, const i32 count, u8* rgb);
+
+    /// @brief Handles a key press while replaying. Space plays and pauses, N
+    /// steps, R restarts, L toggles looping and the arrow keys scrub, ten
+    /// frames at a time with shift.
+    void onReplayKey(int key, int action, int mods);
+
+    /// @brief Runs a command on the solver thread.
+    void handle(const Command command);
+
+    /// @brief Steps the solver if it is running and writes the new state to
+    /// the snapshot. Runs on the solver thread.
+    bool step(Snapshot& snapshot);
+
+    /// @brief Queues the snapshot for PNG encoding. Runs on the solver
+    /// thread.
+    void saveFrame(const Snapshot& snapshot);
 
     gl::ShaderProgram mProgram;
     gl::Mesh mQuadMesh;
 
-    Texture mTexture;
-    std::vector<GLubyte> mTexData;
+    /// @brief Surface on the GPU, shaded by the fragment shader.
+    FieldTexture mTexture;
 
-    std::unique_ptr<Solver> mSolver;
     Config mConfig;
 
+    RunOptions mOptions;
+
+    /// @brief Cached run drawn instead of the solver, when replaying.
+    std::unique_ptr<FieldReplay> mReplay;
+
+    // The solver state below is only touched by the solver thread once it
+    // has started.
+
+    std::unique_ptr<Solver> mSolver;
+
+    /// @brief Background PNG encoder, when frames are saved.
+    std::unique_ptr<FrameEncoder> mEncoder;
+
     u32 mFrameCounter;
 
     bool mUpdateOnce;
     bool mUpdateContinuous;
+
+    /// @brief Publish the solver state without stepping, after a reset.
+    bool mRefresh;
+
+    /// @brief Declared last so the thread stops before the solver is
+    /// destroyed.
+    std::unique_ptr<SimulationThread<Command, Snapshot>> mSimulation;
 };
@@ -1,6 +1,7 @@
 #include "config.hpp"
 
 #include "util/files.hpp"
+#include "util/log.hpp"
 
 Config Config::loadFromJson(const std::string& path) {
     Config config;
@@ -12,6 +13,67 @@ Config Config::loadFromJson(const std::string& path) {
     config.cellSize = 1.0 / config.rows;
     config.timestep = config_file["timestep"];
     config.saveFrames = config_file["save_frames"];
+    config.cflBand = config_file.value("cfl_band", false);
+    config.threads = config_file.value("threads", 0u);
+    config.redistanceSweeps = config_file.value("redistance_sweeps", 2u);
+    config.parallelRedistancing =
+        config_file.value("parallel_redistancing", false);
+    config.narrowBand = config_file.value("narrow_band", false);
+    config.bandWidth = config_file.value("band_width", 6.0);
+
+    const std::string mode =
+        config_file.value("solver_mode", std::string("level_set"));
+    if (mode == "flip") {
+        config.mode = SolverMode::Flip;
+    } else {
+        if (mode != "level_set")
+            Log::w("Unknown solver mode {}, using level_set", mode);
+        config.mode = SolverMode::LevelSet;
+    }
+    config.flipRatio = config_file.value("flip_ratio", 0.95);
+    config.checkpointInterval = config_file.value("checkpoint_interval", 0u);
+    config.checkpointPath =
+        config_file.value("checkpoint_path", std::string("checkpoint.bin"));
 
     return config;
 }
+
+void Config::write(BinaryWriter& out) const {
+    out.write(static_cast<u64>(rows));
+    out.write(static_cast<u64>(cols));
+    out.write(cellSize);
+    out.write(timestep);
+    out.write(static_cast<u8>(cflBand));
+    out.write(redistanceSweeps);
+    out.write(static_cast<u8>(parallelRedistancing));
+    out.write(static_cast<u8>(narrowBand));
+    out.write(bandWidth);
+    out.write(static_cast<u32>(mode));
+    out.write(flipRatio);
+}
+
+bool Config::read(BinaryReader& in) {
+    u64 rows_in, cols_in;
+    u8 cfl_band, parallel_redistancing, narrow_band;
+    u32 mode_in;
+    Config result = *this;
+
+    const bool ok =
+        in.read(rows_in) && in.read(cols_in) && in.read(result.cellSize) &&
+        in.read(result.timestep) && in.read(cfl_band) &&
+        in.read(result.redistanceSweeps) && in.read(parallel_redistancing) &&
+        in.read(narrow_band) && in.read(result.bandWidth) &&
+        in.read(mode_in) && in.read(result.flipRatio);
+    if (!ok || mode_in > static_cast<u32>(SolverMode::Flip))
+        return false;
+
+    result.rows = rows_in;
+    result.cols = cols_in;
+    result.cflBand = cfl_band != 0;
+    result.parallelRedistancing = parallel_redistancing != 0;
+    result.narrowBand = narrow_band != 0;
+    result.mode = static_cast<SolverMode>(mode_in);
+
+    *this = result;
+    return true;
+}
@@ -1,13 +1,37 @@
 #pragma once
 
+#include "io/binary.hpp"
 #include "util/common.hpp"
 
+enum class SolverMode {
+    LevelSet = 0,
+    Flip
+};
+
 struct Config {
     Size rows;
     Size cols;
     f64 cellSize;
     f64 timestep;
     bool saveFrames;
+    bool cflBand;
+    u32 threads;
+    u32 redistanceSweeps;
+    bool parallelRedistancing;
+    bool narrowBand;
+    f64 bandWidth;
+    SolverMode mode;
+    f64 flipRatio;
+    u32 checkpointInterval;
+    std::string checkpointPath;
 
     static Config loadFromJson(const std::string& path);
+
+    /// @brief Writes the simulation parameters. Runtime settings (threads,
+    /// frame saving and checkpointing) are not written.
+    void write(BinaryWriter& out) const;
+
+    /// @brief Reads simulation parameters written by write() into this
+    /// config, keeping its runtime settings.
+    bool read(BinaryReader& in);
 };
@@ -1,71 +1,106 @@
 #include "extrapolation.hpp"
 
+#include "util/memory.hpp"
+
 Extrapolation::Extrapolation(Grid& q, LabelGrid& label)
-    : mQ(q), mBack(mQ), mLabel(label), mLabelBack(label) {
+    : mTag(memory::Tag::Extrapolation),
+      mQ(q),
+      mLabel(label),
+      mQueued(label.cellCount(), 0) {
+    mTag.end();
 }
 
 void Extrapolation::operator()(const LabelGrid& label) {
-    mLabel = label;
-
-    Result result = Result::Updated;
-    do {
-        result = step();
-    } while (result == Result::Updated);
+    extrapolate(label, cUnbounded);
 }
 
 void Extrapolation::operator()(const u32 n, const LabelGrid& label) {
+    if (n > 0)
+        extrapolate(label, n);
+}
+
+void Extrapolation::extrapolate(const LabelGrid& label, const u32 max_depth) {
+    const memory::TagScope tag(memory::Tag::Extrapolation);
+
     mLabel = label;
+    clearEmpty();
 
-    for (u32 i = 0; i < n; ++i) {
-        static_cast<void>(step());
-    }
-}
+    mCells.clear();
+    mLabel.frontier(mFrontier);
+    mLabel.forEach(mFrontier, [&](const i32 i, const i32 j) {
+        mQueued[j * mLabel.nx() + i] = 1;
+        mCells.push_back({i, j});
+    });
+
+    Size begin = 0;
+    for (u32 depth = 0; depth < max_depth && begin < mCells.size(); ++depth) {
+        const Size end = mCells.size();
+
+        // Cells in a layer only read near-fluid neighbours, which belong to
+        // earlier layers, so they are written in place.
+        for (Size k = begin; k < end; ++k) average(mCells[k].i, mCells[k].j);
 
-Extrapolation::Result Extrapolation::step() {
-    Result result = Result::FixedPoint;
-    mBack.fill(0.0);
-
-    for (i32 j = 0; j < mQ.ny(); ++j) {
-        for (i32 i = 0; i < mQ.nx(); ++i) {
-            if (mLabel.isEmpty(i, j)) {
-                u32 neighbour_count = 0;
-                f64 value = 0;
-
-                // x neighbours.
-                if (i > 0 && mLabel.isNearFluid(i - 1, j)) {
-                    value += mQ(i - 1, j);
-                    ++neighbour_count;
-                }
-                if (i < mQ.nx() - 1 && mLabel.isNearFluid(i + 1, j)) {
-                    value += mQ(i + 1, j);
-                    ++neighbour_count;
-                }
-
-                // y neighbours.
-                if (j > 0 && mLabel.isNearFluid(i, j - 1)) {
-                    value += mQ(i, j - 1);
-                    ++neighbour_count;
-                }
-                if (j < mQ.ny() - 1 && mLabel.isNearFluid(i, j + 1)) {
-                    value += mQ(i, j + 1);
-                    ++neighbour_count;
-                }
-
-                if (neighbour_count > 0) {
-                    mLabelBack.set(i, j, Label::Extrapolated);
-                    mBack(i, j) = value / static_cast<f64>(neighbour_count);
-                    result = Result::Updated;
-                }
-            } else {
-                mBack(i, j) = mQ(i, j);
-                if (i < mLabelBack.nx() && j < mLabelBack.ny())
-                    mLabelBack.set(i, j, mLabel(i, j));
+        for (Size k = begin; k < end; ++k)
+            mLabel.set(mCells[k].i, mCells[k].j, Label::Extrapolated);
+
+        if (depth + 1 < max_depth) {
+            // The label ghost layer is solid, so boundary neighbours are never
+            // queued and need no bounds checks.
+            for (Size k = begin; k < end; ++k) {
+                const auto [i, j] = mCells[k];
+                enqueue(i - 1, j);
+                enqueue(i + 1, j);
+                enqueue(i, j - 1);
+                enqueue(i, j + 1);
             }
         }
+
+        begin = end;
+    }
+
+    for (const Cell& cell : mCells) mQueued[cell.j * mLabel.nx() + cell.i] = 0;
+}
+
+void Extrapolation::clearEmpty() {
+    mLabel.mask(Label::Empty, mFrontier);
+    mLabel.forEach(mFrontier,
+                   [&](const i32 i, const i32 j) { mQ(i, j) = 0.0; });
+}
+
+void Extrapolation::enqueue(const i32 i, const i32 j) {
+    if (!mLabel.isEmpty(i, j))
+        return;
+
+    u8& queued = mQueued[j * mLabel.nx() + i];
+    if (queued == 0) {
+        queued = 1;
+        mCells.push_back({i, j});
     }
+}
 
-    std::swap(mQ, mBack);
-    std::swap(mLabel, mLabelBack);
+void Extrapolation::average(const i32 i, const i32 j) {
+    u32 neighbour_count = 0;
+    f64 value = 0;
+
+    // x neighbours.
+    if (mLabel.isNearFluid(i - 1, j)) {
+        value += mQ(i - 1, j);
+        ++neighbour_count;
+    }
+    if (mLabel.isNearFluid(i + 1, j)) {
+        value += mQ(i + 1, j);
+        ++neighbour_count;
+    }
+
+    // y neighbours.
+    if (mLabel.isNearFluid(i, j - 1)) {
+        value += mQ(i, j - 1);
+        ++neighbour_count;
+    }
+    if (mLabel.isNearFluid(i, j + 1)) {
+        value += mQ(i, j + 1);
+        ++neighbour_count;
+    }
 
-    return result;
+    mQ(i, j) = value / static_cast<f64>(neighbour_count);
 }
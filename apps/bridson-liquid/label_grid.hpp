@@ -1,7 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include "grid.hpp"
 #include "util/common.hpp"
 #include "util/format.hpp"
+#include "util/memory.hpp"
 
 enum class Label {
     Empty = 0,
@@ -10,20 +16,29 @@ enum class Label {
     Solid
 };
 
+/// @brief One bit per cell of a label grid, laid out like the label planes.
+using CellMask = std::vector<u64, memory::Allocator<u64>>;
+
+/// @brief Cell labels stored as separate fluid, extrapolated and solid bit
+/// planes. A cell is empty when none of its bits are set. Every padded row
+/// starts on a word boundary, so bulk operations work 64 cells at a time.
 class LabelGrid {
 public:
-    LabelGrid(const i32 nx, const i32 ny);
-
-    LabelGrid(const LabelGrid& other);
+    /// @brief Constructs a label grid with `ghost` layers of `Label::Solid`
+    /// cells around the interior. Lookups may index into the ghost layer, so
+    /// stencils can query neighbours at the boundary without bounds checks.
+    LabelGrid(const i32 nx, const i32 ny, const i32 ghost = 1);
 
-    LabelGrid& operator=(const LabelGrid& other);
-
-    /// @brief Retrives the label at cell indices (i, j).
+    /// @brief Retrives the label at cell indices (i, j). Indices may lie in
+    /// the ghost layer.
     Label operator()(const i32 i, const i32 j) const;
 
     /// @brief Sets the label at cell indices (i, j).
     void set(const i32 i, const i32 j, const Label label);
 
+    /// @brief Sets the label of every cell in the mask.
+    void set(const CellMask& mask, const Label label);
+
     /// @brief Indicates whether the specified cell is Empty.
     bool isEmpty(const i32 i, const i32 j) const;
 
@@ -48,29 +63,155 @@ public:
     /// @brief Number of cells in the grid. Equal to nx() * ny().
     i32 cellCount() const;
 
-    /// @brief Retrieve a pointer to the internal buffer.
-    Label* data();
+    /// @brief Number of ghost layers around the interior.
+    i32 ghost() const;
 
-    /// @brief Fill the grid with the specified label.
+    /// @brief Number of interior cells with the specified label.
+    i32 count(const Label label) const;
+
+    /// @brief Fill the interior of the grid with the specified label.
     void fill(const Label label);
 
+    /// @brief Fill the ghost layer with the specified label.
+    void fillGhosts(const Label label);
+
     /// @brief Sets the edge cells to `Label::Solid`.
     void setSolidBorder();
 
     /// @brief Sets all fluid cells to `Label::Empty`.
     void reset();
 
+    /// @brief Labels every non-solid interior cell Fluid where `is_fluid`
+    /// holds for the matching value of `q`, and Empty otherwise.
+    /// @param q Grid with the same dimensions as the label grid.
+    /// @param is_fluid Predicate on a grid value.
+    template <typename Predicate>
+    void classify(const Grid& q, Predicate is_fluid);
+
+    /// @brief Builds the mask of cells with the specified label.
+    void mask(const Label label, CellMask& dst) const;
+
+    /// @brief Builds the mask of Empty cells with a Fluid or Extrapolated
+    /// 4-neighbour. This is a dilation of the near-fluid cells restricted to
+    /// the Empty cells.
+    void frontier(CellMask& dst) const;
+
+    /// @brief Calls `f(i, j)` for every cell in the mask, in row-major order.
+    template <typename F>
+    void forEach(const CellMask& mask, F&& f) const;
+
+    /// @brief Calls `f(i, j)` for every cell with the specified label, in
+    /// row-major order.
+    template <typename F>
+    void forEach(const Label label, F&& f) const;
+
 private:
+    /// @brief Bits per mask word.
+    static constexpr i32 cWordBits = 64;
+
+    /// @brief Mask word holding cell (i, j).
+    Index word(const i32 i, const i32 j) const;
+
+    /// @brief Bit of cell (i, j) within its mask word.
+    u64 bit(const i32 i, const i32 j) const;
+
+    /// @brief Mask word `w` of the cells with the specified label.
+    u64 labelWord(const Label label, const Index w) const;
+
     /// @brief Number of columns in the grid.
     i32 mNx;
 
     /// @brief Number of rows in the grid.
     i32 mNy;
 
-    /// @brief Grid labels.
-    Label* mData;
+    /// @brief Number of ghost layers around the interior.
+    i32 mGhost;
+
+    /// @brief Row width of the padded grid. Equal to nx() + 2 * ghost().
+    i32 mStride;
+
+    /// @brief Number of mask words per padded row.
+    i32 mRowWords;
+
+    /// @brief Number of padded rows. Equal to ny() + 2 * ghost().
+    i32 mRows;
+
+    /// @brief Ghost and interior columns of a padded row. The slack bits past
+    /// the last ghost column of a row are excluded.
+    CellMask mColumns;
+
+    /// @brief Interior columns of a padded row.
+    CellMask mInterior;
+
+    /// @brief Fluid cells.
+    CellMask mFluid;
+
+    /// @brief Extrapolated cells.
+    CellMask mExtrapolated;
+
+    /// @brief Solid cells. The slack bits of every row are solid, so they are
+    /// never Empty.
+    CellMask mSolid;
 };
 
+template <typename Predicate>
+void LabelGrid::classify(const Grid& q, Predicate is_fluid) {
+    assertm(q.nx() == mNx && q.ny() == mNy, "grid dimensions must match");
+
+    for (i32 j = 0; j < mNy; ++j) {
+        const f64* row = q.row(j);
+        const Index row_word = static_cast<Index>(j + mGhost) * mRowWords;
+
+        for (i32 w = 0; w < mRowWords; ++w) {
+            if (mInterior[w] == 0)
+                continue;
+
+            // Padded columns [c0, c1) of this word that are interior.
+            const i32 c0 = std::max(w * cWordBits, mGhost);
+            const i32 c1 = std::min((w + 1) * cWordBits, mGhost + mNx);
+
+            u64 bits = 0;
+            for (i32 c = c0; c < c1; ++c) {
+                bits |= static_cast<u64>(is_fluid(row[c - mGhost]))
+                        << (c % cWordBits);
+            }
+
+            const Index index = row_word + w;
+            mFluid[index] = (mFluid[index] & ~mInterior[w]) |
+                            (bits & ~mSolid[index]);
+            mExtrapolated[index] &= ~mInterior[w];
+        }
+    }
+}
+
+template <typename F>
+void LabelGrid::forEach(const CellMask& mask, F&& f) const {
+    for (i32 r = 0; r < mRows; ++r) {
+        for (i32 w = 0; w < mRowWords; ++w) {
+            u64 bits = mask[static_cast<Index>(r) * mRowWords + w];
+            while (bits != 0) {
+                const i32 c = w * cWordBits + std::countr_zero(bits);
+                f(c - mGhost, r - mGhost);
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
+template <typename F>
+void LabelGrid::forEach(const Label label, F&& f) const {
+    for (i32 r = 0; r < mRows; ++r) {
+        for (i32 w = 0; w < mRowWords; ++w) {
+            u64 bits = labelWord(label, static_cast<Index>(r) * mRowWords + w);
+            while (bits != 0) {
+                const i32 c = w * cWordBits + std::countr_zero(bits);
+                f(c - mGhost, r - mGhost);
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
 template <>
 struct FormatWriter<Label> {
     static void write(const Label& label, StringBuffer& sb) {
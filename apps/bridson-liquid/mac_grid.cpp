@@ -1,10 +1,13 @@
 #include "mac_grid.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 MACGrid::MACGrid(const i32 rows, const i32 cols, const f32 cell_size)
     : u(rows, cols + 1, Vector2D(0.0, 0.5), cell_size),
       v(rows + 1, cols, Vector2D(0.5, 0.0), cell_size),
       p(rows, cols, Vector2D(0.5, 0.5), cell_size),
-      s(rows, cols, Vector2D(0.5, 0.5), cell_size),
+      s(rows, cols, Vector2D(0.5, 0.5), cell_size, 1),
       label(rows, cols),
       mNx(cols),
       mNy(rows),
@@ -35,22 +38,21 @@ f32 MACGrid::cellSize() const {
 }
 
 void MACGrid::updateLabels() {
-    label.reset();
-
     // A cell has fluid in it if the level set value at that cell is negative.
-    for (i32 j = 0; j < mNy; ++j) {
-        for (i32 i = 0; i < mNx; ++i) {
-            if (label.isSolid(i, j)) {
-                continue;
-            }
+    label.classify(s, [](const f64 x) { return x < 0.0; });
+}
+
+f64 MACGrid::maxSpeed() const {
+    return std::max({std::abs(u.max()),
+                     std::abs(u.min()),
+                     std::abs(v.max()),
+                     std::abs(v.min())});
+}
+
+u32 MACGrid::extrapolationDepth(const f64 dt) const {
+    const f64 cfl = maxSpeed() * dt / mCellSize;
 
-            if (s(i, j) < 0.0) {
-                label.set(i, j, Label::Fluid);
-            } else {
-                label.set(i, j, Label::Empty);
-            }
-        }
-    }
+    return static_cast<u32>(std::ceil(cfl)) + 2;
 }
 
 f32 MACGrid::width() const {
@@ -1,6 +1,19 @@
 #include "bridson_liquid.hpp"
 
-int main() {
-    BridsonLiquid::launch<BridsonLiquid>(
-        800, 600, "LSM liquid solver (Bridson)", 60.0f, "apps/bridson-liquid");
+int main(int argc, char** argv) {
+    const RunOptions options = RunOptions::parse(argc, argv);
+    Application::startServices(options);
+
+    if (options.headless.enabled) {
+        BridsonLiquid::runHeadless(options, "apps/bridson-liquid");
+    } else {
+        BridsonLiquid::launch<BridsonLiquid>(800,
+                                             600,
+                                             "LSM liquid solver (Bridson)",
+                                             60.0f,
+                                             "apps/bridson-liquid",
+                                             options);
+    }
+
+    Application::finishServices();
 }
@@ -0,0 +1,101 @@
+#include "narrow_band.hpp"
+
+#include "math/numeric.hpp"
+
+NarrowBand::NarrowBand(const i32 nx, const i32 ny, const f64 width)
+    : mNx(nx), mNy(ny), mWidth(width), mRowOffsets(ny + 1, 0) {
+    assertm(mNx > 0, "number of cols must be positive");
+    assertm(mNy > 0, "number of rows must be positive");
+    assertm(mWidth > cRebuildMargin, "band must be wider than its margin");
+}
+
+void NarrowBand::rebuild(Grid& q) {
+    assertm(q.nx() == mNx && q.ny() == mNy, "grid dimensions must match");
+
+    mCells.clear();
+    mEdge.clear();
+
+    for (i32 j = 0; j < mNy; ++j) {
+        mRowOffsets[j] = mCells.size();
+        for (i32 i = 0; i < mNx; ++i) {
+            if (math::abs(q(i, j)) < mWidth)
+                mCells.push_back({i, j});
+            else
+                q(i, j) = q(i, j) < 0.0 ? -mWidth : mWidth;
+        }
+    }
+    mRowOffsets[mNy] = mCells.size();
+
+    // The edge of the domain is not an edge of the band.
+    const auto outside = [&](const i32 i, const i32 j) {
+        return i >= 0 && i < mNx && j >= 0 && j < mNy &&
+               math::abs(q(i, j)) >= mWidth;
+    };
+
+    for (Index k = 0; k < mCells.size(); ++k) {
+        const auto [i, j] = mCells[k];
+        if (outside(i - 1, j) || outside(i + 1, j) || outside(i, j - 1) ||
+            outside(i, j + 1))
+            mEdge.push_back(k);
+    }
+}
+
+bool NarrowBand::needsRebuild(const Grid& q) const {
+    for (const Index k : mEdge) {
+        if (math::abs(q(mCells[k].i, mCells[k].j)) < mWidth - cRebuildMargin)
+            return true;
+    }
+    return false;
+}
+
+const std::vector<NarrowBand::Cell>& NarrowBand::cells() const {
+    return mCells;
+}
+
+Index NarrowBand::rowBegin(const i32 j) const {
+    return mRowOffsets[j];
+}
+
+Index NarrowBand::rowEnd(const i32 j) const {
+    return mRowOffsets[j + 1];
+}
+
+i32 NarrowBand::nx() const {
+    return mNx;
+}
+
+i32 NarrowBand::ny() const {
+    return mNy;
+}
+
+f64 NarrowBand::width() const {
+    return mWidth;
+}
+
+void NarrowBand::write(BinaryWriter& out) const {
+    out.write(mNx);
+    out.write(mNy);
+    out.write(static_cast<u64>(mCells.size()));
+    out.write(static_cast<u64>(mEdge.size()));
+    out.write(mCells.data(), mCells.size() * sizeof(Cell));
+    out.write(mRowOffsets.data(), mRowOffsets.size() * sizeof(Index));
+    out.write(mEdge.data(), mEdge.size() * sizeof(Index));
+}
+
+bool NarrowBand::read(BinaryReader& in) {
+    i32 nx, ny;
+    u64 cell_count, edge_count;
+    if (!in.read(nx) || !in.read(ny) || !in.read(cell_count) ||
+        !in.read(edge_count))
+        return false;
+    if (nx != mNx || ny != mNy)
+        return false;
+    if (cell_count > static_cast<u64>(mNx) * mNy || edge_count > cell_count)
+        return false;
+
+    mCells.resize(cell_count);
+    mEdge.resize(edge_count);
+    return in.read(mCells.data(), mCells.size() * sizeof(Cell)) &&
+           in.read(mRowOffsets.data(), mRowOffsets.size() * sizeof(Index)) &&
+           in.read(mEdge.data(), mEdge.size() * sizeof(Index));
+}
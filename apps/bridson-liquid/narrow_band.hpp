@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include "grid.hpp"
+#include "util/common.hpp"
+
+/// @brief Active cells of a level set within a fixed distance of the
+/// interface. The cells are sorted in row-major order with per-row offsets,
+/// so stencil sweeps can walk the band in any of the four axis orderings.
+/// Cells outside the band hold the band width with the sign of their side.
+class NarrowBand {
+public:
+    struct Cell {
+        i32 i;
+        i32 j;
+    };
+
+    /// @param width Half-width of the band in cells.
+    NarrowBand(const i32 nx, const i32 ny, const f64 width);
+
+    /// @brief Collects the cells of `q` closer than the band width to the
+    /// interface and clamps every other cell to +/- the band width.
+    void rebuild(Grid& q);
+
+    /// @brief Indicates whether the interface has moved close enough to the
+    /// edge of the band that it must be rebuilt.
+    bool needsRebuild(const Grid& q) const;
+
+    /// @brief Active cells in row-major order.
+    const std::vector<Cell>& cells() const;
+
+    /// @brief Index in cells() of the first active cell in row `j`.
+    Index rowBegin(const i32 j) const;
+
+    /// @brief Index in cells() one past the last active cell in row `j`.
+    Index rowEnd(const i32 j) const;
+
+    /// @brief Number of columns in the grid.
+    i32 nx() const;
+
+    /// @brief Number of rows in the grid.
+    i32 ny() const;
+
+    /// @brief Half-width of the band in cells.
+    f64 width() const;
+
+    /// @brief Writes the active cells, so a restored band matches the one
+    /// that was saved rather than one rebuilt from the level set.
+    void write(BinaryWriter& out) const;
+
+    /// @brief Reads a band written by write(). Fails if the grid dimensions
+    /// do not match.
+    bool read(BinaryReader& in);
+
+private:
+    /// @brief Distance in cells the interface may move towards the edge of
+    /// the band before a rebuild.
+    static constexpr f64 cRebuildMargin = 2.0;
+
+    i32 mNx;
+    i32 mNy;
+    f64 mWidth;
+
+    std::vector<Cell> mCells;
+
+    /// @brief Offsets of each row in mCells, with a final end offset.
+    std::vector<Index> mRowOffsets;
+
+    /// @brief Active cells with an inactive neighbour.
+    std::vector<Index> mEdge;
+};
@@ -0,0 +1,198 @@
+#include "particle_transfer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "math/numeric.hpp"
+
+ParticleTransfer::ParticleTransfer(MACGrid& mac,
+                                   ParticleSet& particles,
+                                   ThreadPool& pool)
+    : mMac(mac),
+      mParticles(particles),
+      mPool(pool),
+      mOldU(mac.u),
+      mOldV(mac.v) {
+}
+
+void ParticleTransfer::seed() {
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<f64> jitter(-0.2, 0.2);
+
+    mParticles.clear();
+    for (i32 j = 0; j < mMac.ny(); ++j) {
+        for (i32 i = 0; i < mMac.nx(); ++i) {
+            if (mMac.s(i, j) >= 0.0 || mMac.label.isSolid(i, j))
+                continue;
+
+            for (i32 k = 0; k < 4; ++k) {
+                const f64 px = i + 0.25 + 0.5 * (k % 2) + jitter(rng);
+                const f64 py = j + 0.25 + 0.5 * (k / 2) + jitter(rng);
+                mParticles.add(px, py);
+            }
+        }
+    }
+
+    mParticles.rebin(mMac.nx(), mMac.ny(), mPool);
+}
+
+void ParticleTransfer::toGrid() {
+    gather(mMac.u, mParticles.u, Vector2D(0.0, 0.5));
+    gather(mMac.v, mParticles.v, Vector2D(0.5, 0.0));
+}
+
+void ParticleTransfer::saveVelocity() {
+    for (i32 j = 0; j < mMac.u.ny(); ++j) {
+        for (i32 i = 0; i < mMac.u.nx(); ++i) mOldU(i, j) = mMac.u(i, j);
+    }
+    for (i32 j = 0; j < mMac.v.ny(); ++j) {
+        for (i32 i = 0; i < mMac.v.nx(); ++i) mOldV(i, j) = mMac.v(i, j);
+    }
+}
+
+void ParticleTransfer::toParticles(const f64 flip_ratio) {
+    mPool.parallelFor(mPool.size(), [&](const u32 t) {
+        Index begin = 0;
+        Index end = 0;
+        range(t, begin, end);
+
+        for (Index p = begin; p < end; ++p) {
+            const Vector2D pos(mParticles.x[p], mParticles.y[p]);
+
+            const f64 pic_u = mMac.u.interp(pos);
+            const f64 pic_v = mMac.v.interp(pos);
+
+            const f64 flip_u = mParticles.u[p] + pic_u - mOldU.interp(pos);
+            const f64 flip_v = mParticles.v[p] + pic_v - mOldV.interp(pos);
+
+            mParticles.u[p] = flip_ratio * flip_u + (1.0 - flip_ratio) * pic_u;
+            mParticles.v[p] = flip_ratio * flip_v + (1.0 - flip_ratio) * pic_v;
+        }
+    });
+}
+
+void ParticleTransfer::advect(const f64 dt) {
+    // Keep particles out of the solid border cells.
+    const f64 eps = 1e-3;
+    const f64 x_max = mMac.nx() - 1.0 - eps;
+    const f64 y_max = mMac.ny() - 1.0 - eps;
+
+    mPool.parallelFor(mPool.size(), [&](const u32 t) {
+        Index begin = 0;
+        Index end = 0;
+        range(t, begin, end);
+
+        for (Index p = begin; p < end; ++p) {
+            const Vector2D pos(mParticles.x[p], mParticles.y[p]);
+
+            const Vector2D v1 = velocity(pos);
+            const Vector2D mid = pos + 0.5 * dt * v1;
+            const Vector2D next = pos + dt * velocity(mid);
+
+            mParticles.x[p] = math::clamp(next[0], 1.0 + eps, x_max);
+            mParticles.y[p] = math::clamp(next[1], 1.0 + eps, y_max);
+        }
+    });
+
+    mParticles.rebin(mMac.nx(), mMac.ny(), mPool);
+}
+
+void ParticleTransfer::updateLabels() {
+    mMac.label.reset();
+
+    for (i32 j = 0; j < mMac.ny(); ++j) {
+        for (i32 i = 0; i < mMac.nx(); ++i) {
+            if (mParticles.cellCount(i, j) > 0 && !mMac.label.isSolid(i, j))
+                mMac.label.set(i, j, Label::Fluid);
+        }
+    }
+}
+
+void ParticleTransfer::updateSurface() {
+    Grid& s = mMac.s;
+
+    // Cells further than `reach` from a cell cannot hold a particle whose
+    // disk is closer than cSurfaceFar.
+    const i32 reach = static_cast<i32>(std::ceil(cParticleRadius)) + 1;
+
+    mPool.parallelFor(static_cast<u32>(s.ny()), [&](const u32 row) {
+        const i32 j = static_cast<i32>(row);
+        const i32 j0 = std::max(j - reach, 0);
+        const i32 j1 = std::min(j + reach, s.ny() - 1);
+
+        for (i32 i = 0; i < s.nx(); ++i) {
+            const i32 i0 = std::max(i - reach, 0);
+            const i32 i1 = std::min(i + reach, s.nx() - 1);
+
+            const f64 cx = i + 0.5;
+            const f64 cy = j + 0.5;
+
+            f64 dist_sq = math::sqr(cSurfaceFar + cParticleRadius);
+            for (i32 pj = j0; pj <= j1; ++pj) {
+                // The cells of a row are contiguous in the particle arrays.
+                const Index end = mParticles.cellEnd(i1, pj);
+                for (Index p = mParticles.cellBegin(i0, pj); p < end; ++p) {
+                    dist_sq = std::min(dist_sq,
+                                       math::sqr(cx - mParticles.x[p]) +
+                                           math::sqr(cy - mParticles.y[p]));
+                }
+            }
+
+            s(i, j) = std::min(std::sqrt(dist_sq) - cParticleRadius,
+                               cSurfaceFar);
+        }
+    });
+}
+
+void ParticleTransfer::range(const u32 t, Index& begin, Index& end) const {
+    const Size count = mParticles.size();
+    const u32 threads = mPool.size();
+
+    begin = count * t / threads;
+    end = count * (t + 1) / threads;
+}
+
+void ParticleTransfer::gather(Grid& q,
+                              const std::vector<f64>& velocity,
+                              const Vector2D& offset) {
+    mPool.parallelFor(static_cast<u32>(q.ny()), [&](const u32 row) {
+        const i32 j = static_cast<i32>(row);
+        const f64 fy = j + offset[1];
+
+        // Particles within one cell of the face row.
+        const i32 cj0 = std::max(static_cast<i32>(std::floor(fy)) - 1, 0);
+        const i32 cj1 =
+            std::min(static_cast<i32>(std::ceil(fy)), mMac.ny() - 1);
+
+        for (i32 i = 0; i < q.nx(); ++i) {
+            const f64 fx = i + offset[0];
+
+            const i32 ci0 = std::max(static_cast<i32>(std::floor(fx)) - 1, 0);
+            const i32 ci1 =
+                std::min(static_cast<i32>(std::ceil(fx)), mMac.nx() - 1);
+
+            f64 sum = 0.0;
+            f64 weight = 0.0;
+            for (i32 cj = cj0; cj <= cj1; ++cj) {
+                // The cells of a row are contiguous in the particle arrays.
+                const Index end = mParticles.cellEnd(ci1, cj);
+                for (Index p = mParticles.cellBegin(ci0, cj); p < end; ++p) {
+                    const f64 wx = 1.0 - std::fabs(mParticles.x[p] - fx);
+                    const f64 wy = 1.0 - std::fabs(mParticles.y[p] - fy);
+                    if (wx <= 0.0 || wy <= 0.0)
+                        continue;
+
+                    sum += wx * wy * velocity[p];
+                    weight += wx * wy;
+                }
+            }
+
+            q(i, j) = weight > 0.0 ? sum / weight : 0.0;
+        }
+    });
+}
+
+Vector2D ParticleTransfer::velocity(const Vector2D& pos) const {
+    return Vector2D(mMac.u.interp(pos), mMac.v.interp(pos)) / mMac.u.cellSize();
+}
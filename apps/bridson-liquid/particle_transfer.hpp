@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include "grid.hpp"
+#include "mac_grid.hpp"
+#include "particles/particle_set.hpp"
+#include "util/thread_pool.hpp"
+
+/// @brief Transfers between marker particles and the MAC grid for the FLIP/PIC
+/// solver mode. The particles are kept sorted by cell, so grid-side kernels
+/// gather from the particles of neighbouring cells instead of scattering.
+class ParticleTransfer {
+public:
+    ParticleTransfer(MACGrid& mac, ParticleSet& particles, ThreadPool& pool);
+
+    /// @brief Seeds a jittered 2x2 block of particles in every cell where the
+    /// surface level set is negative.
+    void seed();
+
+    /// @brief Sets every grid face to the weighted average of the velocities
+    /// of the particles within one cell of it, with bilinear weights. Faces
+    /// without particles are set to zero. Rows of faces are gathered in
+    /// parallel.
+    void toGrid();
+
+    /// @brief Saves the grid velocity as the reference for the FLIP update.
+    void saveVelocity();
+
+    /// @brief Updates particle velocities from the grid. A `flip_ratio` of 1
+    /// is pure FLIP, which adds the grid velocity change since
+    /// saveVelocity(), and 0 is pure PIC, which takes the new grid velocity.
+    void toParticles(const f64 flip_ratio);
+
+    /// @brief Moves the particles through the grid velocity with second order
+    /// Runge-Kutta, then rebins them. Particles are kept out of the solid
+    /// border.
+    void advect(const f64 dt);
+
+    /// @brief Labels the non-solid cells that hold a particle Fluid.
+    void updateLabels();
+
+    /// @brief Rebuilds the surface level set as the union of particle disks.
+    void updateSurface();
+
+private:
+    /// @brief Radius of the disk around each particle, in cells.
+    static constexpr f64 cParticleRadius = 0.6;
+
+    /// @brief Surface value of cells far from every particle, in cells.
+    static constexpr f64 cSurfaceFar = 3.0;
+
+    /// @brief Half-open particle range handled by thread `t`.
+    void range(const u32 t, Index& begin, Index& end) const;
+
+    /// @brief Gathers particle velocities onto the faces of `q`. The face
+    /// (i, j) lies at (i, j) + `offset` in cell units.
+    void gather(Grid& q,
+                const std::vector<f64>& velocity,
+                const Vector2D& offset);
+
+    /// @brief Velocity at a position in cell units, in cells per unit time.
+    Vector2D velocity(const Vector2D& pos) const;
+
+    MACGrid& mMac;
+    ParticleSet& mParticles;
+    ThreadPool& mPool;
+
+    /// @brief Grid velocity saved by saveVelocity(), for the FLIP update.
+    Grid mOldU;
+    Grid mOldV;
+};
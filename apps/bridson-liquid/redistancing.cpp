@@ -1,92 +1,216 @@
 #include "redistancing.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include "math/numeric.hpp"
+#include "util/memory.hpp"
+
+namespace {
+
+/// @brief Sweep orderings as (di, dj) direction signs.
+constexpr i32 cOrderings[4][2] = {{1, 1}, {-1, 1}, {-1, -1}, {1, -1}};
+
+}
 
-Redistancing::Redistancing(Grid& q, LabelGrid& label)
-    : mQ(q),
-      mCrossings(q),
-      mCrossingsLabels(label),
-      mSdfInit(q),
-      mSsf(q),
-      mBack(q) {
+Redistancing::Redistancing(Grid& q,
+                           ThreadPool& pool,
+                           const u32 sweep_count,
+                           const bool parallel)
+    : mTag(memory::Tag::Redistancing),
+      mQ(q),
+      mPool(pool),
+      mSweepCount(sweep_count),
+      mParallel(parallel),
+      mDist(q.ny(), q.nx(), q.cellCenter(), q.cellSize(), 1),
+      mFixed(q.cellCount(), 0) {
+    assertm(mQ.ghost() > 0, "level set must have a ghost layer");
+
+    mDist.fill(cFar);
+
+    if (mParallel) {
+        mSweeps.reserve(4);
+        for (i32 k = 0; k < 4; ++k) mSweeps.push_back(mDist);
+    }
+
+    mTag.end();
 }
 
 void Redistancing::operator()() {
-    const f64 dist = 2.0;
+    const memory::TagScope tag(memory::Tag::Redistancing);
+
+    // Copying the boundary values into the ghost layer means no crossing is
+    // ever detected across the edge of the grid.
+    mQ.fillGhosts(Boundary::Neumann);
 
-    // Check for interface crossings.
     for (i32 j = 0; j < mQ.ny(); ++j) {
-        for (i32 i = 0; i < mQ.nx(); ++i) {
-            const bool x0_interface =
-                i - 1 >= 0 && (mQ(i, j) >= 0) != (mQ(i - 1, j) >= 0);
+        for (i32 i = 0; i < mQ.nx(); ++i) initialize(i, j);
+    }
 
-            const bool x1_interface =
-                i + 1 < mQ.nx() && (mQ(i, j) >= 0) != (mQ(i + 1, j) >= 0);
+    for (u32 iter = 0; iter < mSweepCount; ++iter) {
+        if (mParallel) {
+            sweepParallel(nullptr);
+        } else {
+            for (const auto& ordering : cOrderings)
+                sweep(mDist, ordering[0], ordering[1]);
+        }
+    }
 
-            const bool y0_interface =
-                j - 1 >= 0 && (mQ(i, j) >= 0) != (mQ(i, j - 1) >= 0);
+    for (i32 j = 0; j < mQ.ny(); ++j) {
+        for (i32 i = 0; i < mQ.nx(); ++i)
+            mQ(i, j) = mQ(i, j) < 0.0 ? -mDist(i, j) : mDist(i, j);
+    }
 
-            const bool y1_interface =
-                j + 1 < mQ.ny() && (mQ(i, j) >= 0) != (mQ(i, j + 1) >= 0);
+    mDist.fill(cFar);
+    for (Grid& dist : mSweeps) dist.fill(cFar);
+}
 
-            if (x0_interface || x1_interface || y0_interface || y1_interface) {
-                mCrossings(i, j) = 1.0;
-                mCrossingsLabels.set(i, j, Label::Fluid);
-            } else {
-                mCrossings(i, j) = 0.0;
-                mCrossingsLabels.set(i, j, Label::Empty);
-            }
+void Redistancing::operator()(const NarrowBand& band) {
+    const memory::TagScope tag(memory::Tag::Redistancing);
+
+    mQ.fillGhosts(Boundary::Neumann);
+
+    for (const auto [i, j] : band.cells()) initialize(i, j);
+
+    for (u32 iter = 0; iter < mSweepCount; ++iter) {
+        if (mParallel) {
+            sweepParallel(&band);
+        } else {
+            for (const auto& ordering : cOrderings)
+                sweep(mDist, band, ordering[0], ordering[1]);
         }
     }
 
-    println("mCrossings\n{}", mCrossings);
-    println("mCrossingsLabels\n{}", mCrossingsLabels);
+    // Cells outside the band were never written, so resetting the band cells
+    // leaves the buffers far everywhere.
+    const f64 width = band.width();
+    for (const auto [i, j] : band.cells()) {
+        const f64 dist = std::min(mDist(i, j), width);
+        mQ(i, j) = mQ(i, j) < 0.0 ? -dist : dist;
+
+        mDist(i, j) = cFar;
+        for (Grid& sweep_dist : mSweeps) sweep_dist(i, j) = cFar;
+    }
+}
+
+void Redistancing::initialize(const i32 i, const i32 j) {
+    const f64 phi = mQ(i, j);
+    const bool inside = phi < 0.0;
+
+    // Fraction of a cell to the zero crossing along each axis.
+    f64 tx = cFar;
+    f64 ty = cFar;
+
+    const f64 x0 = mQ(i - 1, j);
+    const f64 x1 = mQ(i + 1, j);
+    const f64 y0 = mQ(i, j - 1);
+    const f64 y1 = mQ(i, j + 1);
+
+    if ((x0 < 0.0) != inside)
+        tx = std::min(tx, phi / (phi - x0));
+    if ((x1 < 0.0) != inside)
+        tx = std::min(tx, phi / (phi - x1));
+    if ((y0 < 0.0) != inside)
+        ty = std::min(ty, phi / (phi - y0));
+    if ((y1 < 0.0) != inside)
+        ty = std::min(ty, phi / (phi - y1));
+
+    const Index index = j * mQ.nx() + i;
+    if (tx < cFar && ty < cFar) {
+        mDist(i, j) = tx * ty / std::sqrt(tx * tx + ty * ty + 1e-12);
+        mFixed[index] = 1;
+    } else if (tx < cFar || ty < cFar) {
+        mDist(i, j) = std::min(tx, ty);
+        mFixed[index] = 1;
+    } else {
+        mDist(i, j) = cFar;
+        mFixed[index] = 0;
+    }
+}
+
+void Redistancing::relax(Grid& dist, const i32 i, const i32 j) const {
+    if (mFixed[j * dist.nx() + i] != 0)
+        return;
 
-    // Extrapolate the interface crossings.
-    Extrapolation crossings_extrapolation(mCrossings, mCrossingsLabels);
-    crossings_extrapolation(2, mCrossingsLabels);
-    println("mCrossings extrapolated\n{}", mCrossings);
-    println("mCrossingsLabels extrapolated\n{}", mCrossingsLabels);
+    // Godunov upwind solution of |grad d| = 1 with unit spacing.
+    const f64 a = std::min(dist(i - 1, j), dist(i + 1, j));
+    const f64 b = std::min(dist(i, j - 1), dist(i, j + 1));
 
-    // SDF initialization.
-    for (i32 j = 0; j < mQ.ny(); ++j) {
-        for (i32 i = 0; i < mQ.nx(); ++i) {
-            if (mCrossings(i, j) == 0.0)
-                mSdfInit(i, j) = dist * math::signum_ztn(mQ(i, j));
+    f64 d = 0.0;
+    if (math::abs(a - b) >= 1.0)
+        d = std::min(a, b) + 1.0;
+    else
+        d = 0.5 * (a + b + std::sqrt(2.0 - math::sqr(a - b)));
 
-            if (math::abs(mSdfInit(i, j)) > dist)
-                mSdfInit(i, j) = dist * math::signum_ztn(mQ(i, j));
-        }
+    dist(i, j) = std::min(dist(i, j), d);
+}
+
+void Redistancing::sweep(Grid& dist, const i32 di, const i32 dj) const {
+    const i32 nx = dist.nx();
+    const i32 ny = dist.ny();
+
+    const i32 i0 = di > 0 ? 0 : nx - 1;
+    const i32 j0 = dj > 0 ? 0 : ny - 1;
+
+    for (i32 jj = 0, j = j0; jj < ny; ++jj, j += dj) {
+        for (i32 ii = 0, i = i0; ii < nx; ++ii, i += di) relax(dist, i, j);
     }
+}
 
-    // SSF construction.
-    const f64 epsilon = 0.5;
-    for (i32 j = 0; j < mQ.ny(); ++j) {
-        for (i32 i = 0; i < mQ.nx(); ++i) {
-            const f64 phi = mSdfInit(i, j);
-            mSsf(i, j) = phi / (std::sqrt(math::sqr(phi) + math::sqr(epsilon)));
+void Redistancing::sweep(Grid& dist,
+                         const NarrowBand& band,
+                         const i32 di,
+                         const i32 dj) const {
+    const std::vector<NarrowBand::Cell>& cells = band.cells();
+    const i32 ny = band.ny();
+
+    const i32 j0 = dj > 0 ? 0 : ny - 1;
+
+    for (i32 jj = 0, j = j0; jj < ny; ++jj, j += dj) {
+        const Index begin = band.rowBegin(j);
+        const Index end = band.rowEnd(j);
+
+        if (di > 0) {
+            for (Index k = begin; k < end; ++k)
+                relax(dist, cells[k].i, cells[k].j);
+        } else {
+            for (Index k = end; k > begin; --k)
+                relax(dist, cells[k - 1].i, cells[k - 1].j);
         }
     }
+}
 
-    // Iterative level set reinitialization using a semi-implicit relaxation
-    // scheme to enforce the Eikonal equation.
-    const f64 scale = 1.0 / mQ.cellSize();
-    const u32 relax_iter_count = 8;
-    for (u32 iter = 0; iter < relax_iter_count; ++iter) {
-        for (i32 j = 0; j < mQ.ny(); ++j) {
-            for (i32 i = 0; i < mQ.nx(); ++i) {
-                if (mCrossings(i, j) == 1.0) {
-                    const Vector2D grid_pos = Vector2D(i, j) + mQ.cellCenter();
-
-                    const f64 grad_magnitude = mQ.grad(grid_pos).length();
-
-                    mBack(i, j) =
-                        (0.5 * scale * (-mSsf(i, j) * (grad_magnitude - 1.0))) +
-                        mSdfInit(i, j);
-                }
+void Redistancing::sweepParallel(const NarrowBand* band) {
+    mPool.parallelFor(4, [&](const u32 k) {
+        Grid& dist = mSweeps[k];
+
+        if (band == nullptr) {
+            for (i32 j = 0; j < mDist.ny(); ++j) {
+                for (i32 i = 0; i < mDist.nx(); ++i) dist(i, j) = mDist(i, j);
             }
+            sweep(dist, cOrderings[k][0], cOrderings[k][1]);
+        } else {
+            for (const auto [i, j] : band->cells()) dist(i, j) = mDist(i, j);
+            sweep(dist, *band, cOrderings[k][0], cOrderings[k][1]);
         }
-    }
-
-    mQ = mBack;
+    });
+
+    const auto merge = [&](const i32 i, const i32 j) {
+        mDist(i, j) = std::min({mSweeps[0](i, j),
+                                mSweeps[1](i, j),
+                                mSweeps[2](i, j),
+                                mSweeps[3](i, j)});
+    };
+
+    mPool.parallelFor(static_cast<u32>(mDist.ny()), [&](const u32 row) {
+        const i32 j = static_cast<i32>(row);
+
+        if (band == nullptr) {
+            for (i32 i = 0; i < mDist.nx(); ++i) merge(i, j);
+        } else {
+            const std::vector<NarrowBand::Cell>& cells = band->cells();
+            for (Index k = band->rowBegin(j); k < band->rowEnd(j); ++k)
+                merge(cells[k].i, cells[k].j);
+        }
+    });
 }
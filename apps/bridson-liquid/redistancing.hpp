@@ -1,34 +1,82 @@
 #pragma once
 
-#include "extrapolation.hpp"
+#include <vector>
+
 #include "grid.hpp"
-#include "label_grid.hpp"
+#include "narrow_band.hpp"
+#include "util/memory.hpp"
+#include "util/thread_pool.hpp"
 
+/// @brief Restores the signed distance property of a level set with the fast
+/// sweeping method. Distances are measured in cells, like the initial level
+/// set.
 class Redistancing {
 public:
-    Redistancing(Grid& q, LabelGrid& label);
+    /// @param q Level set with at least one ghost layer.
+    /// @param pool Threads used by the parallel sweep mode.
+    /// @param sweep_count Number of rounds of the four sweep orderings.
+    /// @param parallel Runs the four orderings of a round concurrently on
+    /// separate copies and keeps the minimum, instead of one after the other.
+    Redistancing(Grid& q,
+                 ThreadPool& pool,
+                 const u32 sweep_count,
+                 const bool parallel);
 
     ~Redistancing() = default;
 
     /// @brief Redistance the level set.
     void operator()();
 
+    /// @brief Redistance the level set within the narrow band. Cells outside
+    /// the band are treated as far away and left untouched.
+    void operator()(const NarrowBand& band);
+
 private:
+    /// @brief Distance of cells that have not been reached yet. Finite so
+    /// the Eikonal update never sees inf - inf. Every cell of mDist and
+    /// mSweeps holds this value between calls.
+    static constexpr f64 cFar = 1.0e6;
+
+    /// @brief Fixes the distance of a cell next to the interface from the
+    /// linearly interpolated zero crossings. Every other cell starts far.
+    void initialize(const i32 i, const i32 j);
+
+    /// @brief Applies the upwind Eikonal update to cell (i, j) of `dist`.
+    void relax(Grid& dist, const i32 i, const i32 j) const;
+
+    /// @brief Gauss-Seidel sweep over `dist` in the order given by the
+    /// direction signs `di` and `dj`.
+    void sweep(Grid& dist, const i32 di, const i32 dj) const;
+
+    /// @brief Gauss-Seidel sweep over the band cells of `dist`.
+    void sweep(Grid& dist,
+               const NarrowBand& band,
+               const i32 di,
+               const i32 dj) const;
+
+    /// @brief Runs one round of the four sweep orderings in parallel. Sweeps
+    /// the whole grid when `band` is null.
+    void sweepParallel(const NarrowBand* band);
+
+    /// @brief Tags the allocations of the members below while they are
+    /// built.
+    memory::TagScope mTag;
+
     /// @brief Grid representation of a level set.
     Grid& mQ;
 
-    /// @brief SDF crossings.
-    Grid mCrossings;
+    ThreadPool& mPool;
 
-    /// @brief Label grid for extrapolation over SDF crossings.
-    LabelGrid mCrossingsLabels;
+    u32 mSweepCount;
+    bool mParallel;
 
-    /// @brief SDF coarse initialization.
-    Grid mSdfInit;
+    /// @brief Unsigned distance to the interface. The ghost layer stays far,
+    /// so sweeps need no bounds checks.
+    Grid mDist;
 
-    /// @brief Smooth sign function (SSF).
-    Grid mSsf;
+    /// @brief Per-ordering copies of mDist for the parallel mode.
+    std::vector<Grid> mSweeps;
 
-    /// @brief Back buffer for the field grid.
-    Grid mBack;
+    /// @brief Marks interface cells, whose distances are never updated.
+    std::vector<u8, memory::Allocator<u8>> mFixed;
 };
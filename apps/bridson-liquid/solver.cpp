@@ -1,15 +1,65 @@
 #include "solver.hpp"
 
+#include <cstdio>
+#include <cstring>
+
+#include "io/mapped_file.hpp"
+#include "util/log.hpp"
+#include "util/metrics.hpp"
+#include "util/profiler.hpp"
+
+namespace {
+
+/// @brief Identifies a checkpoint file.
+constexpr char cCheckpointMagic[8] = {'L', 'I', 'Q', 'C', 'K', 'P', 'T', '\0'};
+
+/// @brief Reads the checkpoint header. The simulation parameters are read into
+/// `config`.
+bool readHeader(BinaryReader& in,
+                const u32 version,
+                u64& step_count,
+                Config& config) {
+    char magic[sizeof(cCheckpointMagic)];
+    u32 file_version;
+    if (!in.read(magic, sizeof(magic)) || !in.read(file_version))
+        return false;
+
+    if (std::memcmp(magic, cCheckpointMagic, sizeof(magic)) != 0) {
+        Log::e("Not a checkpoint file");
+        return false;
+    }
+    if (file_version != version) {
+        Log::e("Unsupported checkpoint version {}", file_version);
+        return false;
+    }
+
+    return in.read(step_count) && config.read(in);
+}
+
+}
+
 Solver::Solver(const Config& config)
-    : mMac(config.rows, config.cols, config.cellSize),
+    : mConfig(config),
+      mStepCount(0),
+      mMac(config.rows, config.cols, config.cellSize),
       mTimestep(config.timestep),
+      mCflBand(config.cflBand),
+      mPool(config.threads),
       mExtrapolateU(mMac.u, mMac.label),
       mExtrapolateV(mMac.v, mMac.label),
+      mNarrowBand(config.narrowBand),
+      mBand(mMac.nx(), mMac.ny(), config.bandWidth),
       mAdvectSurface(mMac.s, mMac.u, mMac.v, mMac.label),
-      mRedistanceSurface(mMac.s, mMac.label),
+      mRedistanceSurface(mMac.s,
+                         mPool,
+                         config.redistanceSweeps,
+                         config.parallelRedistancing),
       mAdvectU(mMac.u, mMac.u, mMac.v, mMac.label),
       mAdvectV(mMac.v, mMac.u, mMac.v, mMac.label),
-      mProject(mMac) {
+      mProject(mMac),
+      mMode(config.mode),
+      mFlipRatio(config.flipRatio),
+      mTransfer(mMac, mParticles, mPool) {
     const f64 r = 3.0;
     for (i32 j = 0; j < mMac.ny(); ++j) {
         for (i32 i = 0; i < mMac.nx(); ++i) {
@@ -19,16 +69,154 @@ Solver::Solver(const Config& config)
             mMac.s(i, j) = d - r;
         }
     }
+
+    if (mNarrowBand)
+        mBand.rebuild(mMac.s);
+
+    if (mMode == SolverMode::Flip) {
+        mTransfer.seed();
+        mTransfer.updateLabels();
+        mTransfer.updateSurface();
+    }
 }
 
 void Solver::step() {
+    PROFILE_SCOPE("step");
+
+    switch (mMode) {
+    case SolverMode::LevelSet:
+        stepLevelSet();
+        break;
+    case SolverMode::Flip:
+        stepFlip();
+        break;
+    default:
+        unreachable;
+    }
+
+    ++mStepCount;
+
+    if (Metrics::enabled())
+        publishMetrics();
+}
+
+u64 Solver::stepCount() const {
+    return mStepCount;
+}
+
+bool Solver::save(const std::string& path) const {
+    const std::string temp_path = path + ".tmp";
+
+    BinaryWriter out(temp_path);
+    out.write(cCheckpointMagic, sizeof(cCheckpointMagic));
+    out.write(cCheckpointVersion);
+    out.write(mStepCount);
+    mConfig.write(out);
+
+    mMac.u.write(out);
+    mMac.v.write(out);
+    mMac.p.write(out);
+    mMac.s.write(out);
+
+    if (mNarrowBand)
+        mBand.write(out);
+
+    if (mMode == SolverMode::Flip) {
+        const Size count = mParticles.size();
+        out.write(static_cast<u64>(count));
+        out.write(mParticles.x.data(), count * sizeof(f64));
+        out.write(mParticles.y.data(), count * sizeof(f64));
+        out.write(mParticles.u.data(), count * sizeof(f64));
+        out.write(mParticles.v.data(), count * sizeof(f64));
+    }
+
+    if (!out.close() || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        Log::e("Failed to write checkpoint {}", path);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool Solver::load(const std::string& path) {
+    const MappedFile file(path);
+    if (!file.isOpen())
+        return false;
+
+    BinaryReader in(file.data(), file.size());
+
+    u64 step_count;
+    Config saved = mConfig;
+    if (!readHeader(in, cCheckpointVersion, step_count, saved))
+        return false;
+
+    if (saved.rows != mConfig.rows || saved.cols != mConfig.cols ||
+        saved.mode != mConfig.mode || saved.narrowBand != mConfig.narrowBand ||
+        saved.bandWidth != mConfig.bandWidth) {
+        Log::e("Checkpoint {} does not match the solver configuration", path);
+        return false;
+    }
+
+    bool ok = mMac.u.read(in) && mMac.v.read(in) && mMac.p.read(in) &&
+              mMac.s.read(in);
+
+    if (ok && mNarrowBand)
+        ok = mBand.read(in);
+
+    if (ok && mMode == SolverMode::Flip) {
+        u64 count;
+        ok = in.read(count) && count <= in.remaining() / (4 * sizeof(f64));
+        if (ok) {
+            mParticles.x.resize(count);
+            mParticles.y.resize(count);
+            mParticles.u.resize(count);
+            mParticles.v.resize(count);
+            ok = in.read(mParticles.x.data(), count * sizeof(f64)) &&
+                 in.read(mParticles.y.data(), count * sizeof(f64)) &&
+                 in.read(mParticles.u.data(), count * sizeof(f64)) &&
+                 in.read(mParticles.v.data(), count * sizeof(f64));
+        }
+    }
+
+    if (!ok) {
+        Log::e("Checkpoint {} is truncated or corrupt", path);
+        return false;
+    }
+
+    // The particles were saved in cell order, so rebinning keeps their order.
+    if (mMode == SolverMode::Flip) {
+        mParticles.rebin(mMac.nx(), mMac.ny(), mPool);
+        mTransfer.updateLabels();
+    } else {
+        mMac.updateLabels();
+    }
+
+    mStepCount = step_count;
+    return true;
+}
+
+bool Solver::readConfig(const std::string& path, Config& config) {
+    const MappedFile file(path);
+    if (!file.isOpen())
+        return false;
+
+    BinaryReader in(file.data(), file.size());
+
+    u64 step_count;
+    return readHeader(in, cCheckpointVersion, step_count, config);
+}
+
+void Solver::stepLevelSet() {
     // See Page 20.
 
     // 1. Advect surface level set and velocity.
-    mMac.updateLabels();
+    {
+        PROFILE_SCOPE("labels");
+        mMac.updateLabels();
+    }
 
-    mExtrapolateU(mMac.label);
-    mExtrapolateV(mMac.label);
+    extrapolateVelocity();
 
     advect();
 
@@ -39,7 +227,7 @@ void Solver::step() {
     //     println("");
     // }
 
-    // mRedistanceSurface();
+    redistance();
 
     // 2. Add external forces.
 
@@ -52,6 +240,53 @@ void Solver::step() {
     // project();
 }
 
+void Solver::stepFlip() {
+    // 1. Move the particles through the extrapolated grid velocity, then
+    // rebuild the labels and surface from their new positions.
+    {
+        PROFILE_SCOPE("particle advect");
+        mTransfer.advect(mTimestep);
+    }
+    {
+        PROFILE_SCOPE("labels");
+        mTransfer.updateLabels();
+        mTransfer.updateSurface();
+    }
+
+    // 2. Transfer particle velocities to the grid and keep a copy for the
+    // FLIP update.
+    {
+        PROFILE_SCOPE("to grid");
+        mTransfer.toGrid();
+    }
+    extrapolateVelocity();
+    mTransfer.saveVelocity();
+
+    // 3. Add external forces and project.
+    addForces();
+    project();
+
+    // 4. Transfer the velocity change back to the particles.
+    extrapolateVelocity();
+    {
+        PROFILE_SCOPE("to particles");
+        mTransfer.toParticles(mFlipRatio);
+    }
+}
+
+void Solver::extrapolateVelocity() {
+    PROFILE_SCOPE("extrapolate");
+
+    if (mCflBand) {
+        const u32 depth = mMac.extrapolationDepth(mTimestep);
+        mExtrapolateU(depth, mMac.label);
+        mExtrapolateV(depth, mMac.label);
+    } else {
+        mExtrapolateU(mMac.label);
+        mExtrapolateV(mMac.label);
+    }
+}
+
 const Grid& Solver::surface() const {
     return mMac.s;
 }
@@ -68,13 +303,44 @@ const Grid& Solver::v() const {
     return mMac.v;
 }
 
+Size Solver::cgIterations() const {
+    return mProject.iterations();
+}
+
+void Solver::publishMetrics() const {
+    const f64 speed = mMac.maxSpeed();
+
+    Metrics::StepSample sample;
+    sample.cgIterations = mProject.iterations();
+    sample.cgResidual = mProject.residual();
+    sample.fluidCells = mProject.fluidCount();
+    sample.maxVelocity = speed;
+    sample.cfl = speed * mTimestep / mMac.cellSize();
+    Metrics::step(sample);
+}
+
+u32 Solver::threads() const {
+    return mPool.size();
+}
+
 const LabelGrid& Solver::label() const {
     return mMac.label;
 }
 
+const ParticleSet& Solver::particles() const {
+    return mParticles;
+}
+
 void Solver::advect() {
-    mAdvectSurface(mTimestep);
-    mAdvectSurface.swap();
+    PROFILE_SCOPE("advect");
+
+    if (mNarrowBand) {
+        mAdvectSurface(mTimestep, mBand);
+        mAdvectSurface.swap(mBand);
+    } else {
+        mAdvectSurface(mTimestep);
+        mAdvectSurface.swap();
+    }
 
     mAdvectU(mTimestep);
     mAdvectV(mTimestep);
@@ -83,7 +349,28 @@ void Solver::advect() {
     mAdvectV.swap();
 }
 
+void Solver::redistance() {
+    PROFILE_SCOPE("redistance");
+
+    if (!mNarrowBand) {
+        mRedistanceSurface();
+        return;
+    }
+
+    mRedistanceSurface(mBand);
+
+    // Once the interface nears the edge of the band, the clamped values
+    // outside it are no longer far enough away. Redistance everywhere and
+    // collect a fresh band around the interface.
+    if (mBand.needsRebuild(mMac.s)) {
+        mRedistanceSurface();
+        mBand.rebuild(mMac.s);
+    }
+}
+
 void Solver::addForces() {
+    PROFILE_SCOPE("forces");
+
     // const Vector2D pos(0.45, 0.2);
     // const Vector2D size(0.1, 0.01);
     // const float d = 1.0;
@@ -103,5 +390,7 @@ void Solver::addForces() {
 }
 
 void Solver::project() {
+    PROFILE_SCOPE("project");
+
     mProject(mTimestep);
 }
@@ -1,12 +1,17 @@
 #pragma once
 
+#include <string>
+
 #include "advection.hpp"
 #include "config.hpp"
 #include "extrapolation.hpp"
 #include "grid.hpp"
 #include "mac_grid.hpp"
+#include "narrow_band.hpp"
+#include "particle_transfer.hpp"
 #include "projection.hpp"
 #include "redistancing.hpp"
+#include "util/thread_pool.hpp"
 
 class Solver {
 public:
@@ -16,6 +21,25 @@ public:
     /// @brief Updates the solver by mTimestep.
     void step();
 
+    /// @brief Number of steps taken since the initial conditions, including
+    /// those taken before the checkpoint the solver was restored from.
+    u64 stepCount() const;
+
+    /// @brief Writes a checkpoint of the solver state to `path`. The file is
+    /// written next to `path` and renamed over it, so an interrupted save
+    /// keeps the previous checkpoint.
+    bool save(const std::string& path) const;
+
+    /// @brief Restores the solver state from a checkpoint written by save().
+    /// The grid size, mode and narrow band settings must match the solver.
+    /// Labels are rebuilt from the restored state. A truncated file may leave
+    /// the solver partially restored.
+    bool load(const std::string& path);
+
+    /// @brief Reads the simulation parameters of the checkpoint at `path`
+    /// into `config`, so a matching solver can be created before load().
+    static bool readConfig(const std::string& path, Config& config);
+
     /// @brief Retrieve a constant reference to the surface level set.
     const Grid& surface() const;
 
@@ -28,13 +52,38 @@ public:
     /// @brief Retrieve a constant reference to the velocity v component grid.
     const Grid& v() const;
 
+    /// @brief Number of CG iterations taken by the last pressure solve.
+    Size cgIterations() const;
+
+    /// @brief Number of threads the solver runs on.
+    u32 threads() const;
+
     /// @brief Retrieve a constant reference to the label grid.
     const LabelGrid& label() const;
 
+    /// @brief Retrieve a constant reference to the marker particles. Empty
+    /// unless the solver runs in FLIP/PIC mode.
+    const ParticleSet& particles() const;
+
 private:
+    /// @brief Level set step. The surface is advected on the grid.
+    void stepLevelSet();
+
+    /// @brief FLIP/PIC step. Marker particles carry the velocity and define
+    /// the labels and surface.
+    void stepFlip();
+
+    /// @brief Extrapolates the velocity into empty cells, up to the CFL band
+    /// if enabled.
+    void extrapolateVelocity();
+
     /// @brief Advects the surface and velocity through the velocity grid.
     void advect();
 
+    /// @brief Redistances the surface level set, within the narrow band if
+    /// enabled.
+    void redistance();
+
     /// @brief Adds external forces.
     void addForces();
 
@@ -42,18 +91,44 @@ private:
     /// divergence free and enforces solid wall boundary conditions.
     void project();
 
+    /// @brief Publishes the state after a step to the metrics exporter.
+    void publishMetrics() const;
+
+    /// @brief Checkpoint format version. Bumped whenever the layout changes.
+    static constexpr u32 cCheckpointVersion = 1;
+
+    /// @brief Configuration the solver was created with, written to
+    /// checkpoints.
+    Config mConfig;
+
+    /// @brief Number of steps taken.
+    u64 mStepCount;
+
     /// @brief MAC grid used by this solver.
     MACGrid mMac;
 
     /// @brief Timestep that the solver is advanced by each step.
     f64 mTimestep;
 
+    /// @brief Whether velocity extrapolation stops at the CFL band.
+    bool mCflBand;
+
+    /// @brief Worker threads shared by the solver stages.
+    ThreadPool mPool;
+
     /// @brief Extrapolation of U.
     Extrapolation mExtrapolateU;
 
     /// @brief Extrapolation of V.
     Extrapolation mExtrapolateV;
 
+    /// @brief Whether the surface is advected and redistanced only within
+    /// mBand.
+    bool mNarrowBand;
+
+    /// @brief Active cells of the surface level set.
+    NarrowBand mBand;
+
     /// @brief Advection over surface level set.
     Advection mAdvectSurface;
 
@@ -68,4 +143,16 @@ private:
 
     /// @brief Pressure projection and solid boundary enforcement.
     Projection mProject;
+
+    /// @brief Surface tracking scheme.
+    SolverMode mMode;
+
+    /// @brief FLIP fraction of the particle velocity update.
+    f64 mFlipRatio;
+
+    /// @brief Marker particles of the FLIP/PIC mode.
+    ParticleSet mParticles;
+
+    /// @brief Particle-grid transfers of the FLIP/PIC mode.
+    ParticleTransfer mTransfer;
 };
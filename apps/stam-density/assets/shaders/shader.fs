@@ -6,5 +6,6 @@ in vec2 TexCoord;
 uniform sampler2D sampler;
 
 void main() {
-    FragColor = texture(sampler, TexCoord, 1.0);
+    float d = clamp(texture(sampler, TexCoord, 1.0).r, 0.0, 1.0);
+    FragColor = vec4(vec3(d), 1.0);
 }
@@ -1,59 +1,61 @@
 #pragma once
 
+#include <vector>
+
 #include "util/common.hpp"
+#include "util/format.hpp"
+#include "util/memory.hpp"
+
+namespace stam {
 
-template <u32 N>
+/// @brief Square grid of `n` by `n` cells surrounded by a layer of boundary
+/// cells, so rows and columns run from 0 to `n + 1`.
 class Grid {
 public:
-    Grid() {
-        for (Index i = 0; i < sSize; ++i) mValues[i] = 0.0f;
-    }
-
-    Grid(Grid<N>&& other) {
-        mValues = std::move(other.mValues);
+    explicit Grid(const u32 n) : mDim(n + 2), mValues(mDim * mDim, 0.0f) {
     }
 
-    ~Grid() = default;
-
-    Grid& operator=(Grid<N>&& other) {
-        mValues = std::move(other.mValues);
-        return *this;
+    /// @brief Number of interior cells per side.
+    u32 n() const {
+        return mDim - 2;
     }
 
     f32 operator()(const Index row, const Index col) const {
-        return mValues[row * sDim + col];
+        return mValues[row * mDim + col];
     }
 
     f32& operator()(const Index row, const Index col) {
-        return mValues[row * sDim + col];
+        return mValues[row * mDim + col];
     }
 
     void fill(f32 value) {
-        for (Index i = 0; i < sSize; ++i) mValues[i] = value;
+        for (f32& v : mValues) v = value;
     }
 
 private:
-    static constexpr u32 sDim = N + 2;
-    static constexpr u32 sSize = sDim * sDim;
-    std::array<f32, sSize> mValues;
+    u32 mDim;
+    std::vector<f32, memory::Allocator<f32>> mValues;
 };
 
-template <u32 N>
-struct FormatWriter<Grid<N>> {
-    static void write(const Grid<N>& grid, StringBuffer& sb) {
+}
+
+template <>
+struct FormatWriter<stam::Grid> {
+    static void write(const stam::Grid& grid, StringBuffer& sb) {
+        const Index dim = grid.n() + 2;
         sb.putSafe('[');
-        for (Index row = 0; row < N + 2; ++row) {
+        for (Index row = 0; row < dim; ++row) {
             sb.putSafe('[');
-            for (Index col = 0; col < N + 2; ++col) {
+            for (Index col = 0; col < dim; ++col) {
                 FormatWriter<f32>::write(grid(row, col), sb);
-                if (col < N + 1)
+                if (col < dim - 1)
                     sb.putSafe(',');
             }
             sb.putSafe(']');
-            if (row < N + 1)
+            if (row < dim - 1)
                 sb.putSafe('\n');
             else
-                sb.putSafe('[');
+                sb.putSafe(']');
         }
     }
 };
@@ -1,6 +1,18 @@
 #include "stam_density.hpp"
 
-int main() {
-    StamDensity::launch<StamDensity>(
-        800, 600, "Density fluid solver (Stam)", 60.0f, "apps/stam-density");
+int main(int argc, char** argv) {
+    const RunOptions options = RunOptions::parse(argc, argv);
+    Application::startServices(options);
+
+    if (options.headless.enabled) {
+        StamDensity::runHeadless(options.headless, "apps/stam-density");
+    } else {
+        StamDensity::launch<StamDensity>(800,
+                                         600,
+                                         "Density fluid solver (Stam)",
+                                         60.0f,
+                                         "apps/stam-density");
+    }
+
+    Application::finishServices();
 }
@@ -0,0 +1,287 @@
+#include "solver.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "math/numeric.hpp"
+#include "util/metrics.hpp"
+#include "util/profiler.hpp"
+
+namespace stam {
+
+namespace {
+
+/// @brief Moves a cell towards its Gauss-Seidel update by the weight `w`.
+void relaxCell(Grid& x,
+               const Grid& x0,
+               const f32 a,
+               const f32 c,
+               const f32 w,
+               const Index row,
+               const Index col) {
+    const f32 neighbours = x(row, col - 1) + x(row, col + 1) +
+                           x(row - 1, col) + x(row + 1, col);
+    const f32 gs = (x0(row, col) + a * neighbours) / c;
+    x(row, col) = (1.0f - w) * x(row, col) + w * gs;
+}
+
+}
+
+Solver::Solver(const u32 n, ThreadPool& pool)
+    : mN(n),
+      mH(1.0f / static_cast<f32>(n)),
+      mPool(pool),
+      mU(n),
+      mV(n),
+      mUPrev(n),
+      mVPrev(n),
+      mDensity(n),
+      mDensityPrev(n),
+      mGaussSeidelIterations(0),
+      mRedBlack(false),
+      mRelaxation(1.0f) {
+}
+
+u32 Solver::n() const {
+    return mN;
+}
+
+const Grid& Solver::u() const {
+    return mU;
+}
+
+const Grid& Solver::v() const {
+    return mV;
+}
+
+const Grid& Solver::density() const {
+    return mDensity;
+}
+
+void Solver::step(const f32 timestep,
+                  const f32 viscosity,
+                  const f32 diffusion) {
+    PROFILE_SCOPE("step");
+
+    stepVelocity(mU, mV, mUPrev, mVPrev, viscosity, timestep);
+    stepDensity(mDensity, mDensityPrev, mU, mV, diffusion, timestep);
+
+    if (Metrics::enabled())
+        publishMetrics(timestep);
+}
+
+void Solver::reset() {
+    mUPrev.fill(0.0f);
+    mVPrev.fill(0.0f);
+    mDensityPrev.fill(0.0f);
+}
+
+void Solver::init(const u32 gauss_seidel_iterations,
+                  const bool red_black,
+                  const f32 relaxation) {
+    assertm(relaxation > 0.0f && relaxation < 2.0f,
+            "relaxation weight must be in (0, 2)");
+    mGaussSeidelIterations = gauss_seidel_iterations;
+    mRedBlack = red_black;
+    mRelaxation = relaxation;
+}
+
+void Solver::addDensity(const Index row, const Index col, const f32 d) {
+    if (row > mN + 1 || col > mN + 1)
+        return;
+    mDensity(row, col) += d;
+}
+
+void Solver::addVelocity(const Index row,
+                         const Index col,
+                         const Vector2F& v) {
+    if (row > mN + 1 || col > mN + 1)
+        return;
+    mU(row, col) = v[0];
+    mV(row, col) = v[1];
+}
+
+void Solver::publishMetrics(const f32 dt) const {
+    f32 speed = 0.0f;
+    for (Index row = 1; row <= mN; ++row) {
+        for (Index col = 1; col <= mN; ++col)
+            speed = std::max({speed,
+                              std::abs(mU(row, col)),
+                              std::abs(mV(row, col))});
+    }
+
+    // Gauss-Seidel is used rather than CG, so no iterations are reported.
+    Metrics::StepSample sample;
+    sample.fluidCells = static_cast<u64>(mN) * mN;
+    sample.maxVelocity = speed;
+    sample.cfl = speed * dt * mN;
+    Metrics::step(sample);
+}
+
+void Solver::stepDensity(Grid& x,
+                         Grid& x0,
+                         Grid& u,
+                         Grid& v,
+                         const f32 diffusion,
+                         const f32 dt) {
+    addSource(x, x0, dt);
+    std::swap(x, x0);
+    diffuse(0, x, x0, diffusion, dt);
+    std::swap(x, x0);
+    advect(0, x, x0, u, v, dt);
+}
+
+void Solver::stepVelocity(Grid& u,
+                          Grid& v,
+                          Grid& u0,
+                          Grid& v0,
+                          const f32 viscosity,
+                          const f32 dt) {
+    addSource(u, u0, dt);
+    addSource(v, v0, dt);
+
+    std::swap(u0, u);
+    diffuse(1, u, u0, viscosity, dt);
+
+    std::swap(v0, v);
+    diffuse(2, v, v0, viscosity, dt);
+
+    project(u, v, u0, v0);
+
+    std::swap(u0, u);
+    std::swap(v0, v);
+
+    advect(1, u, u0, u0, v0, dt);
+    advect(2, v, v0, u0, v0, dt);
+
+    project(u, v, u0, v0);
+}
+
+void Solver::addSource(Grid& x, Grid& s, const f32 dt) {
+    for (Index row = 0; row <= mN + 1; ++row)
+        for (Index col = 0; col <= mN + 1; ++col)
+            x(row, col) += dt * s(row, col);
+}
+
+void Solver::diffuse(
+    const u32 b, Grid& x, Grid& x0, const f32 diffusion, const f32 dt) {
+    PROFILE_SCOPE("diffuse");
+
+    const f32 a = dt * diffusion * mN * mN;
+    linearSolve(b, x, x0, a, 1.0f + 4.0f * a);
+}
+
+void Solver::advect(
+    const u32 b, Grid& d, Grid& d0, Grid& u, Grid& v, const f32 dt) {
+    PROFILE_SCOPE("advect");
+
+    const f32 dt0 = dt * mN;
+    const f32 max = mN + 0.5f;
+    forRows([&](const Index row_begin, const Index row_end) {
+        for (Index row = row_begin; row < row_end; ++row) {
+            for (Index col = 1; col <= mN; ++col) {
+                const f32 x = math::clamp(
+                    static_cast<f32>(col) - dt0 * u(row, col), 0.5f, max);
+                const Index col0 = static_cast<Index>(x);
+                const Index col1 = col0 + 1;
+
+                const f32 y = math::clamp(
+                    static_cast<f32>(row) - dt0 * v(row, col), 0.5f, max);
+                const Index row0 = static_cast<Index>(y);
+                const Index row1 = row0 + 1;
+
+                const f32 t = 1.0f - (y - static_cast<f32>(row0));
+                const f32 s = 1.0f - (x - static_cast<f32>(col0));
+
+                d(row, col) = math::lerp(
+                    s,
+                    math::lerp(t, d0(row0, col0), d0(row1, col0)),
+                    math::lerp(t, d0(row0, col1), d0(row1, col1)));
+            }
+        }
+    });
+    setBoundary(b, d);
+}
+
+void Solver::project(Grid& u, Grid& v, Grid& p, Grid& div) {
+    PROFILE_SCOPE("project");
+
+    forRows([&](const Index row_begin, const Index row_end) {
+        for (Index row = row_begin; row < row_end; ++row) {
+            for (Index col = 1; col <= mN; ++col) {
+                div(row, col) = -0.5 * mH *
+                                (u(row, col + 1) - u(row, col - 1) +
+                                 v(row + 1, col) - v(row - 1, col));
+                p(row, col) = 0.0f;
+            }
+        }
+    });
+    setBoundary(0, div);
+    setBoundary(0, p);
+
+    linearSolve(0, p, div, 1.0f, 4.0f);
+
+    forRows([&](const Index row_begin, const Index row_end) {
+        for (Index row = row_begin; row < row_end; ++row) {
+            for (Index col = 1; col <= mN; ++col) {
+                u(row, col) -= 0.5 * (p(row, col + 1) - p(row, col - 1)) / mH;
+                v(row, col) -= 0.5 * (p(row + 1, col) - p(row - 1, col)) / mH;
+            }
+        }
+    });
+    setBoundary(1, u);
+    setBoundary(2, v);
+}
+
+void Solver::linearSolve(
+    const u32 b, Grid& x, const Grid& x0, const f32 a, const f32 c) {
+    for (Index k = 0; k < mGaussSeidelIterations; ++k) {
+        if (mRedBlack) {
+            // A cell only reads neighbours of the other color, so the rows of
+            // a half-sweep can be relaxed in any order.
+            for (u32 color = 0; color < 2; ++color) {
+                forRows([&](const Index row_begin, const Index row_end) {
+                    relaxColor(x, x0, a, c, color, row_begin, row_end);
+                });
+            }
+        } else {
+            for (Index row = 1; row <= mN; ++row) {
+                for (Index col = 1; col <= mN; ++col)
+                    relaxCell(x, x0, a, c, mRelaxation, row, col);
+            }
+        }
+        setBoundary(b, x);
+    }
+}
+
+void Solver::relaxColor(Grid& x,
+                        const Grid& x0,
+                        const f32 a,
+                        const f32 c,
+                        const u32 color,
+                        const Index row_begin,
+                        const Index row_end) {
+    for (Index row = row_begin; row < row_end; ++row) {
+        // First column of the row whose row + col parity matches the color.
+        for (Index col = 1 + ((row + 1 + color) & 1); col <= mN; col += 2)
+            relaxCell(x, x0, a, c, mRelaxation, row, col);
+    }
+}
+
+void Solver::setBoundary(const u32 b, Grid& x) {
+    const Index n = mN;
+    for (Index i = 1; i <= n; ++i) {
+        x(i, 0) = b == 1 ? -x(i, 1) : x(i, 1);
+        x(i, n + 1) = b == 1 ? -x(i, n) : x(i, n);
+        x(0, i) = b == 2 ? -x(1, i) : x(1, i);
+        x(n + 1, i) = b == 2 ? -x(n, i) : x(n, i);
+    }
+
+    x(0, 0) = 0.5 * (x(0, 1) + x(1, 0));
+    x(n + 1, 0) = 0.5 * (x(n + 1, 1) + x(n, 0));
+    x(0, n + 1) = 0.5 * (x(0, n) + x(1, n + 1));
+    x(n + 1, n + 1) = 0.5 * (x(n + 1, n) + x(n, n + 1));
+}
+
+}
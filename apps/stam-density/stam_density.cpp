@@ -1,21 +1,17 @@
 #include "stam_density.hpp"
 
+#include <memory>
+
 #include "quad.hpp"
 #include "util/files.hpp"
 
-StamDensity::StamDensity() : mTexData(N * N * 3) {
+StamDensity::StamDensity() {
 }
 
 void StamDensity::init() {
     glfwSetInputMode(mWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
-    files::Json config = files::read_to_json(asset("config.json").c_str());
-    mConfig.timestep = config["timestep"];
-    mConfig.viscosity = config["viscosity"];
-    mConfig.diffusion = config["diffusion_rate"];
-    mConfig.gaussSeidelIterations = config["gauss_seidel_iterations"];
-    mConfig.densityIncrement = config["density_increment"];
-    mConfig.forceMultiplier = config["force_multiplier"];
+    mConfig = loadConfig(asset("config.json"));
 
     // Shader program
     std::string vertex_shader =
@@ -45,48 +41,44 @@ void StamDensity::init() {
     mQuadMesh = Quad();
 
     // Solver
-    mSolver.init(mConfig.gaussSeidelIterations);
+    mPool = std::make_unique<ThreadPool>(mConfig.threads);
+    mSolver = std::make_unique<stam::Solver>(mConfig.gridSize, *mPool);
+    mSolver->init(mConfig.gaussSeidelIterations,
+                  mConfig.redBlack,
+                  mConfig.relaxation);
 
     // Texture
+    mTexture.allocate(mConfig.gridSize, mConfig.gridSize);
     mProgram.setUniform<i32>("sampler", 0);
 }
 
 void StamDensity::update() {
-    mSolver.reset();
+    const u32 n = mConfig.gridSize;
+    mSolver->reset();
 
     if (mMouseButtons[GLFW_MOUSE_BUTTON_RIGHT]) {
-        const Index col = mMousePos[0] / static_cast<f32>(mWindowWidth) * N;
+        const Index col = mMousePos[0] / static_cast<f32>(mWindowWidth) * n;
         const Index row =
-            N - mMousePos[1] / static_cast<f32>(mWindowHeight) * N;
-        mSolver.addDensity(row, col, mConfig.densityIncrement);
+            n - mMousePos[1] / static_cast<f32>(mWindowHeight) * n;
+        mSolver->addDensity(row, col, mConfig.densityIncrement);
     }
 
     if (mMouseButtons[GLFW_MOUSE_BUTTON_LEFT]) {
         const Vector2F force = Vector2F(mMousePos[0] - mPrevMousePos[0],
                                         mPrevMousePos[1] - mMousePos[1]) *
                                mConfig.forceMultiplier;
-        const Index col = mMousePos[0] / static_cast<f32>(mWindowWidth) * N;
+        const Index col = mMousePos[0] / static_cast<f32>(mWindowWidth) * n;
         const Index row =
-            N - mMousePos[1] / static_cast<f32>(mWindowHeight) * N;
-        mSolver.addVelocity(row, col, force);
+            n - mMousePos[1] / static_cast<f32>(mWindowHeight) * n;
+        mSolver->addVelocity(row, col, force);
     }
 
-    for (Index row = 1; row <= N; ++row) {
-        for (Index col = 1; col <= N; ++col) {
-            const Index i = (row - 1) * N + (col - 1);
-            GLubyte d = static_cast<GLubyte>(
-                math::clamp(mSolver.density()(row, col), 0.0f, 1.0f) * 255.0f);
-            mTexData[i * 3] = static_cast<GLubyte>(d);
-            mTexData[i * 3 + 1] = static_cast<GLubyte>(d);
-            mTexData[i * 3 + 2] = static_cast<GLubyte>(d);
-        }
-    }
+    upload();
 
-    mSolver.step(mConfig.timestep, mConfig.viscosity, mConfig.diffusion);
+    mSolver->step(mConfig.timestep, mConfig.viscosity, mConfig.diffusion);
 }
 
 void StamDensity::draw() {
-    mTexture.image(N, N, mTexData.data());
     mTexture.bind(0);
 
     mQuadMesh.render();
@@ -112,3 +104,95 @@ void StamDensity::onKeyPress(int key, int action, int mods) {
 void StamDensity::onFramebufferResize(const u32 width, const u32 height) {
     glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
 }
+
+void StamDensity::runHeadless(const HeadlessOptions& options,
+                              const std::string& root) {
+    Config config = loadConfig(root + "/assets/config.json");
+    if (options.gridSize > 0)
+        config.gridSize = options.gridSize;
+    if (options.threads > 0)
+        config.threads = options.threads;
+
+    const u32 n = config.gridSize;
+    ThreadPool pool(config.threads);
+    stam::Solver solver(n, pool);
+    solver.init(config.gaussSeidelIterations,
+                config.redBlack,
+                config.relaxation);
+
+    const Index row = 2;
+    const Index col = n / 2;
+    const Vector2F force = Vector2F(0.0f, 10.0f) * config.forceMultiplier;
+
+    const f64 seconds = Headless::run(
+        options,
+        root,
+        n,
+        n,
+        [&]() {
+            solver.reset();
+            solver.addDensity(row, col, config.densityIncrement);
+            solver.addVelocity(row, col, force);
+            solver.step(config.timestep, config.viscosity, config.diffusion);
+        },
+        [&](std::vector<u8>& rgb) { fillFrame(solver, rgb); },
+        [](const u32 step) {});
+
+    // Without red-black sweeps the relaxation runs on the calling thread.
+    // Gauss-Seidel is used rather than CG, so no CG iterations are counted.
+    Headless::writeSummary(options,
+                           RunSummary{"StamDensity",
+                                      options.threads,
+                                      pool.size(),
+                                      n,
+                                      n,
+                                      options.steps,
+                                      seconds,
+                                      0});
+}
+
+StamDensity::Config StamDensity::loadConfig(const std::string& path) {
+    files::Json json = files::read_to_json(path.c_str());
+
+    Config config;
+    config.gridSize = json.value("grid_size", 100u);
+    config.threads = json.value("threads", 0u);
+    config.timestep = json["timestep"];
+    config.viscosity = json["viscosity"];
+    config.diffusion = json["diffusion_rate"];
+    config.gaussSeidelIterations = json["gauss_seidel_iterations"];
+    config.redBlack = json.value("red_black", false);
+    config.relaxation = json.value("relaxation", 1.0f);
+    config.densityIncrement = json["density_increment"];
+    config.forceMultiplier = json["force_multiplier"];
+
+    return config;
+}
+
+void StamDensity::upload() {
+    f32* texels = mTexture.map();
+    if (texels == nullptr)
+        return;
+
+    const u32 n = mConfig.gridSize;
+    for (Index row = 1; row <= n; ++row) {
+        for (Index col = 1; col <= n; ++col)
+            texels[(row - 1) * n + (col - 1)] = mSolver->density()(row, col);
+    }
+    mTexture.unmap();
+}
+
+void StamDensity::fillFrame(const stam::Solver& solver,
+                            std::vector<u8>& rgb) {
+    const u32 n = solver.n();
+    for (Index row = 1; row <= n; ++row) {
+        for (Index col = 1; col <= n; ++col) {
+            const Index i = (row - 1) * n + (col - 1);
+            u8 d = static_cast<u8>(
+                math::clamp(solver.density()(row, col), 0.0f, 1.0f) * 255.0f);
+            rgb[i * 3] = static_cast<u8>(d);
+            rgb[i * 3 + 1] = static_cast<u8>(d);
+            rgb[i * 3 + 2] = static_cast<u8>(d);
+        }
+    }
+}
@@ -1,12 +1,14 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "application/application.hpp"
+#include "application/headless.hpp"
 #include "geometry/camera.hpp"
+#include "platform/field_texture.hpp"
 #include "platform/mesh.hpp"
 #include "platform/shader.hpp"
-#include "platform/texture.hpp"
 #include "solver.hpp"
 
 class StamDensity : public Application {
@@ -14,6 +16,11 @@ public:
     StamDensity();
     ~StamDensity() = default;
 
+    /// @brief Runs the solver from the app config without a window. A plume
+    /// of density and upward velocity stands in for the mouse input.
+    static void runHeadless(const HeadlessOptions& options,
+                            const std::string& root);
+
     virtual void init() override;
     virtual void update() override;
     virtual void draw() override;
@@ -25,28 +32,52 @@ public:
                                      const u32 height) override;
 
 private:
-    static constexpr u32 N = 100;
-
-    Solver<N> mSolver;
-
-    gl::ShaderProgram mProgram;
-    gl::Mesh mQuadMesh;
+    struct Config {
+        /// @brief Cells per side of the square grid.
+        u32 gridSize;
 
-    Texture mTexture;
-    std::vector<GLubyte> mTexData;
+        /// @brief Solver threads. The hardware concurrency is used when
+        /// zero.
+        u32 threads;
 
-    bool mMouseButtons[GLFW_MOUSE_BUTTON_LAST + 1];
-    Vector2F mPrevMousePos;
-    Vector2F mMousePos;
-
-    struct Config {
         f32 timestep;
         f32 viscosity;
         f32 diffusion;
         u32 gaussSeidelIterations;
 
+        /// @brief Whether the diffusion and pressure solves sweep in
+        /// red-black order across the threads.
+        bool redBlack;
+
+        /// @brief Over-relaxation weight of the Gauss-Seidel updates.
+        f32 relaxation;
+
         f32 densityIncrement;
         f32 forceMultiplier;
+    };
+
+    /// @brief Reads the solver parameters from a config file.
+    static Config loadConfig(const std::string& path);
+
+    /// @brief Fills an RGB image of the density, bottom row first.
+    static void fillFrame(const stam::Solver& solver, std::vector<u8>& rgb);
+
+    /// @brief Uploads the density to the texture, bottom row first.
+    void upload();
+
+    /// @brief Created in init(), once the config is read.
+    std::unique_ptr<ThreadPool> mPool;
+    std::unique_ptr<stam::Solver> mSolver;
+
+    gl::ShaderProgram mProgram;
+    gl::Mesh mQuadMesh;
+
+    /// @brief Density on the GPU, shaded by the fragment shader.
+    FieldTexture mTexture;
+
+    bool mMouseButtons[GLFW_MOUSE_BUTTON_LAST + 1];
+    Vector2F mPrevMousePos;
+    Vector2F mMousePos;
 
-    } mConfig;
+    Config mConfig;
 };
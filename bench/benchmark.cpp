@@ -0,0 +1,179 @@
+#include "benchmark.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "util/format.hpp"
+#include "util/log.hpp"
+
+namespace {
+
+/// @brief Summary statistics of a sample set in milliseconds.
+struct Statistics {
+    f64 mean;
+    f64 stddev;
+    f64 min;
+    f64 median;
+    f64 max;
+};
+
+Statistics summarize(std::vector<f64> samples) {
+    Statistics stats{0.0, 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+
+    const Size n = samples.size();
+    for (const f64 sample : samples) stats.mean += sample;
+    stats.mean /= n;
+
+    // Sample standard deviation, so a handful of repetitions is not
+    // reported as more stable than it is.
+    if (n > 1) {
+        f64 squares = 0.0;
+        for (const f64 sample : samples)
+            squares += (sample - stats.mean) * (sample - stats.mean);
+        stats.stddev = std::sqrt(squares / (n - 1));
+    }
+
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = n % 2 == 1
+                       ? samples[n / 2]
+                       : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    return stats;
+}
+
+}
+
+BenchmarkOptions BenchmarkOptions::parse(const int argc, char** argv) {
+    BenchmarkOptions options;
+
+    for (i32 k = 1; k < argc; ++k) {
+        const bool has_value = k + 1 < argc;
+
+        if (std::strcmp(argv[k], "--sizes") == 0 && has_value) {
+            options.sizes.clear();
+            const char* text = argv[++k];
+            while (*text != '\0') {
+                char* end;
+                const i32 size = std::strtol(text, &end, 10);
+                if (end == text || size <= 0) {
+                    Log::w("Ignoring invalid sizes {}", argv[k]);
+                    break;
+                }
+                options.sizes.push_back(size);
+                text = *end == ',' ? end + 1 : end;
+            }
+        } else if (std::strcmp(argv[k], "--warmup") == 0 && has_value) {
+            options.warmup = std::strtoul(argv[++k], nullptr, 10);
+        } else if (std::strcmp(argv[k], "--repetitions") == 0 && has_value) {
+            options.repetitions = std::strtoul(argv[++k], nullptr, 10);
+        } else if (std::strcmp(argv[k], "--filter") == 0 && has_value) {
+            options.filter = argv[++k];
+        } else if (std::strcmp(argv[k], "--output") == 0 && has_value) {
+            options.outputPath = argv[++k];
+        } else {
+            Log::w("Ignoring argument {}", argv[k]);
+        }
+    }
+
+    return options;
+}
+
+Benchmark::Benchmark(const BenchmarkOptions& options)
+    : mOptions(options), mSink(0.0) {
+}
+
+void Benchmark::counter(const char* name, const f64 value) {
+    assertm(!mResults.empty(), "no kernel has run");
+    mResults.back().counters.emplace_back(name, value);
+}
+
+void Benchmark::keep(const f64 value) {
+    mSink = value;
+}
+
+bool Benchmark::write() const {
+    const bool to_file = !mOptions.outputPath.empty();
+    const int fd =
+        to_file ? ::open(mOptions.outputPath.c_str(),
+                         O_WRONLY | O_CREAT | O_TRUNC,
+                         0644)
+                : STDOUT_FILENO;
+    if (fd < 0) {
+        Log::e("Failed to open {}", mOptions.outputPath);
+        return false;
+    }
+
+    {
+        StringBuffer sb(fd);
+        format(sb,
+               "{{\n  \"warmup\": {},\n  \"repetitions\": {},\n"
+               "  \"results\": [",
+               mOptions.warmup,
+               mOptions.repetitions);
+
+        for (Size k = 0; k < mResults.size(); ++k) {
+            const Result& result = mResults[k];
+            const Statistics stats = summarize(result.samples);
+
+            format(sb,
+                   "{}\n    {{\"name\": \"{}\", \"size\": {}, "
+                   "\"mean_ms\": {}, \"stddev_ms\": {}, \"min_ms\": {}, "
+                   "\"median_ms\": {}, \"max_ms\": {},\n     \"samples_ms\": [",
+                   k == 0 ? "" : ",",
+                   result.name,
+                   result.size,
+                   stats.mean,
+                   stats.stddev,
+                   stats.min,
+                   stats.median,
+                   stats.max);
+            for (Size s = 0; s < result.samples.size(); ++s)
+                format(sb, "{}{}", s == 0 ? "" : ", ", result.samples[s]);
+            sb.append("],\n     \"counters\": {", 21);
+            for (Size c = 0; c < result.counters.size(); ++c) {
+                format(sb,
+                       "{}\"{}\": {}",
+                       c == 0 ? "" : ", ",
+                       result.counters[c].first,
+                       result.counters[c].second);
+            }
+            sb.append("}}", 2);
+        }
+
+        sb.append("\n  ]\n}\n", 7);
+    }
+
+    if (to_file && ::close(fd) != 0) {
+        Log::e("Failed to write {}", mOptions.outputPath);
+        return false;
+    }
+    return true;
+}
+
+bool Benchmark::selected(const char* name) const {
+    return mOptions.filter.empty() ||
+           std::strstr(name, mOptions.filter.c_str()) != nullptr;
+}
+
+void Benchmark::report() const {
+    const Result& result = mResults.back();
+    const Statistics stats = summarize(result.samples);
+    const f64 relative = stats.mean > 0.0 ? 100.0 * stats.stddev / stats.mean
+                                          : 0.0;
+    eprintln("{} {}: {} ms +- {}% (min {} ms, max {} ms)",
+             result.name,
+             result.size,
+             stats.mean,
+             relative,
+             stats.min,
+             stats.max);
+}
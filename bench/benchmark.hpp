@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/common.hpp"
+
+/// @brief Command line options of the benchmark runner.
+struct BenchmarkOptions {
+    /// @brief Parses `--sizes N,N,...`, `--warmup W`, `--repetitions R`,
+    /// `--filter TEXT` and `--output PATH`. Unknown arguments are reported
+    /// and ignored.
+    static BenchmarkOptions parse(const int argc, char** argv);
+
+    /// @brief Grid resolutions. Every kernel runs on a square grid of each
+    /// size.
+    std::vector<i32> sizes = {64, 128, 256, 512, 1024, 2048};
+
+    /// @brief Untimed runs before the timed ones.
+    u32 warmup = 2;
+
+    /// @brief Timed runs of every kernel.
+    u32 repetitions = 10;
+
+    /// @brief Only kernels whose name contains the filter run. Every kernel
+    /// runs when empty.
+    std::string filter;
+
+    /// @brief File the JSON results are written to. Written to stdout when
+    /// empty.
+    std::string outputPath;
+};
+
+/// @brief Times kernels and collects the results as JSON.
+class Benchmark {
+public:
+    explicit Benchmark(const BenchmarkOptions& options);
+
+    /// @brief Runs `body` for the warm-up and timed repetitions. `prepare`
+    /// runs untimed before every repetition, to restore the state `body`
+    /// changes. Returns false if the kernel is filtered out.
+    template <typename Prepare, typename Body>
+    bool run(const char* name, const i32 size, Prepare&& prepare, Body&& body);
+
+    /// @brief Attaches a counter to the last kernel run, such as a solver
+    /// iteration count.
+    void counter(const char* name, const f64 value);
+
+    /// @brief Keeps a computed value alive, so the compiler cannot drop the
+    /// work that produced it.
+    void keep(const f64 value);
+
+    /// @brief Writes the results. Returns false if the output cannot be
+    /// written.
+    bool write() const;
+
+private:
+    struct Result {
+        std::string name;
+        i32 size;
+
+        /// @brief Duration of every timed repetition in milliseconds.
+        std::vector<f64> samples;
+
+        std::vector<std::pair<std::string, f64>> counters;
+    };
+
+    bool selected(const char* name) const;
+
+    /// @brief Prints the statistics of the last result.
+    void report() const;
+
+    BenchmarkOptions mOptions;
+    std::vector<Result> mResults;
+    volatile f64 mSink;
+};
+
+template <typename Prepare, typename Body>
+bool Benchmark::run(const char* name,
+                    const i32 size,
+                    Prepare&& prepare,
+                    Body&& body) {
+    if (!selected(name))
+        return false;
+
+    using Clock = std::chrono::steady_clock;
+
+    for (u32 k = 0; k < mOptions.warmup; ++k) {
+        prepare();
+        body();
+    }
+
+    Result result{name, size, {}, {}};
+    result.samples.reserve(mOptions.repetitions);
+    for (u32 k = 0; k < mOptions.repetitions; ++k) {
+        prepare();
+        const Clock::time_point start = Clock::now();
+        body();
+        const Clock::time_point end = Clock::now();
+        result.samples.push_back(
+            std::chrono::duration<f64, std::milli>(end - start).count());
+    }
+
+    mResults.push_back(std::move(result));
+    report();
+    return true;
+}
+
+/// @brief Times the Bridson liquid kernels on a `size` by `size` grid.
+void benchLiquid(Benchmark& benchmark, const i32 size);
+
+/// @brief Times the Stam solver step on a `size` by `size` grid, with
+/// row-ordered and red-black relaxation.
+void benchStam(Benchmark& benchmark, const i32 size);
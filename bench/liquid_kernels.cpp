@@ -0,0 +1,123 @@
+#include <cmath>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "bridson-liquid/advection.hpp"
+#include "bridson-liquid/extrapolation.hpp"
+#include "bridson-liquid/mac_grid.hpp"
+#include "bridson-liquid/projection.hpp"
+#include "bridson-liquid/redistancing.hpp"
+#include "math/constants.hpp"
+#include "util/thread_pool.hpp"
+
+namespace {
+
+/// @brief Timestep of the default liquid config.
+constexpr f64 cTimestep = 0.005;
+
+/// @brief Sets up a disc of liquid in the middle of the unit square, moving
+/// with a smooth velocity field that is neither divergence free nor zero
+/// outside the liquid, so every kernel has work to do.
+void initialize(MACGrid& mac) {
+    const f64 centre = 0.5 * mac.nx();
+    const f64 radius = 0.25 * mac.nx();
+    for (i32 j = 0; j < mac.ny(); ++j) {
+        for (i32 i = 0; i < mac.nx(); ++i) {
+            const f64 x = i + 0.5 - centre;
+            const f64 y = j + 0.5 - centre;
+            mac.s(i, j) = std::sqrt(x * x + y * y) - radius;
+        }
+    }
+
+    const auto fill = [](Grid& grid, const f64 phase) {
+        for (i32 j = 0; j < grid.ny(); ++j) {
+            for (i32 i = 0; i < grid.nx(); ++i) {
+                const Vector2D p = grid.toWorldSpace(Vector2D(i, j));
+                grid(i, j) = std::sin(2.0 * math::pi<f64>() * p[0] + phase) *
+                             std::cos(math::pi<f64>() * p[1]);
+            }
+        }
+    };
+    fill(mac.u, 0.0);
+    fill(mac.v, 0.5 * math::pi<f64>());
+
+    mac.updateLabels();
+}
+
+void benchInterp(Benchmark& benchmark, const i32 size, const Grid& grid) {
+    // Scattered lookups, like the backtraced points of advection.
+    std::vector<Vector2D> points(static_cast<Size>(size) * size);
+    u32 state = 0x9e3779b9u;
+    const auto next = [&]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<f64>(state) / 4294967296.0;
+    };
+    for (Vector2D& point : points)
+        point = Vector2D(next() * (grid.nx() - 1), next() * (grid.ny() - 1));
+
+    benchmark.run(
+        "grid_interp",
+        size,
+        []() {},
+        [&]() {
+            f64 sum = 0.0;
+            for (const Vector2D& point : points) sum += grid.interp(point);
+            benchmark.keep(sum);
+        });
+}
+
+}
+
+void benchLiquid(Benchmark& benchmark, const i32 size) {
+    MACGrid mac(size, size, 1.0f / size);
+    initialize(mac);
+
+    benchInterp(benchmark, size, mac.s);
+
+    // Advection writes to its own buffer, so repetitions see the same input.
+    Advection advect(mac.s, mac.u, mac.v, mac.label);
+    benchmark.run(
+        "advection", size, []() {}, [&]() { advect(cTimestep); });
+
+    const Grid u = mac.u;
+    const Grid v = mac.v;
+
+    Extrapolation extrapolate(mac.u, mac.label);
+    const u32 depth = mac.extrapolationDepth(cTimestep);
+    benchmark.run(
+        "extrapolation",
+        size,
+        [&]() { mac.u = u; },
+        [&]() { extrapolate(depth, mac.label); });
+    mac.u = u;
+
+    Projection project(mac);
+    if (benchmark.run(
+            "projection",
+            size,
+            [&]() {
+                mac.u = u;
+                mac.v = v;
+            },
+            [&]() { project(cTimestep); })) {
+        benchmark.counter("cg_iterations", project.iterations());
+    }
+
+    // Stretch the level set so it is no longer a distance field, keeping
+    // the interface in place.
+    Grid stretched = mac.s;
+    for (i32 j = 0; j < mac.ny(); ++j) {
+        for (i32 i = 0; i < mac.nx(); ++i)
+            stretched(i, j) *= 1.5 + 0.5 * std::sin(0.1 * (i + 2 * j));
+    }
+
+    ThreadPool pool;
+    Redistancing redistance(mac.s, pool, 2, false);
+    benchmark.run(
+        "redistancing",
+        size,
+        [&]() { mac.s = stretched; },
+        [&]() { redistance(); });
+}
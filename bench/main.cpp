@@ -0,0 +1,17 @@
+#include "benchmark.hpp"
+#include "util/log.hpp"
+
+int main(int argc, char** argv) {
+    // The solvers log every pressure solve at the debug level.
+    Log::setLevel(Log::Level::Warning);
+
+    const BenchmarkOptions options = BenchmarkOptions::parse(argc, argv);
+    Benchmark benchmark(options);
+
+    for (const i32 size : options.sizes) {
+        benchLiquid(benchmark, size);
+        benchStam(benchmark, size);
+    }
+
+    return benchmark.write() ? 0 : 1;
+}
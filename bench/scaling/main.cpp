@@ -0,0 +1,176 @@
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/log.hpp"
+
+extern char** environ;
+
+namespace {
+
+/// @brief Command line options of the scaling study.
+struct ScalingOptions {
+    std::vector<std::string> apps = {"BridsonLiquid",
+                                     "BridsonDensity",
+                                     "BridsonDensityLabelled",
+                                     "StamDensity"};
+    std::vector<u32> threads;
+    std::vector<u32> sizes = {64, 128, 256, 512};
+
+    /// @brief Cells per side at one thread for weak scaling. The grid grows
+    /// with the thread count so the cells per thread stay constant. Sizes
+    /// are swept instead when zero.
+    u32 weakBase = 0;
+
+    u32 steps = 20;
+    std::string outputPath = "scaling.csv";
+};
+
+std::vector<std::string> splitList(const char* text) {
+    std::vector<std::string> items;
+    std::string item;
+    for (; *text != '\0'; ++text) {
+        if (*text == ',') {
+            if (!item.empty())
+                items.push_back(item);
+            item.clear();
+        } else {
+            item.push_back(*text);
+        }
+    }
+    if (!item.empty())
+        items.push_back(item);
+    return items;
+}
+
+std::vector<u32> parseCounts(const char* text) {
+    std::vector<u32> counts;
+    for (const std::string& item : splitList(text)) {
+        const u32 count = std::strtoul(item.c_str(), nullptr, 10);
+        if (count == 0)
+            Log::w("Ignoring invalid count {}", item);
+        else
+            counts.push_back(count);
+    }
+    return counts;
+}
+
+ScalingOptions parse(const int argc, char** argv) {
+    ScalingOptions options;
+
+    for (i32 k = 1; k < argc; ++k) {
+        const bool has_value = k + 1 < argc;
+
+        if (std::strcmp(argv[k], "--apps") == 0 && has_value) {
+            options.apps = splitList(argv[++k]);
+        } else if (std::strcmp(argv[k], "--threads") == 0 && has_value) {
+            options.threads = parseCounts(argv[++k]);
+        } else if (std::strcmp(argv[k], "--sizes") == 0 && has_value) {
+            options.sizes = parseCounts(argv[++k]);
+        } else if (std::strcmp(argv[k], "--weak") == 0 && has_value) {
+            options.weakBase = std::strtoul(argv[++k], nullptr, 10);
+        } else if (std::strcmp(argv[k], "--steps") == 0 && has_value) {
+            options.steps = std::strtoul(argv[++k], nullptr, 10);
+        } else if (std::strcmp(argv[k], "--output") == 0 && has_value) {
+            options.outputPath = argv[++k];
+        } else {
+            Log::w("Ignoring argument {}", argv[k]);
+        }
+    }
+
+    // Powers of two up to the hardware concurrency by default.
+    if (options.threads.empty()) {
+        const u32 hardware = std::max(1u, std::thread::hardware_concurrency());
+        for (u32 count = 1; count < hardware; count *= 2)
+            options.threads.push_back(count);
+        options.threads.push_back(hardware);
+    }
+
+    return options;
+}
+
+/// @brief Runs one headless batch of `app`, which appends its summary to
+/// the output. Returns false if the app fails.
+bool runApp(const ScalingOptions& options,
+            const std::string& app,
+            const u32 threads,
+            const u32 size) {
+    const std::string path = "bin/" + app;
+    const std::string steps = std::to_string(options.steps);
+    const std::string thread_count = std::to_string(threads);
+    const std::string grid = std::to_string(size);
+
+    std::vector<const char*> args = {path.c_str(),
+                                     "--headless",
+                                     "--steps",
+                                     steps.c_str(),
+                                     "--frame-interval",
+                                     "0",
+                                     "--threads",
+                                     thread_count.c_str(),
+                                     "--grid",
+                                     grid.c_str(),
+                                     "--scaling-csv",
+                                     options.outputPath.c_str(),
+                                     "--log-level",
+                                     "warning",
+                                     nullptr};
+
+    pid_t pid;
+    const int error = ::posix_spawn(&pid,
+                                    path.c_str(),
+                                    nullptr,
+                                    nullptr,
+                                    const_cast<char* const*>(args.data()),
+                                    environ);
+    if (error != 0) {
+        Log::e("Failed to start {}: {}", path, std::strerror(error));
+        return false;
+    }
+
+    int status;
+    if (::waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        Log::e("{} failed with {} threads at size {}", app, threads, size);
+        return false;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const ScalingOptions options = parse(argc, argv);
+
+    // Every app appends a row, and the first one writes the header.
+    ::unlink(options.outputPath.c_str());
+
+    bool ok = true;
+    for (const std::string& app : options.apps) {
+        for (const u32 threads : options.threads) {
+            if (options.weakBase > 0) {
+                const u32 size = static_cast<u32>(
+                    std::lround(options.weakBase * std::sqrt(threads)));
+                Log::i("{}: {} threads, {} cells a side", app, threads, size);
+                ok = runApp(options, app, threads, size) && ok;
+                continue;
+            }
+
+            for (const u32 size : options.sizes) {
+                Log::i("{}: {} threads, {} cells a side", app, threads, size);
+                ok = runApp(options, app, threads, size) && ok;
+            }
+        }
+    }
+
+    Log::i("Wrote {}", options.outputPath);
+    return ok ? 0 : 1;
+}
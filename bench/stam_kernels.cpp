@@ -0,0 +1,49 @@
+#include "benchmark.hpp"
+#include "stam-density/solver.hpp"
+#include "util/thread_pool.hpp"
+
+namespace {
+
+/// @brief Parameters of the default Stam config.
+constexpr f32 cTimestep = 0.1f;
+constexpr f32 cViscosity = 0.0f;
+constexpr f32 cDiffusion = 0.001f;
+constexpr u32 cGaussSeidelIterations = 20;
+
+void benchStep(Benchmark& benchmark,
+               const char* name,
+               const u32 n,
+               ThreadPool& pool,
+               const bool red_black) {
+    stam::Solver solver(n, pool);
+    solver.init(cGaussSeidelIterations, red_black, 1.0f);
+
+    // A source of density in the middle, pushed up and to the right.
+    for (Index row = n / 2 - n / 8; row < n / 2 + n / 8; ++row) {
+        for (Index col = n / 2 - n / 8; col < n / 2 + n / 8; ++col) {
+            solver.addDensity(row, col, 10.0f);
+            solver.addVelocity(row, col, Vector2F(1.0f, 2.0f));
+        }
+    }
+
+    if (benchmark.run(
+            name,
+            n,
+            []() {},
+            [&]() { solver.step(cTimestep, cViscosity, cDiffusion); })) {
+        benchmark.counter("threads", pool.size());
+    }
+}
+
+}
+
+void benchStam(Benchmark& benchmark, const i32 size) {
+    const u32 n = static_cast<u32>(size);
+
+    // The row-ordered sweeps are sequential, so they get a single thread.
+    ThreadPool serial(1);
+    benchStep(benchmark, "stam_step", n, serial, false);
+
+    ThreadPool pool;
+    benchStep(benchmark, "stam_step_red_black", n, pool, true);
+}
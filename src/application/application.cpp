@@ -18,6 +18,24 @@ Application::~Application() {
     glfwTerminate();
 }
 
+void Application::startServices(const RunOptions& options) {
+    if (options.logLevel)
+        Log::setLevel(*options.logLevel);
+
+    if (!options.profilePath.empty())
+        Profiler::start(options.profilePath);
+    if (options.perfCounters)
+        Profiler::enableCounters();
+
+    if (!options.prometheusPath.empty())
+        Metrics::start(options.prometheusPath, options.prometheusInterval);
+}
+
+void Application::finishServices() {
+    Profiler::finish();
+    Metrics::finish();
+}
+
 void Application::init() {
 }
 
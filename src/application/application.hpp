@@ -4,7 +4,10 @@
 
 #include "math/vector.hpp"
 #include "platform/opengl.hpp"
+#include "run_options.hpp"
 #include "util/common.hpp"
+#include "util/metrics.hpp"
+#include "util/profiler.hpp"
 
 class Application;
 
@@ -32,6 +35,14 @@ public:
                        const std::string& root_path,
                        Args&&... args);
 
+    /// @brief Applies the log level of `options` and starts the profiler
+    /// and metrics exporter it asks for. Call once before the run.
+    static void startServices(const RunOptions& options);
+
+    /// @brief Writes the profile and the final metrics. Call once the run
+    /// has finished.
+    static void finishServices();
+
 protected:
     Application();
 
@@ -209,15 +220,23 @@ void Application::run(const u32 width,
     mInstance->init();
 
     while (!glfwWindowShouldClose(mInstance->mWindow)) {
+        PROFILE_SCOPE("frame");
+
         glfwPollEvents();
         // TODO: ImGui_ImplGlfwGL3_NewFrame
 
-        mInstance->update();
+        {
+            PROFILE_SCOPE("update");
+            mInstance->update();
+        }
 
         mInstance->gui();
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        mInstance->draw();
+        {
+            PROFILE_SCOPE("draw");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            mInstance->draw();
+        }
 
         int framebuffer_width;
         int framebuffer_height;
@@ -228,6 +247,7 @@ void Application::run(const u32 width,
 
         // TODO: render ImGui
 
+        PROFILE_SCOPE("swap");
         glfwSwapBuffers(mInstance->mWindow);
     }
 
@@ -0,0 +1,100 @@
+#include "frame_encoder.hpp"
+
+#include <algorithm>
+
+#include "headless.hpp"
+
+FrameEncoder::FrameEncoder(const std::string& dir,
+                           const u32 width,
+                           const u32 height,
+                           const u32 thread_count,
+                           const u32 frame_count)
+    : mDir(dir),
+      mWidth(width),
+      mHeight(height),
+      mFrames(frame_count),
+      mBusy(0),
+      mStop(false),
+      mDropped(0) {
+    assertm(frame_count > 0, "frame count must be positive");
+
+    for (Frame& frame : mFrames) {
+        frame.rgb.resize(static_cast<Size>(width) * height * 3);
+        frame.index = 0;
+        mFree.push_back(&frame);
+    }
+
+    const u32 count =
+        thread_count > 0
+            ? thread_count
+            : std::max(1u, std::thread::hardware_concurrency() / 2);
+
+    mWorkers.reserve(count);
+    for (u32 t = 0; t < count; ++t) mWorkers.emplace_back([this]() { work(); });
+}
+
+FrameEncoder::~FrameEncoder() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mPendingReady.notify_all();
+
+    for (std::thread& worker : mWorkers) worker.join();
+}
+
+FrameEncoder::Frame& FrameEncoder::acquire() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFreeReady.wait(lock, [this]() { return !mFree.empty(); });
+
+    Frame* frame = mFree.back();
+    mFree.pop_back();
+    return *frame;
+}
+
+void FrameEncoder::submit(Frame& frame) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPending.push_back(&frame);
+    }
+    mPendingReady.notify_one();
+}
+
+void FrameEncoder::flush() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this]() { return mPending.empty() && mBusy == 0; });
+}
+
+u32 FrameEncoder::dropped() const {
+    return mDropped.load(std::memory_order_relaxed);
+}
+
+void FrameEncoder::work() {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true) {
+        mPendingReady.wait(lock,
+                           [this]() { return mStop || !mPending.empty(); });
+
+        // Queued frames are still written when stopping.
+        if (mPending.empty())
+            return;
+
+        Frame* frame = mPending.front();
+        mPending.pop_front();
+        ++mBusy;
+
+        lock.unlock();
+        if (!Headless::writeFrame(
+                mDir, frame->index, mWidth, mHeight, frame->rgb))
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+
+        --mBusy;
+        mFree.push_back(frame);
+        mFreeReady.notify_one();
+
+        if (mPending.empty() && mBusy == 0)
+            mIdle.notify_all();
+    }
+}
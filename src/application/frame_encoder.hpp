@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/common.hpp"
+
+/// @brief Encodes RGB frames to PNG files on background threads. Frame
+/// buffers come from a fixed pool and are recycled once written, so saving
+/// frames does not allocate. When every buffer is queued or being encoded,
+/// acquire() blocks until one is free, which holds the producer back when
+/// the disk cannot keep up.
+class FrameEncoder {
+public:
+    /// @brief Frame buffer handed out by acquire().
+    struct Frame {
+        /// @brief RGB pixels, bottom row first.
+        std::vector<u8> rgb;
+
+        /// @brief Frame number used in the file name.
+        u32 index;
+    };
+
+    /// @brief Constructs an encoder writing to `dir`.
+    /// @param dir Output directory.
+    /// @param width Frame width in pixels.
+    /// @param height Frame height in pixels.
+    /// @param thread_count Number of encoder threads. A count of 0 uses half
+    /// the hardware concurrency.
+    /// @param frame_count Number of pooled frame buffers.
+    FrameEncoder(const std::string& dir,
+                 const u32 width,
+                 const u32 height,
+                 const u32 thread_count = 0,
+                 const u32 frame_count = 8);
+
+    /// @brief Encodes the queued frames, then joins the threads.
+    ~FrameEncoder();
+
+    FrameEncoder(const FrameEncoder&) = delete;
+    FrameEncoder& operator=(const FrameEncoder&) = delete;
+
+    /// @brief Takes a free frame buffer from the pool, waiting for one if
+    /// needed.
+    Frame& acquire();
+
+    /// @brief Queues an acquired frame for encoding. The frame goes back to
+    /// the pool once it is written.
+    void submit(Frame& frame);
+
+    /// @brief Waits until every submitted frame is written.
+    void flush();
+
+    /// @brief Number of submitted frames that could not be written.
+    u32 dropped() const;
+
+private:
+    void work();
+
+    std::string mDir;
+    u32 mWidth;
+    u32 mHeight;
+
+    /// @brief Frame pool. Never resized, so pointers into it stay valid.
+    std::vector<Frame> mFrames;
+
+    std::mutex mMutex;
+    std::condition_variable mFreeReady;
+    std::condition_variable mPendingReady;
+    std::condition_variable mIdle;
+
+    std::vector<Frame*> mFree;
+    std::deque<Frame*> mPending;
+
+    /// @brief Number of frames being encoded.
+    u32 mBusy;
+    bool mStop;
+
+    std::atomic<u32> mDropped;
+
+    std::vector<std::thread> mWorkers;
+};
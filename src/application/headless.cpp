@@ -0,0 +1,98 @@
+#include "headless.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iomanip>
+#include <sstream>
+
+bool Headless::writeFrame(const std::string& dir,
+                          const u32 index,
+                          const u32 width,
+                          const u32 height,
+                          const std::vector<u8>& rgb) {
+    std::ostringstream filenameStream;
+    filenameStream << "Frame_" << std::setw(5) << std::setfill('0') << index
+                   << ".png";
+    const std::string path = dir + "/" + filenameStream.str();
+
+    // Frames are filled bottom row first, like the textures drawn by the
+    // apps, while PNG rows run top to bottom. Starting at the last row with
+    // a negative stride flips them without the global flip flag of stb,
+    // which the encoder threads would race on.
+    const int stride = static_cast<int>(width * 3);
+    const u8* last_row = rgb.data() + static_cast<Size>(height - 1) * stride;
+    const int error = stbi_write_png(path.c_str(),
+                                     static_cast<int>(width),
+                                     static_cast<int>(height),
+                                     3,
+                                     last_row,
+                                     -stride);
+
+    if (!error) {
+        Log::e("Failed to save frame {}", path);
+        return false;
+    }
+    return true;
+}
+
+void Headless::writeSummary(const HeadlessOptions& options,
+                            const RunSummary& summary) {
+    if (options.scalingCsvPath.empty())
+        return;
+
+    const int fd = ::open(
+        options.scalingCsvPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    struct stat status;
+    if (fd < 0 || ::fstat(fd, &status) != 0) {
+        Log::e("Failed to open scaling CSV {}", options.scalingCsvPath);
+        if (fd >= 0)
+            ::close(fd);
+        return;
+    }
+
+    // Peak resident set size, in kilobytes on Linux.
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    const f64 peak_mb = usage.ru_maxrss / 1024.0;
+
+    const u64 cells = static_cast<u64>(summary.cols) * summary.rows;
+    const f64 steps_per_second =
+        summary.seconds > 0.0 ? summary.steps / summary.seconds : 0.0;
+    const f64 cg_per_step =
+        summary.steps > 0
+            ? static_cast<f64>(summary.cgIterations) / summary.steps
+            : 0.0;
+
+    {
+        StringBuffer sb(fd);
+        if (status.st_size == 0) {
+            format(sb,
+                   "app,requested_threads,threads,cols,rows,cells,steps,"
+                   "seconds,steps_per_second,cell_updates_per_second,"
+                   "peak_rss_mb,cg_iterations_per_step\n");
+        }
+        format(sb,
+               "{},{},{},{},{},{},{},{},{},{},{},{}\n",
+               summary.app,
+               summary.requestedThreads,
+               summary.threads,
+               summary.cols,
+               summary.rows,
+               cells,
+               summary.steps,
+               summary.seconds,
+               steps_per_second,
+               steps_per_second * cells,
+               peak_mb,
+               cg_per_step);
+    }
+
+    if (::close(fd) != 0)
+        Log::e("Failed to write scaling CSV {}", options.scalingCsvPath);
+}
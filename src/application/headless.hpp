@@ -0,0 +1,176 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_encoder.hpp"
+#include "util/common.hpp"
+#include "util/log.hpp"
+#include "util/memory.hpp"
+
+/// @brief Options of the headless batch mode, filled by RunOptions::parse().
+struct HeadlessOptions {
+    /// @brief Whether to run without a window.
+    bool enabled = false;
+
+    /// @brief Number of solver steps to run.
+    u32 steps = 100;
+
+    /// @brief Steps between saved frames. No frames are saved when zero.
+    u32 frameInterval = 1;
+
+    /// @brief Directory the frames are written to. Defaults to the frames
+    /// directory of the app.
+    std::string outputDir;
+
+    /// @brief Binary field cache written after every step. No cache is
+    /// written when empty.
+    std::string cachePath;
+
+    /// @brief Maximum absolute error of the cached solver fields. Fields are
+    /// compressed when positive and stored exactly when zero.
+    f64 cacheErrorBound = 0.0;
+
+    /// @brief Cells per side of the square solver grid, overriding the
+    /// config. The config size is used when zero.
+    u32 gridSize = 0;
+
+    /// @brief Solver threads, overriding the config of apps that run on a
+    /// thread pool. The config count is used when zero.
+    u32 threads = 0;
+
+    /// @brief CSV file a row of the run summary is appended to for scaling
+    /// studies. Nothing is written when empty.
+    std::string scalingCsvPath;
+
+    /// @brief Whether to report the allocations of every subsystem after
+    /// the run and warn about steps that allocate.
+    bool memoryReport = false;
+};
+
+/// @brief Summary of a headless run, written as a row of the scaling CSV.
+struct RunSummary {
+    /// @brief Name of the app.
+    std::string app;
+
+    /// @brief Threads requested on the command line, 0 for the default.
+    u32 requestedThreads;
+
+    /// @brief Threads the solver ran on.
+    u32 threads;
+
+    u32 cols;
+    u32 rows;
+    u32 steps;
+
+    /// @brief Time spent stepping the solver.
+    f64 seconds;
+
+    /// @brief CG iterations summed over every step.
+    u64 cgIterations;
+};
+
+/// @brief Drives a solver without GLFW or OpenGL. The solver is stepped as
+/// fast as possible and frames are written as PNG files, so simulations can
+/// run on machines without a display.
+class Headless {
+public:
+    /// @brief Runs the batch and reports the step rate. Frames are encoded on
+    /// background threads while the solver keeps stepping.
+    /// @param options Batch options.
+    /// @param root Root path of the app.
+    /// @param width Frame width in pixels.
+    /// @param height Frame height in pixels.
+    /// @param step Advances the solver by one step.
+    /// @param frame Fills an RGB frame of `width * height * 3` bytes, rows
+    /// bottom to top.
+    /// @param record Called with the number of steps taken after every step,
+    /// outside the timed region, to record solver state.
+    /// @return Seconds spent stepping the solver.
+    template <typename Step, typename Frame, typename Record>
+    static f64 run(const HeadlessOptions& options,
+                    const std::string& root,
+                    const u32 width,
+                    const u32 height,
+                    Step&& step,
+                    Frame&& frame,
+                    Record&& record);
+
+    /// @brief Writes an RGB frame to `dir/Frame_NNNNN.png`. Rows are flipped
+    /// so the first row of `rgb` ends up at the bottom of the image. Returns
+    /// false if the file could not be written.
+    static bool writeFrame(const std::string& dir,
+                           const u32 index,
+                           const u32 width,
+                           const u32 height,
+                           const std::vector<u8>& rgb);
+
+    /// @brief Appends `summary` with the derived throughput and the peak
+    /// memory use of the process to the scaling CSV of `options`, writing
+    /// the header first if the file is empty. Does nothing without a
+    /// scaling CSV path.
+    static void writeSummary(const HeadlessOptions& options,
+                             const RunSummary& summary);
+};
+
+template <typename Step, typename Frame, typename Record>
+f64 Headless::run(const HeadlessOptions& options,
+                   const std::string& root,
+                   const u32 width,
+                   const u32 height,
+                   Step&& step,
+                   Frame&& frame,
+                   Record&& record) {
+    const std::string dir =
+        options.outputDir.empty() ? root + "/frames" : options.outputDir;
+
+    std::unique_ptr<FrameEncoder> encoder;
+    if (options.frameInterval > 0)
+        encoder = std::make_unique<FrameEncoder>(dir, width, height);
+
+    std::unique_ptr<memory::StepTracker> tracker;
+    if (options.memoryReport)
+        tracker = std::make_unique<memory::StepTracker>();
+
+    using Clock = std::chrono::steady_clock;
+    Clock::duration solve_time = Clock::duration::zero();
+    u32 frames = 0;
+
+    for (u32 k = 0; k < options.steps; ++k) {
+        const Clock::time_point start = Clock::now();
+        step();
+        solve_time += Clock::now() - start;
+
+        if (tracker)
+            tracker->step();
+
+        record(k + 1);
+
+        if (options.frameInterval > 0 && (k + 1) % options.frameInterval == 0) {
+            FrameEncoder::Frame& encoded = encoder->acquire();
+            frame(encoded.rgb);
+            encoded.index = k / options.frameInterval;
+            encoder->submit(encoded);
+            ++frames;
+        }
+    }
+
+    if (encoder) {
+        encoder->flush();
+        if (encoder->dropped() > 0)
+            Log::e("Dropped {} of {} frames", encoder->dropped(), frames);
+    }
+
+    const f64 seconds = std::chrono::duration<f64>(solve_time).count();
+    Log::i("Ran {} steps in {} s ({} steps/s)",
+           options.steps,
+           seconds,
+           seconds > 0.0 ? options.steps / seconds : 0.0);
+
+    if (tracker)
+        tracker->print();
+
+    return seconds;
+}
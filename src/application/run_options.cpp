@@ -0,0 +1,61 @@
+#include "run_options.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+RunOptions RunOptions::parse(const int argc, char** argv) {
+    RunOptions options;
+    HeadlessOptions& headless = options.headless;
+
+    for (i32 k = 1; k < argc; ++k) {
+        const bool has_value = k + 1 < argc;
+
+        if (std::strcmp(argv[k], "--headless") == 0) {
+            headless.enabled = true;
+        } else if (std::strcmp(argv[k], "--steps") == 0 && has_value) {
+            headless.steps = std::strtoul(argv[++k], nullptr, 10);
+        } else if (std::strcmp(argv[k], "--frame-interval") == 0 &&
+                   has_value) {
+            headless.frameInterval = std::strtoul(argv[++k], nullptr, 10);
+        } else if (std::strcmp(argv[k], "--output") == 0 && has_value) {
+            headless.outputDir = argv[++k];
+        } else if (std::strcmp(argv[k], "--cache") == 0 && has_value) {
+            headless.cachePath = argv[++k];
+        } else if (std::strcmp(argv[k], "--error-bound") == 0 && has_value) {
+            headless.cacheErrorBound = std::strtod(argv[++k], nullptr);
+        } else if (std::strcmp(argv[k], "--grid") == 0 && has_value) {
+            headless.gridSize = std::strtoul(argv[++k], nullptr, 10);
+        } else if (std::strcmp(argv[k], "--threads") == 0 && has_value) {
+            headless.threads = std::strtoul(argv[++k], nullptr, 10);
+        } else if (std::strcmp(argv[k], "--scaling-csv") == 0 && has_value) {
+            headless.scalingCsvPath = argv[++k];
+        } else if (std::strcmp(argv[k], "--memory") == 0) {
+            headless.memoryReport = true;
+        } else if (std::strcmp(argv[k], "--resume") == 0 && has_value) {
+            options.resumePath = argv[++k];
+        } else if (std::strcmp(argv[k], "--replay") == 0 && has_value) {
+            options.replayPath = argv[++k];
+        } else if (std::strcmp(argv[k], "--replay-fps") == 0 && has_value) {
+            options.replayFps = std::strtod(argv[++k], nullptr);
+        } else if (std::strcmp(argv[k], "--log-level") == 0 && has_value) {
+            Log::Level level;
+            if (Log::parseLevel(argv[++k], level))
+                options.logLevel = level;
+            else
+                Log::w("Unknown log level {}", argv[k]);
+        } else if (std::strcmp(argv[k], "--profile") == 0 && has_value) {
+            options.profilePath = argv[++k];
+        } else if (std::strcmp(argv[k], "--perf") == 0) {
+            options.perfCounters = true;
+        } else if (std::strcmp(argv[k], "--prometheus") == 0 && has_value) {
+            options.prometheusPath = argv[++k];
+        } else if (std::strcmp(argv[k], "--prometheus-interval") == 0 &&
+                   has_value) {
+            options.prometheusInterval = std::strtod(argv[++k], nullptr);
+        } else {
+            Log::w("Ignoring argument {}", argv[k]);
+        }
+    }
+
+    return options;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "headless.hpp"
+#include "util/common.hpp"
+#include "util/log.hpp"
+
+/// @brief Command line options of an app, for windowed and headless runs.
+struct RunOptions {
+    /// @brief Fills the options from the command line. Unknown arguments are
+    /// reported and ignored. Nothing is started; see
+    /// Application::startServices().
+    static RunOptions parse(const int argc, char** argv);
+
+    /// @brief Options of the headless batch mode.
+    HeadlessOptions headless;
+
+    /// @brief Solver checkpoint to start from instead of the initial
+    /// conditions. Ignored by apps without checkpoints.
+    std::string resumePath;
+
+    /// @brief Field cache played back in the window instead of running the
+    /// solver. The solver runs when empty.
+    std::string replayPath;
+
+    /// @brief Playback rate of a replay in frames per second.
+    f64 replayFps = 30.0;
+
+    /// @brief Level of the logger. The default level is kept when unset.
+    std::optional<Log::Level> logLevel;
+
+    /// @brief Chrome trace the profiler writes. Nothing is profiled when
+    /// empty.
+    std::string profilePath;
+
+    /// @brief Whether the profiler also reads hardware counters.
+    bool perfCounters = false;
+
+    /// @brief File the Prometheus metrics are exported to. Nothing is
+    /// exported when empty.
+    std::string prometheusPath;
+
+    /// @brief Seconds between Prometheus exports.
+    f64 prometheusInterval = 10.0;
+};
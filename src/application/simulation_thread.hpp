@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "util/common.hpp"
+#include "util/spsc_queue.hpp"
+#include "util/triple_buffer.hpp"
+
+/// @brief Runs a solver on its own thread, so a slow step does not stall
+/// input handling or rendering. The render thread sends commands through a
+/// lock-free queue and draws the latest snapshot published through a triple
+/// buffer.
+/// @tparam Command Command type sent from the render thread.
+/// @tparam Snapshot Solver state published to the render thread.
+template <typename Command, typename Snapshot>
+class SimulationThread {
+public:
+    /// @brief Constructs a stopped thread with every snapshot a copy of
+    /// `initial`.
+    explicit SimulationThread(const Snapshot& initial);
+
+    /// @brief Stops and joins the thread.
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    /// @brief Starts the thread. Every iteration calls `handle(command)` for
+    /// each queued command, then `step(snapshot)`. `step` advances the solver,
+    /// writes the snapshot and returns true, or returns false when there is
+    /// nothing to do, in which case the thread sleeps until the next command.
+    template <typename Handle, typename Step>
+    void start(Handle handle, Step step);
+
+    /// @brief Stops and joins the thread.
+    void stop();
+
+    /// @brief Queues a command for the simulation thread. Returns false if
+    /// the queue is full.
+    bool send(const Command& command);
+
+    /// @brief Swaps in the latest snapshot. Returns whether it changed.
+    bool update();
+
+    /// @brief Latest snapshot picked up by update().
+    const Snapshot& snapshot() const;
+
+private:
+    static constexpr Size cQueueCapacity = 64;
+
+    SpscQueue<Command, cQueueCapacity> mCommands;
+    TripleBuffer<Snapshot> mSnapshots;
+
+    /// @brief Bumped on every command and on stop(), so an idle thread can
+    /// wait on it without missing a wakeup.
+    std::atomic<u32> mWakeups;
+    std::atomic<bool> mStop;
+
+    std::thread mThread;
+};
+
+template <typename Command, typename Snapshot>
+SimulationThread<Command, Snapshot>::SimulationThread(const Snapshot& initial)
+    : mSnapshots(initial), mWakeups(0), mStop(false) {
+}
+
+template <typename Command, typename Snapshot>
+SimulationThread<Command, Snapshot>::~SimulationThread() {
+    stop();
+}
+
+template <typename Command, typename Snapshot>
+template <typename Handle, typename Step>
+void SimulationThread<Command, Snapshot>::start(Handle handle, Step step) {
+    assertm(!mThread.joinable(), "simulation thread already started");
+
+    mStop.store(false);
+    mThread = std::thread([this, handle, step]() mutable {
+        while (!mStop.load(std::memory_order_acquire)) {
+            // Read before draining the queue, so a command sent after the
+            // drain changes the value and the wait below returns.
+            const u32 wakeups = mWakeups.load(std::memory_order_acquire);
+
+            Command command;
+            while (mCommands.pop(command)) handle(command);
+
+            if (step(mSnapshots.back())) {
+                mSnapshots.publish();
+                continue;
+            }
+
+            mWakeups.wait(wakeups, std::memory_order_acquire);
+        }
+    });
+}
+
+template <typename Command, typename Snapshot>
+void SimulationThread<Command, Snapshot>::stop() {
+    if (!mThread.joinable())
+        return;
+
+    mStop.store(true, std::memory_order_release);
+    mWakeups.fetch_add(1, std::memory_order_release);
+    mWakeups.notify_one();
+    mThread.join();
+}
+
+template <typename Command, typename Snapshot>
+bool SimulationThread<Command, Snapshot>::send(const Command& command) {
+    if (!mCommands.push(command))
+        return false;
+
+    mWakeups.fetch_add(1, std::memory_order_release);
+    mWakeups.notify_one();
+    return true;
+}
+
+template <typename Command, typename Snapshot>
+bool SimulationThread<Command, Snapshot>::update() {
+    return mSnapshots.update();
+}
+
+template <typename Command, typename Snapshot>
+const Snapshot& SimulationThread<Command, Snapshot>::snapshot() const {
+    return mSnapshots.front();
+}
@@ -0,0 +1,58 @@
+#include "binary.hpp"
+
+#include "util/format.hpp"
+
+BinaryWriter::BinaryWriter(const std::string& path)
+    : mFile(std::fopen(path.c_str(), "wb")), mGood(mFile != nullptr) {
+    if (mFile == nullptr)
+        eprintln("File could not be created: {}", path);
+}
+
+BinaryWriter::~BinaryWriter() {
+    close();
+}
+
+bool BinaryWriter::isOpen() const {
+    return mGood;
+}
+
+void BinaryWriter::write(const void* data, const Size bytes) {
+    if (!mGood || bytes == 0)
+        return;
+
+    mGood = std::fwrite(data, 1, bytes, mFile) == bytes;
+}
+
+bool BinaryWriter::close() {
+    if (mFile != nullptr) {
+        mGood = std::fclose(mFile) == 0 && mGood;
+        mFile = nullptr;
+    }
+    return mGood;
+}
+
+BinaryReader::BinaryReader(const u8* data, const Size size)
+    : mData(data), mSize(size), mOffset(0) {
+}
+
+bool BinaryReader::read(void* dst, const Size bytes) {
+    const u8* src = view(bytes);
+    if (src == nullptr)
+        return false;
+
+    std::memcpy(dst, src, bytes);
+    return true;
+}
+
+const u8* BinaryReader::view(const Size bytes) {
+    if (bytes > remaining())
+        return nullptr;
+
+    const u8* src = mData + mOffset;
+    mOffset += bytes;
+    return src;
+}
+
+Size BinaryReader::remaining() const {
+    return mSize - mOffset;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "util/common.hpp"
+
+/// @brief Writes raw values to a binary file in the byte order of the host.
+class BinaryWriter {
+public:
+    /// @brief Creates the file at `path`. Check isOpen() for failure.
+    explicit BinaryWriter(const std::string& path);
+
+    /// @brief Closes the file.
+    ~BinaryWriter();
+
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+    /// @brief Indicates whether the file was created and every write so far
+    /// succeeded.
+    bool isOpen() const;
+
+    /// @brief Writes `bytes` bytes from `data`.
+    void write(const void* data, const Size bytes);
+
+    /// @brief Writes a trivially copyable value.
+    template <typename T>
+    void write(const T& value);
+
+    /// @brief Flushes and closes the file. Returns whether every write
+    /// succeeded.
+    bool close();
+
+private:
+    std::FILE* mFile;
+    bool mGood;
+};
+
+/// @brief Reads raw values from a byte range, such as a mapped file. Reads
+/// past the end fail and leave the destination untouched.
+class BinaryReader {
+public:
+    BinaryReader(const u8* data, const Size size);
+
+    /// @brief Reads `bytes` bytes into `dst`. Returns false past the end.
+    bool read(void* dst, const Size bytes);
+
+    /// @brief Reads a trivially copyable value. Returns false past the end.
+    template <typename T>
+    bool read(T& value);
+
+    /// @brief Pointer to the next `bytes` bytes, which are skipped. Returns
+    /// nullptr past the end.
+    const u8* view(const Size bytes);
+
+    /// @brief Number of unread bytes.
+    Size remaining() const;
+
+private:
+    const u8* mData;
+    Size mSize;
+    Size mOffset;
+};
+
+template <typename T>
+void BinaryWriter::write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>, "type must be trivial");
+    write(&value, sizeof(T));
+}
+
+template <typename T>
+bool BinaryReader::read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>, "type must be trivial");
+    return read(&value, sizeof(T));
+}
@@ -0,0 +1,577 @@
+#include "field_cache.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#include "field_codec.hpp"
+#include "util/format.hpp"
+
+namespace {
+
+constexpr char cMagic[8] = {'F', 'L', 'D', 'C', 'A', 'C', 'H', 'E'};
+constexpr char cIndexMagic[8] = {'F', 'L', 'D', 'I', 'N', 'D', 'E', 'X'};
+constexpr u32 cFrameMagic = 0x454d5246;  // "FRME"
+constexpr u32 cVersion = 2;
+
+struct FileHeader {
+    char magic[8];
+    u32 version;
+    u32 fieldCount;
+    i32 nx;
+    i32 ny;
+    f64 cellSize;
+};
+
+struct FieldRecord {
+    char name[16];
+    FieldType type;
+    i32 nx;
+    i32 ny;
+    u32 reserved;
+    f64 errorBound;
+};
+
+struct FrameHeader {
+    u32 magic;
+    u32 reserved;
+    u64 step;
+    u64 bytes;
+};
+
+struct IndexFooter {
+    u64 frameCount;
+    char magic[8];
+};
+
+static_assert(sizeof(FileHeader) == 32);
+static_assert(sizeof(FieldRecord) == 40);
+static_assert(sizeof(FrameHeader) == 24);
+static_assert(sizeof(IndexFooter) == 16);
+
+Size padded(const Size bytes) {
+    return (bytes + 7) & ~static_cast<Size>(7);
+}
+
+}
+
+Size FieldDesc::count() const {
+    return static_cast<Size>(nx) * ny;
+}
+
+Size FieldDesc::bytes() const {
+    switch (type) {
+    case FieldType::F32:
+        return count() * sizeof(f32);
+    case FieldType::F64:
+        return count() * sizeof(f64);
+    case FieldType::U8:
+        return count();
+    default:
+        unreachable;
+    }
+}
+
+bool FieldDesc::compressed() const {
+    return errorBound > 0.0;
+}
+
+FieldCacheWriter::FieldCacheWriter(const std::string& path,
+                                   const i32 nx,
+                                   const i32 ny,
+                                   const f64 cell_size,
+                                   const std::vector<FieldDesc>& fields,
+                                   const u32 thread_count)
+    : mFile(std::fopen(path.c_str(), "wb")),
+      mFields(fields),
+      mEnd(0),
+      mField(0),
+      mFilled(0),
+      mFrameCount(0),
+      mNextWrite(0),
+      mStop(false) {
+    if (mFile == nullptr) {
+        eprintln("Field cache could not be created: {}", path);
+        return;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, cMagic, sizeof(cMagic));
+    header.version = cVersion;
+    header.fieldCount = static_cast<u32>(mFields.size());
+    header.nx = nx;
+    header.ny = ny;
+    header.cellSize = cell_size;
+    std::fwrite(&header, sizeof(header), 1, mFile);
+
+    Size payload = 0;
+    bool compressed = false;
+    for (const FieldDesc& field : mFields) {
+        assertm(field.name.size() < 16, "field name too long");
+        assertm(!field.compressed() || field.type == FieldType::F64,
+                "only F64 fields can be compressed");
+
+        FieldRecord record = {};
+        std::memcpy(record.name, field.name.data(), field.name.size());
+        record.type = field.type;
+        record.nx = field.nx;
+        record.ny = field.ny;
+        record.errorBound = field.errorBound;
+        std::fwrite(&record, sizeof(record), 1, mFile);
+
+        payload += padded(field.bytes());
+        compressed = compressed || field.compressed();
+    }
+
+    mEnd = sizeof(FileHeader) + mFields.size() * sizeof(FieldRecord);
+    mFrame.reserve(sizeof(FrameHeader) + payload);
+
+    if (!compressed)
+        return;
+
+    mJobs.resize(cQueuedFrames);
+    for (Job& job : mJobs) {
+        job.raw.reserve(sizeof(FrameHeader) + payload);
+        mFree.push_back(&job);
+    }
+
+    const u32 count =
+        thread_count > 0
+            ? thread_count
+            : std::max(1u, std::thread::hardware_concurrency() / 2);
+
+    mWorkers.reserve(count);
+    for (u32 t = 0; t < count; ++t) mWorkers.emplace_back([this]() { work(); });
+}
+
+FieldCacheWriter::~FieldCacheWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mPendingReady.notify_all();
+
+    for (std::thread& worker : mWorkers) worker.join();
+
+    if (mFile == nullptr)
+        return;
+
+    std::fwrite(mOffsets.data(), sizeof(u64), mOffsets.size(), mFile);
+
+    IndexFooter footer;
+    footer.frameCount = mOffsets.size();
+    std::memcpy(footer.magic, cIndexMagic, sizeof(cIndexMagic));
+    std::fwrite(&footer, sizeof(footer), 1, mFile);
+
+    std::fclose(mFile);
+}
+
+bool FieldCacheWriter::isOpen() const {
+    return mFile != nullptr;
+}
+
+void FieldCacheWriter::beginFrame(const u64 step) {
+    FrameHeader header;
+    header.magic = cFrameMagic;
+    header.reserved = 0;
+    header.step = step;
+    header.bytes = 0;
+
+    mFrame.resize(sizeof(header));
+    std::memcpy(mFrame.data(), &header, sizeof(header));
+
+    mField = 0;
+    mFilled = 0;
+}
+
+void FieldCacheWriter::append(const f64* values, const Size count) {
+    assertm(mField < mFields.size(), "every field is already filled");
+    assertm(mFilled + count <= mFields[mField].count(), "field overflow");
+
+    const Size begin = mFrame.size();
+    switch (mFields[mField].type) {
+    case FieldType::F32: {
+        mFrame.resize(begin + count * sizeof(f32));
+        f32* dst = reinterpret_cast<f32*>(mFrame.data() + begin);
+        for (Size k = 0; k < count; ++k) dst[k] = static_cast<f32>(values[k]);
+        break;
+    }
+    case FieldType::F64:
+        mFrame.resize(begin + count * sizeof(f64));
+        std::memcpy(mFrame.data() + begin, values, count * sizeof(f64));
+        break;
+    default:
+        assertm(false, "field is not a floating-point field");
+    }
+
+    mFilled += count;
+    advance();
+}
+
+void FieldCacheWriter::append(const u8* values, const Size count) {
+    assertm(mField < mFields.size(), "every field is already filled");
+    assertm(mFields[mField].type == FieldType::U8, "field is not a U8 field");
+    assertm(mFilled + count <= mFields[mField].count(), "field overflow");
+
+    mFrame.insert(mFrame.end(), values, values + count);
+
+    mFilled += count;
+    advance();
+}
+
+void FieldCacheWriter::endFrame() {
+    assertm(mField == mFields.size(), "every field must be filled");
+
+    if (mFile == nullptr)
+        return;
+
+    ++mFrameCount;
+
+    if (mWorkers.empty()) {
+        write(mFrame);
+        return;
+    }
+
+    // Swap the filled frame into a free job, so the next frame is filled
+    // while this one is encoded.
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFreeReady.wait(lock, [this]() { return !mFree.empty(); });
+
+    Job* job = mFree.back();
+    mFree.pop_back();
+    std::swap(job->raw, mFrame);
+    job->sequence = mFrameCount - 1;
+    mPending.push_back(job);
+
+    lock.unlock();
+    mPendingReady.notify_one();
+}
+
+Size FieldCacheWriter::frameCount() const {
+    return mFrameCount;
+}
+
+void FieldCacheWriter::advance() {
+    if (mFilled < mFields[mField].count())
+        return;
+
+    // Pad the field to 8 bytes, so every field of a mapped frame is aligned.
+    mFrame.resize(sizeof(FrameHeader) +
+                  padded(mFrame.size() - sizeof(FrameHeader)));
+
+    ++mField;
+    mFilled = 0;
+}
+
+void FieldCacheWriter::encode(const std::vector<u8>& raw,
+                              std::vector<u8>& encoded) const {
+    encoded.assign(raw.begin(), raw.begin() + sizeof(FrameHeader));
+
+    const u8* src = raw.data() + sizeof(FrameHeader);
+    for (const FieldDesc& field : mFields) {
+        if (field.compressed()) {
+            const Size size_offset = encoded.size();
+            encoded.resize(size_offset + sizeof(u64));
+
+            FieldCodec::encode(reinterpret_cast<const f64*>(src),
+                               field.nx,
+                               field.ny,
+                               field.errorBound,
+                               encoded);
+
+            const u64 size = encoded.size() - size_offset - sizeof(u64);
+            std::memcpy(encoded.data() + size_offset, &size, sizeof(size));
+        } else {
+            encoded.insert(encoded.end(), src, src + field.bytes());
+        }
+
+        encoded.resize(sizeof(FrameHeader) +
+                       padded(encoded.size() - sizeof(FrameHeader)));
+        src += padded(field.bytes());
+    }
+}
+
+void FieldCacheWriter::write(std::vector<u8>& frame) {
+    const u64 bytes = frame.size() - sizeof(FrameHeader);
+    std::memcpy(frame.data() + offsetof(FrameHeader, bytes),
+                &bytes,
+                sizeof(bytes));
+
+    std::fwrite(frame.data(), 1, frame.size(), mFile);
+
+    mOffsets.push_back(mEnd);
+    mEnd += frame.size();
+}
+
+void FieldCacheWriter::work() {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true) {
+        mPendingReady.wait(lock,
+                           [this]() { return mStop || !mPending.empty(); });
+
+        // Queued frames are still written when stopping.
+        if (mPending.empty())
+            return;
+
+        Job* job = mPending.front();
+        mPending.pop_front();
+
+        lock.unlock();
+        encode(job->raw, job->encoded);
+        lock.lock();
+
+        // Frames are taken in order, so the earliest unwritten frame is
+        // always being encoded and this wait ends.
+        mWritten.wait(lock, [&]() { return mNextWrite == job->sequence; });
+
+        lock.unlock();
+        write(job->encoded);
+        lock.lock();
+
+        ++mNextWrite;
+        mFree.push_back(job);
+        mFreeReady.notify_one();
+        mWritten.notify_all();
+    }
+}
+
+FieldCacheReader::FieldCacheReader(const std::string& path)
+    : mFile(path),
+      mValid(false),
+      mNx(0),
+      mNy(0),
+      mCellSize(0.0) {
+    if (!mFile.isOpen())
+        return;
+
+    FileHeader header;
+    if (mFile.size() < sizeof(header)) {
+        eprintln("Not a field cache: {}", path);
+        return;
+    }
+    std::memcpy(&header, mFile.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, cMagic, sizeof(cMagic)) != 0 ||
+        header.version != cVersion) {
+        eprintln("Not a field cache: {}", path);
+        return;
+    }
+
+    const u64 frames_begin =
+        sizeof(FileHeader) + header.fieldCount * sizeof(FieldRecord);
+    if (mFile.size() < frames_begin) {
+        eprintln("Truncated field cache: {}", path);
+        return;
+    }
+
+    mNx = header.nx;
+    mNy = header.ny;
+    mCellSize = header.cellSize;
+
+    for (u32 k = 0; k < header.fieldCount; ++k) {
+        FieldRecord record;
+        std::memcpy(&record,
+                    mFile.data() + sizeof(FileHeader) + k * sizeof(record),
+                    sizeof(record));
+        record.name[sizeof(record.name) - 1] = '\0';
+
+        if (record.type != FieldType::F32 && record.type != FieldType::F64 &&
+            record.type != FieldType::U8) {
+            eprintln("Unknown type of field {} in field cache: {}",
+                     record.name,
+                     path);
+            return;
+        }
+        if (record.nx < 0 || record.ny < 0) {
+            eprintln("Invalid dimensions of field {} in field cache: {}",
+                     record.name,
+                     path);
+            return;
+        }
+
+        FieldDesc field;
+        field.name = record.name;
+        field.type = record.type;
+        field.nx = record.nx;
+        field.ny = record.ny;
+        field.errorBound = record.errorBound;
+        mFields.push_back(field);
+    }
+
+    if (!readIndex(frames_begin))
+        scanFrames(frames_begin);
+
+    mValid = true;
+}
+
+bool FieldCacheReader::isOpen() const {
+    return mValid;
+}
+
+i32 FieldCacheReader::nx() const {
+    return mNx;
+}
+
+i32 FieldCacheReader::ny() const {
+    return mNy;
+}
+
+f64 FieldCacheReader::cellSize() const {
+    return mCellSize;
+}
+
+const std::vector<FieldDesc>& FieldCacheReader::fields() const {
+    return mFields;
+}
+
+i32 FieldCacheReader::fieldIndex(const std::string& name) const {
+    for (Size k = 0; k < mFields.size(); ++k) {
+        if (mFields[k].name == name)
+            return static_cast<i32>(k);
+    }
+    return -1;
+}
+
+Size FieldCacheReader::frameCount() const {
+    return mOffsets.size();
+}
+
+u64 FieldCacheReader::step(const Index frame) const {
+    assertm(frame < mOffsets.size(), "frame out of bounds");
+
+    FrameHeader header;
+    std::memcpy(&header, mFile.data() + mOffsets[frame], sizeof(header));
+    return header.step;
+}
+
+const void* FieldCacheReader::data(const Index frame, const u32 field) const {
+    assertm(!mFields[field].compressed(), "field is compressed");
+
+    u64 bytes;
+    return locate(frame, field, bytes);
+}
+
+bool FieldCacheReader::read(const Index frame,
+                            const u32 field,
+                            f64* dst) const {
+    u64 bytes;
+    const u8* src = locate(frame, field, bytes);
+    if (src == nullptr)
+        return false;
+
+    const FieldDesc& desc = mFields[field];
+    if (desc.compressed())
+        return FieldCodec::decode(
+            src, bytes, desc.nx, desc.ny, desc.errorBound, dst);
+
+    switch (desc.type) {
+    case FieldType::F32: {
+        const f32* values = reinterpret_cast<const f32*>(src);
+        std::copy(values, values + desc.count(), dst);
+        break;
+    }
+    case FieldType::F64:
+        std::memcpy(dst, src, desc.bytes());
+        break;
+    case FieldType::U8:
+        std::copy(src, src + desc.count(), dst);
+        break;
+    default:
+        unreachable;
+    }
+    return true;
+}
+
+const u8* FieldCacheReader::locate(const Index frame,
+                                   const u32 field,
+                                   u64& bytes) const {
+    assertm(frame < mOffsets.size(), "frame out of bounds");
+    assertm(field < mFields.size(), "field out of bounds");
+
+    FrameHeader header;
+    std::memcpy(&header, mFile.data() + mOffsets[frame], sizeof(header));
+
+    const u64 begin = mOffsets[frame] + sizeof(FrameHeader);
+    if (header.bytes > mFile.size() - begin)
+        return nullptr;
+    const u64 end = begin + header.bytes;
+
+    // Compressed fields vary in size, so walk the fields before this one.
+    u64 offset = begin;
+    for (u32 k = 0;; ++k) {
+        u64 size = mFields[k].bytes();
+        if (mFields[k].compressed()) {
+            if (end - offset < sizeof(size))
+                return nullptr;
+            std::memcpy(&size, mFile.data() + offset, sizeof(size));
+            offset += sizeof(size);
+        }
+
+        if (size > end - offset)
+            return nullptr;
+
+        if (k == field) {
+            bytes = size;
+            return mFile.data() + offset;
+        }
+
+        offset = begin + padded(offset + size - begin);
+        if (offset > end)
+            return nullptr;
+    }
+}
+
+bool FieldCacheReader::readIndex(const u64 frames_begin) {
+    if (mFile.size() < frames_begin + sizeof(IndexFooter))
+        return false;
+
+    IndexFooter footer;
+    std::memcpy(&footer,
+                mFile.data() + mFile.size() - sizeof(footer),
+                sizeof(footer));
+    if (std::memcmp(footer.magic, cIndexMagic, sizeof(cIndexMagic)) != 0)
+        return false;
+
+    // Compare counts rather than sizes, so a corrupt count cannot overflow.
+    const u64 available = mFile.size() - frames_begin - sizeof(IndexFooter);
+    if (footer.frameCount > available / sizeof(u64))
+        return false;
+
+    const u64 index_bytes = footer.frameCount * sizeof(u64);
+    const u64 index_begin = mFile.size() - sizeof(footer) - index_bytes;
+
+    std::vector<u64> offsets(footer.frameCount);
+    std::memcpy(offsets.data(), mFile.data() + index_begin, index_bytes);
+
+    // Every entry must point at a frame header between the field records and
+    // the index.
+    for (const u64 offset : offsets) {
+        if (offset < frames_begin ||
+            offset > index_begin - sizeof(FrameHeader))
+            return false;
+
+        FrameHeader header;
+        std::memcpy(&header, mFile.data() + offset, sizeof(header));
+        if (header.magic != cFrameMagic)
+            return false;
+    }
+
+    mOffsets = std::move(offsets);
+    return true;
+}
+
+void FieldCacheReader::scanFrames(const u64 frames_begin) {
+    u64 offset = frames_begin;
+    while (offset + sizeof(FrameHeader) <= mFile.size()) {
+        FrameHeader header;
+        std::memcpy(&header, mFile.data() + offset, sizeof(header));
+        if (header.magic != cFrameMagic ||
+            header.bytes > mFile.size() - offset - sizeof(FrameHeader))
+            break;
+
+        mOffsets.push_back(offset);
+        offset += sizeof(FrameHeader) + header.bytes;
+    }
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "util/common.hpp"
+
+/// @brief Storage type of a cached field.
+enum class FieldType : u32 {
+    F32 = 0,
+    F64,
+    U8
+};
+
+/// @brief Name, storage type and dimensions of a cached field.
+struct FieldDesc {
+    /// @brief Field name, at most 15 characters.
+    std::string name;
+    FieldType type;
+    i32 nx;
+    i32 ny;
+
+    /// @brief Maximum absolute error of the stored values. Fields with a
+    /// positive bound are compressed with FieldCodec, which is only
+    /// supported for F64 fields. Fields are stored exactly when zero.
+    f64 errorBound = 0.0;
+
+    /// @brief Number of values in the field.
+    Size count() const;
+
+    /// @brief Size of the uncompressed field in bytes, without padding.
+    Size bytes() const;
+
+    /// @brief Whether the field is stored compressed.
+    bool compressed() const;
+};
+
+/// @brief Append-only writer of a binary field cache.
+///
+/// A cache holds a header with the grid dimensions, cell size and field
+/// descriptors, followed by one frame per call to beginFrame()/endFrame().
+/// Every frame stores its fields in declaration order, each padded to 8
+/// bytes. Uncompressed fields are raw row-major values, and compressed fields
+/// are their encoded size followed by the encoding. Closing the writer
+/// appends an index of frame offsets. Values are stored in the byte order of
+/// the host.
+///
+/// When any field is compressed, ended frames are encoded on background
+/// threads and written in order. A fixed number of frames can be queued, so
+/// endFrame() blocks once the encoders fall that far behind.
+class FieldCacheWriter {
+public:
+    /// @brief Creates the cache file at `path`. Check isOpen() for failure.
+    /// @param thread_count Number of encoder threads when a field is
+    /// compressed. A count of 0 uses half the hardware concurrency.
+    FieldCacheWriter(const std::string& path,
+                     const i32 nx,
+                     const i32 ny,
+                     const f64 cell_size,
+                     const std::vector<FieldDesc>& fields,
+                     const u32 thread_count = 0);
+
+    /// @brief Writes the queued frames and the frame index, then closes the
+    /// file.
+    ~FieldCacheWriter();
+
+    FieldCacheWriter(const FieldCacheWriter&) = delete;
+    FieldCacheWriter& operator=(const FieldCacheWriter&) = delete;
+
+    /// @brief Indicates whether the file was created.
+    bool isOpen() const;
+
+    /// @brief Starts a frame for solver step `step`.
+    void beginFrame(const u64 step);
+
+    /// @brief Appends values to the current frame. Fields are filled in
+    /// declaration order and values may be appended a row at a time. Values
+    /// are converted to the type of the field being filled.
+    void append(const f64* values, const Size count);
+
+    /// @brief Appends label values to the current frame. The field being
+    /// filled must be of type U8.
+    void append(const u8* values, const Size count);
+
+    /// @brief Writes the current frame, or queues it for encoding. Every
+    /// field must be filled.
+    void endFrame();
+
+    /// @brief Number of frames ended.
+    Size frameCount() const;
+
+private:
+    /// @brief Frame queued for encoding.
+    struct Job {
+        /// @brief Frame as filled by append().
+        std::vector<u8> raw;
+
+        /// @brief Frame as written to the file.
+        std::vector<u8> encoded;
+
+        /// @brief Position of the frame in the file.
+        u64 sequence;
+    };
+
+    /// @brief Number of frames that can be queued for encoding.
+    static constexpr u32 cQueuedFrames = 4;
+
+    /// @brief Advances to the next field once the current one is full.
+    void advance();
+
+    /// @brief Compresses the fields of a filled frame.
+    void encode(const std::vector<u8>& raw, std::vector<u8>& encoded) const;
+
+    /// @brief Writes a frame to the end of the file.
+    void write(std::vector<u8>& frame);
+
+    void work();
+
+    std::FILE* mFile;
+    std::vector<FieldDesc> mFields;
+
+    /// @brief Offset of every written frame.
+    std::vector<u64> mOffsets;
+
+    /// @brief Offset of the next frame.
+    u64 mEnd;
+
+    /// @brief Current frame, including its header.
+    std::vector<u8> mFrame;
+
+    /// @brief Field being filled and the number of values it already holds.
+    u32 mField;
+    Size mFilled;
+
+    Size mFrameCount;
+
+    /// @brief Frame pool of the encoder threads. Never resized, so pointers
+    /// into it stay valid.
+    std::vector<Job> mJobs;
+
+    std::mutex mMutex;
+    std::condition_variable mFreeReady;
+    std::condition_variable mPendingReady;
+    std::condition_variable mWritten;
+
+    std::vector<Job*> mFree;
+    std::deque<Job*> mPending;
+
+    /// @brief Sequence number of the next frame to write.
+    u64 mNextWrite;
+    bool mStop;
+
+    /// @brief Encoder threads. Empty when no field is compressed.
+    std::vector<std::thread> mWorkers;
+};
+
+/// @brief Reader of a binary field cache through a memory mapping. Opening
+/// only reads the header and index, and field accessors return pointers into
+/// the mapping without copying.
+class FieldCacheReader {
+public:
+    /// @brief Maps the cache at `path`. Check isOpen() for failure. Caches
+    /// without an index, such as those of an interrupted run, are indexed by
+    /// walking their frames.
+    explicit FieldCacheReader(const std::string& path);
+
+    /// @brief Indicates whether a valid cache is open.
+    bool isOpen() const;
+
+    /// @brief Number of columns of the simulation grid.
+    i32 nx() const;
+
+    /// @brief Number of rows of the simulation grid.
+    i32 ny() const;
+
+    /// @brief Size of a grid cell in world space.
+    f64 cellSize() const;
+
+    /// @brief Descriptors of the cached fields.
+    const std::vector<FieldDesc>& fields() const;
+
+    /// @brief Index of the field called `name`, or -1 if there is none.
+    i32 fieldIndex(const std::string& name) const;
+
+    /// @brief Number of frames.
+    Size frameCount() const;
+
+    /// @brief Solver step of frame `frame`.
+    u64 step(const Index frame) const;
+
+    /// @brief Pointer to the values of field `field` in frame `frame`, or
+    /// nullptr if the frame is corrupt. The pointer stays valid as long as the
+    /// reader. The field must not be compressed.
+    const void* data(const Index frame, const u32 field) const;
+
+    /// @brief Typed pointer to the values of a field. `T` must match the
+    /// field type.
+    template <typename T>
+    const T* field(const Index frame, const u32 field) const;
+
+    /// @brief Copies the values of a field into `dst`, decoding compressed
+    /// fields and converting others to f64. Returns false if the frame is
+    /// corrupt.
+    bool read(const Index frame, const u32 field, f64* dst) const;
+
+private:
+    /// @brief Start and stored size of a field within a frame, or nullptr if
+    /// the frame is corrupt.
+    const u8* locate(const Index frame, const u32 field, u64& bytes) const;
+
+    /// @brief Reads the index at the end of the file. Returns false if there
+    /// is none.
+    bool readIndex(const u64 frames_begin);
+
+    /// @brief Indexes the frames by walking their headers.
+    void scanFrames(const u64 frames_begin);
+
+    /// @brief Storage type matching `T`.
+    template <typename T>
+    static constexpr FieldType typeOf();
+
+    MappedFile mFile;
+    bool mValid;
+
+    i32 mNx;
+    i32 mNy;
+    f64 mCellSize;
+    std::vector<FieldDesc> mFields;
+
+    /// @brief Offset of every frame header.
+    std::vector<u64> mOffsets;
+};
+
+template <typename T>
+const T* FieldCacheReader::field(const Index frame, const u32 field) const {
+    assertm(mFields[field].type == typeOf<T>(), "field type mismatch");
+    return static_cast<const T*>(data(frame, field));
+}
+
+template <typename T>
+constexpr FieldType FieldCacheReader::typeOf() {
+    if constexpr (std::is_same_v<T, f32>)
+        return FieldType::F32;
+    else if constexpr (std::is_same_v<T, f64>)
+        return FieldType::F64;
+    else
+        static_assert(std::is_same_v<T, u8>, "unsupported field type");
+    return FieldType::U8;
+}
@@ -0,0 +1,366 @@
+#include "field_codec.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+
+namespace {
+
+/// @brief Appends codes to a byte buffer, most significant bit first.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<u8>& out) : mOut(out), mBits(0), mCount(0) {
+    }
+
+    void write(const u32 code, const u32 length) {
+        mBits = (mBits << length) | code;
+        mCount += length;
+        while (mCount >= 8) {
+            mCount -= 8;
+            mOut.push_back(static_cast<u8>(mBits >> mCount));
+        }
+    }
+
+    /// @brief Writes the last partial byte, padded with zeros.
+    void flush() {
+        if (mCount > 0)
+            mOut.push_back(static_cast<u8>(mBits << (8 - mCount)));
+        mCount = 0;
+    }
+
+private:
+    std::vector<u8>& mOut;
+    u64 mBits;
+    u32 mCount;
+};
+
+/// @brief Reads bits written by BitWriter. Reads past the end return zeros.
+class BitReader {
+public:
+    BitReader(const u8* data, const Size bytes)
+        : mData(data), mBytes(bytes), mOffset(0), mBits(0), mCount(0) {
+    }
+
+    /// @brief Next `length` bits without consuming them, at most 32.
+    u32 peek(const u32 length) {
+        while (mCount < length) {
+            const u64 byte = mOffset < mBytes ? mData[mOffset] : 0;
+            ++mOffset;
+            mBits = (mBits << 8) | byte;
+            mCount += 8;
+        }
+        return static_cast<u32>(mBits >> (mCount - length)) &
+               ((1u << length) - 1);
+    }
+
+    void consume(const u32 length) {
+        mCount -= length;
+    }
+
+    /// @brief Whether more bits were consumed than the data holds.
+    bool overrun() const {
+        return mOffset * 8 - mCount > mBytes * 8;
+    }
+
+private:
+    const u8* mData;
+    Size mBytes;
+    Size mOffset;
+    u64 mBits;
+    u32 mCount;
+};
+
+template <typename T>
+void put(std::vector<u8>& out, const T& value) {
+    const u8* bytes = reinterpret_cast<const u8*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+bool take(const u8*& data, const u8* end, T& value) {
+    if (static_cast<Size>(end - data) < sizeof(T))
+        return false;
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+}
+
+void FieldCodec::encode(const f64* values,
+                        const i32 nx,
+                        const i32 ny,
+                        const f64 error_bound,
+                        std::vector<u8>& out) {
+    assertm(error_bound > 0.0, "error bound must be positive");
+
+    const Size count = static_cast<Size>(nx) * ny;
+    const f64 step = 2.0 * error_bound;
+
+    // Quantize against the decoded values, so the decoder makes the same
+    // predictions.
+    std::vector<f64> decoded(count);
+    std::vector<u16> symbols(count);
+    std::vector<f64> verbatim;
+    std::vector<u32> frequencies(cSymbolCount, 0);
+
+    for (i32 j = 0; j < ny; ++j) {
+        for (i32 i = 0; i < nx; ++i) {
+            const Index k = static_cast<Index>(j) * nx + i;
+            const f64 prediction = predict(decoded.data(), nx, i, j);
+            const f64 scaled = (values[k] - prediction) / step;
+
+            u16 symbol = 0;
+            if (std::fabs(scaled) < cRadius - 1) {
+                const i32 q = static_cast<i32>(std::lround(scaled));
+                const f64 value = prediction + q * step;
+                if (std::fabs(value - values[k]) <= error_bound) {
+                    symbol = static_cast<u16>(q + cRadius);
+                    decoded[k] = value;
+                }
+            }
+
+            // Also taken for NaNs, which fail every comparison.
+            if (symbol == 0) {
+                verbatim.push_back(values[k]);
+                decoded[k] = values[k];
+            }
+
+            symbols[k] = symbol;
+            ++frequencies[symbol];
+        }
+    }
+
+    std::vector<u8> lengths;
+    buildLengths(frequencies, lengths);
+
+    std::vector<u32> codes;
+    std::vector<u16> sorted;
+    buildCodes(lengths, codes, sorted);
+
+    put(out, static_cast<u64>(verbatim.size()));
+    for (const f64 value : verbatim) put(out, value);
+
+    put(out, static_cast<u32>(sorted.size()));
+    for (const u16 s : sorted) {
+        put(out, s);
+        put(out, lengths[s]);
+    }
+
+    BitWriter writer(out);
+    for (const u16 symbol : symbols)
+        writer.write(codes[symbol], lengths[symbol]);
+    writer.flush();
+}
+
+bool FieldCodec::decode(const u8* data,
+                        const Size bytes,
+                        const i32 nx,
+                        const i32 ny,
+                        const f64 error_bound,
+                        f64* values) {
+    const u8* end = data + bytes;
+    const f64 step = 2.0 * error_bound;
+
+    u64 verbatim_count;
+    if (!take(data, end, verbatim_count) ||
+        verbatim_count > static_cast<Size>(end - data) / sizeof(f64))
+        return false;
+    const u8* verbatim = data;
+    data += verbatim_count * sizeof(f64);
+
+    u32 used;
+    if (!take(data, end, used) || used > cSymbolCount)
+        return false;
+
+    std::vector<u8> lengths(cSymbolCount, 0);
+    for (u32 k = 0; k < used; ++k) {
+        u16 symbol;
+        u8 length;
+        if (!take(data, end, symbol) || !take(data, end, length) ||
+            length == 0 || length > cMaxCodeLength)
+            return false;
+        lengths[symbol] = length;
+    }
+
+    std::vector<u32> codes;
+    std::vector<u16> sorted;
+    buildCodes(lengths, codes, sorted);
+
+    // Codes no longer than cLookupBits are decoded with one table lookup.
+    // Entries hold the symbol and code length, or zero when the code is
+    // longer.
+    std::vector<u32> table(1u << cLookupBits, 0);
+
+    // Longer codes are decoded canonically from the number of codes of each
+    // length and the symbols sorted by code.
+    std::vector<u32> length_counts(cMaxCodeLength + 1, 0);
+
+    for (const u16 s : sorted) {
+        const u32 length = lengths[s];
+        ++length_counts[length];
+
+        // Lengths that do not form a prefix code overflow their length.
+        if (codes[s] >> length != 0)
+            return false;
+
+        if (length <= cLookupBits) {
+            const u32 shift = cLookupBits - length;
+            std::fill_n(table.begin() + (codes[s] << shift),
+                        1u << shift,
+                        (static_cast<u32>(s) << 8) | length);
+        }
+    }
+
+    BitReader reader(data, static_cast<Size>(end - data));
+    Index next_verbatim = 0;
+
+    for (i32 j = 0; j < ny; ++j) {
+        for (i32 i = 0; i < nx; ++i) {
+            u32 symbol;
+            const u32 entry = table[reader.peek(cLookupBits)];
+            if (entry != 0) {
+                symbol = entry >> 8;
+                reader.consume(entry & 0xff);
+            } else {
+                // Walk the code lengths, comparing the code read so far with
+                // the first code of each length.
+                u32 code = 0;
+                u32 first = 0;
+                u32 index = 0;
+                u32 length = 1;
+                for (; length <= cMaxCodeLength; ++length) {
+                    code |= reader.peek(1);
+                    reader.consume(1);
+                    if (code - first < length_counts[length])
+                        break;
+                    index += length_counts[length];
+                    first = (first + length_counts[length]) << 1;
+                    code <<= 1;
+                }
+                if (length > cMaxCodeLength)
+                    return false;
+                symbol = sorted[index + code - first];
+            }
+
+            const Index k = static_cast<Index>(j) * nx + i;
+            if (symbol == 0) {
+                if (next_verbatim == verbatim_count)
+                    return false;
+                std::memcpy(values + k,
+                            verbatim + next_verbatim * sizeof(f64),
+                            sizeof(f64));
+                ++next_verbatim;
+            } else {
+                const i32 q = static_cast<i32>(symbol) - cRadius;
+                values[k] = predict(values, nx, i, j) + q * step;
+            }
+        }
+    }
+
+    return !reader.overrun();
+}
+
+f64 FieldCodec::predict(const f64* decoded,
+                        const i32 nx,
+                        const i32 i,
+                        const i32 j) {
+    const Index k = static_cast<Index>(j) * nx + i;
+    if (i > 0 && j > 0)
+        return decoded[k - 1] + decoded[k - nx] - decoded[k - nx - 1];
+    if (i > 0)
+        return decoded[k - 1];
+    if (j > 0)
+        return decoded[k - nx];
+    return 0.0;
+}
+
+void FieldCodec::buildLengths(const std::vector<u32>& frequencies,
+                              std::vector<u8>& lengths) {
+    lengths.assign(cSymbolCount, 0);
+
+    std::vector<u64> weights(frequencies.begin(), frequencies.end());
+
+    while (true) {
+        // Leaves come first, followed by the merged nodes in the order they
+        // are created, so every parent comes after its children.
+        std::vector<u32> leaves;
+        std::vector<u32> parents;
+        using Node = std::pair<u64, u32>;
+        std::priority_queue<Node, std::vector<Node>, std::greater<Node>> heap;
+
+        for (u32 s = 0; s < cSymbolCount; ++s) {
+            if (weights[s] == 0)
+                continue;
+            heap.push({weights[s], static_cast<u32>(leaves.size())});
+            leaves.push_back(s);
+            parents.push_back(0);
+        }
+
+        if (leaves.size() == 1) {
+            lengths[leaves[0]] = 1;
+            return;
+        }
+
+        while (heap.size() > 1) {
+            const Node a = heap.top();
+            heap.pop();
+            const Node b = heap.top();
+            heap.pop();
+
+            const u32 node = static_cast<u32>(parents.size());
+            parents.push_back(0);
+            parents[a.second] = node;
+            parents[b.second] = node;
+            heap.push({a.first + b.first, node});
+        }
+
+        std::vector<u32> depths(parents.size(), 0);
+        for (Index n = parents.size() - 1; n-- > 0;)
+            depths[n] = depths[parents[n]] + 1;
+
+        u32 longest = 0;
+        for (Index n = 0; n < leaves.size(); ++n)
+            longest = std::max(longest, depths[n]);
+
+        if (longest <= cMaxCodeLength) {
+            for (Index n = 0; n < leaves.size(); ++n)
+                lengths[leaves[n]] = static_cast<u8>(depths[n]);
+            return;
+        }
+
+        // Flatten the distribution and try again. Used symbols stay used.
+        for (u64& weight : weights) {
+            if (weight > 0)
+                weight = (weight + 1) / 2;
+        }
+    }
+}
+
+void FieldCodec::buildCodes(const std::vector<u8>& lengths,
+                            std::vector<u32>& codes,
+                            std::vector<u16>& sorted) {
+    codes.assign(cSymbolCount, 0);
+
+    sorted.clear();
+    for (u32 s = 0; s < cSymbolCount; ++s) {
+        if (lengths[s] > 0)
+            sorted.push_back(static_cast<u16>(s));
+    }
+
+    // Codes are assigned in order of length, then symbol.
+    std::stable_sort(
+        sorted.begin(), sorted.end(), [&](const u16 a, const u16 b) {
+            return lengths[a] < lengths[b];
+        });
+
+    u32 code = 0;
+    u32 previous = 0;
+    for (const u16 s : sorted) {
+        code <<= lengths[s] - previous;
+        previous = lengths[s];
+        codes[s] = code;
+        ++code;
+    }
+}
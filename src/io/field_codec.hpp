@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "util/common.hpp"
+
+/// @brief Error-bounded lossy codec for 2D f64 fields.
+///
+/// Every value is predicted from its already decoded left, lower and
+/// lower-left neighbours (the Lorenzo predictor), and the prediction error is
+/// quantized to a multiple of twice the error bound, so every decoded value
+/// is within the bound of the original. Smooth fields quantize to a handful
+/// of small codes, which are then Huffman coded. Values the quantizer cannot
+/// represent, such as NaNs or sharp jumps, are stored verbatim.
+class FieldCodec {
+public:
+    /// @brief Appends the encoding of `nx * ny` row-major values to `out`.
+    /// @param error_bound Maximum absolute error of a decoded value. Must be
+    /// positive.
+    static void encode(const f64* values,
+                       const i32 nx,
+                       const i32 ny,
+                       const f64 error_bound,
+                       std::vector<u8>& out);
+
+    /// @brief Decodes `nx * ny` values encoded with the same dimensions and
+    /// error bound. Returns false if the data is truncated or corrupt.
+    static bool decode(const u8* data,
+                       const Size bytes,
+                       const i32 nx,
+                       const i32 ny,
+                       const f64 error_bound,
+                       f64* values);
+
+private:
+    /// @brief Quantization codes are offset by this radius. Code 0 marks a
+    /// value stored verbatim.
+    static constexpr i32 cRadius = 1 << 15;
+
+    /// @brief Number of distinct codes.
+    static constexpr u32 cSymbolCount = 2 * cRadius;
+
+    /// @brief Longest Huffman code. Longer codes are avoided by flattening
+    /// the frequencies.
+    static constexpr u32 cMaxCodeLength = 24;
+
+    /// @brief Width of the decoder lookup table. Longer codes are decoded a
+    /// bit at a time.
+    static constexpr u32 cLookupBits = 11;
+
+    /// @brief Prediction of value (i, j) from decoded values.
+    static f64 predict(const f64* decoded,
+                       const i32 nx,
+                       const i32 i,
+                       const i32 j);
+
+    /// @brief Huffman code lengths of the used symbols, at most
+    /// cMaxCodeLength.
+    static void buildLengths(const std::vector<u32>& frequencies,
+                             std::vector<u8>& lengths);
+
+    /// @brief Canonical codes of the given lengths, and the used symbols
+    /// sorted by code.
+    static void buildCodes(const std::vector<u8>& lengths,
+                           std::vector<u32>& codes,
+                           std::vector<u16>& sorted);
+};
@@ -0,0 +1,22 @@
+#include "field_recorder.hpp"
+
+FieldRecorder::FieldRecorder(const std::string& path, const f64 error_bound)
+    : mPath(path), mErrorBound(error_bound) {
+}
+
+void FieldRecorder::open(const i32 nx, const i32 ny, const f64 cell_size) {
+    if (mPath.empty())
+        return;
+
+    mCache = std::make_unique<FieldCacheWriter>(
+        mPath, nx, ny, cell_size, mFields);
+}
+
+void FieldRecorder::record(const u64 step) {
+    if (!mCache)
+        return;
+
+    mCache->beginFrame(step);
+    for (const auto& append : mAppends) append(*mCache);
+    mCache->endFrame();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "field_cache.hpp"
+#include "util/common.hpp"
+
+/// @brief Descriptor of a grid stored as f64, compressed when `error_bound`
+/// is positive. `G` has `nx()` and `ny()`.
+template <typename G>
+FieldDesc gridField(const char* name, const G& grid, const f64 error_bound) {
+    return FieldDesc{name, FieldType::F64, grid.nx(), grid.ny(), error_bound};
+}
+
+/// @brief Descriptor of a label grid stored as one byte per cell.
+template <typename L>
+FieldDesc labelField(const char* name, const L& labels) {
+    return FieldDesc{name, FieldType::U8, labels.nx(), labels.ny()};
+}
+
+/// @brief Appends the interior of a grid to the current cache frame. `G` has
+/// `row(j)` returning the `nx()` values of row `j`.
+template <typename G>
+void appendRows(FieldCacheWriter& cache, const G& grid) {
+    for (i32 j = 0; j < grid.ny(); ++j) cache.append(grid.row(j), grid.nx());
+}
+
+/// @brief Appends a label grid to the current cache frame, one byte per
+/// cell.
+template <typename L>
+void appendLabels(FieldCacheWriter& cache, const L& labels) {
+    std::vector<u8> row(labels.nx());
+    for (i32 j = 0; j < labels.ny(); ++j) {
+        for (i32 i = 0; i < labels.nx(); ++i)
+            row[i] = static_cast<u8>(labels(i, j));
+        cache.append(row.data(), row.size());
+    }
+}
+
+/// @brief Records solver grids into a field cache after every step.
+///
+/// The grids are registered once by reference and read again by record(),
+/// so they must outlive the recorder. Without a path, nothing is registered
+/// or written.
+class FieldRecorder {
+public:
+    /// @param path Cache file. Nothing is recorded when empty.
+    /// @param error_bound Maximum absolute error of the recorded grids.
+    FieldRecorder(const std::string& path, const f64 error_bound);
+
+    /// @brief Registers a grid of f64 values.
+    template <typename G>
+    void addGrid(const char* name, const G& q);
+
+    /// @brief Registers a label grid.
+    template <typename L>
+    void addLabels(const char* name, const L& labels);
+
+    /// @brief Creates the cache for the registered fields. Call once every
+    /// field is registered.
+    void open(const i32 nx, const i32 ny, const f64 cell_size);
+
+    /// @brief Appends a frame of every registered field for solver step
+    /// `step`.
+    void record(const u64 step);
+
+private:
+    std::string mPath;
+    f64 mErrorBound;
+
+    std::vector<FieldDesc> mFields;
+    std::vector<std::function<void(FieldCacheWriter&)>> mAppends;
+
+    std::unique_ptr<FieldCacheWriter> mCache;
+};
+
+template <typename G>
+void FieldRecorder::addGrid(const char* name, const G& q) {
+    if (mPath.empty())
+        return;
+
+    mFields.push_back(gridField(name, q, mErrorBound));
+    mAppends.push_back([&q](FieldCacheWriter& cache) { appendRows(cache, q); });
+}
+
+template <typename L>
+void FieldRecorder::addLabels(const char* name, const L& labels) {
+    if (mPath.empty())
+        return;
+
+    mFields.push_back(labelField(name, labels));
+    mAppends.push_back(
+        [&labels](FieldCacheWriter& cache) { appendLabels(cache, labels); });
+}
@@ -0,0 +1,245 @@
+#include "field_replay.hpp"
+
+#include <algorithm>
+
+#include "util/format.hpp"
+
+FieldReplay::FieldReplay(const std::string& path,
+                         const std::string& field,
+                         const f64 fps,
+                         const u32 prefetch)
+    : mCache(path),
+      mField(-1),
+      mFps(fps),
+      mPlayhead(0),
+      mShown(cNone),
+      mPlaying(false),
+      mLoop(false),
+      mElapsed(0.0),
+      mLastUpdate(Clock::now()),
+      mStop(false) {
+    assertm(fps > 0.0, "playback rate must be positive");
+    assertm(prefetch > 0, "prefetch must be positive");
+
+    if (!mCache.isOpen())
+        return;
+
+    mField = mCache.fieldIndex(field);
+    if (mField < 0) {
+        eprintln("Field {} not found in {}", field, path);
+        return;
+    }
+
+    // One slot more than the window, for the frame on screen.
+    mSlots.resize(prefetch + 1);
+    for (Slot& slot : mSlots) {
+        slot.values.resize(mCache.fields()[mField].count());
+        slot.frame = cNone;
+        slot.ready = false;
+    }
+
+    mReader = std::thread([this]() { work(); });
+}
+
+FieldReplay::~FieldReplay() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_one();
+
+    if (mReader.joinable())
+        mReader.join();
+}
+
+bool FieldReplay::isOpen() const {
+    return mReader.joinable();
+}
+
+i32 FieldReplay::nx() const {
+    return mCache.fields()[mField].nx;
+}
+
+i32 FieldReplay::ny() const {
+    return mCache.fields()[mField].ny;
+}
+
+Size FieldReplay::frameCount() const {
+    return mCache.frameCount();
+}
+
+Index FieldReplay::position() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPlayhead;
+}
+
+u64 FieldReplay::step() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return frameCount() > 0 ? mCache.step(mPlayhead) : 0;
+}
+
+void FieldReplay::togglePlaying() {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Playing from the last frame starts over.
+    if (!mPlaying && !mLoop && mPlayhead + 1 >= frameCount())
+        move(0);
+
+    mPlaying = !mPlaying;
+    mElapsed = 0.0;
+    mLastUpdate = Clock::now();
+}
+
+void FieldReplay::toggleLoop() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLoop = !mLoop;
+    mWake.notify_one();
+}
+
+void FieldReplay::scrub(const i64 delta) {
+    if (frameCount() == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPlaying = false;
+
+    const i64 last = static_cast<i64>(frameCount()) - 1;
+    move(static_cast<Index>(
+        std::clamp(static_cast<i64>(mPlayhead) + delta, i64(0), last)));
+}
+
+void FieldReplay::seek(const Index frame) {
+    if (frameCount() == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    move(std::min(frame, frameCount() - 1));
+}
+
+const f64* FieldReplay::update() {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const Clock::time_point now = Clock::now();
+    if (mPlaying) {
+        const f64 seconds =
+            std::chrono::duration<f64>(now - mLastUpdate).count();
+        mElapsed += seconds * mFps;
+
+        const Index start = mPlayhead;
+        while (mElapsed >= 1.0) {
+            const Index next = ahead(1);
+            if (next == cNone) {
+                mPlaying = false;
+                mElapsed = 0.0;
+                break;
+            }
+
+            // Wait for the reader rather than skip a frame.
+            const Slot* slot = find(next);
+            if (slot == nullptr || !slot->ready) {
+                mElapsed = 1.0;
+                break;
+            }
+
+            mPlayhead = next;
+            mElapsed -= 1.0;
+        }
+
+        if (mPlayhead != start)
+            mWake.notify_one();
+    }
+    mLastUpdate = now;
+
+    const Slot* slot = find(mPlayhead);
+    if (mPlayhead == mShown || slot == nullptr || !slot->ready)
+        return nullptr;
+
+    mShown = mPlayhead;
+    return slot->values.data();
+}
+
+Index FieldReplay::ahead(const Index k) const {
+    if (frameCount() == 0)
+        return cNone;
+
+    const Index frame = mPlayhead + k;
+    if (frame < frameCount())
+        return frame;
+    return mLoop ? frame % frameCount() : cNone;
+}
+
+FieldReplay::Slot* FieldReplay::find(const Index frame) {
+    for (Slot& slot : mSlots) {
+        if (slot.frame == frame)
+            return &slot;
+    }
+    return nullptr;
+}
+
+void FieldReplay::move(const Index frame) {
+    mPlayhead = frame;
+    mElapsed = 0.0;
+    mWake.notify_one();
+}
+
+void FieldReplay::work() {
+    const Index window = mSlots.size() - 1;
+
+    // First frame of the window that is not decoded or being decoded.
+    const auto missing = [&]() {
+        for (Index k = 0; k < window; ++k) {
+            const Index frame = ahead(k);
+            if (frame == cNone)
+                break;
+            if (find(frame) == nullptr)
+                return frame;
+        }
+        return cNone;
+    };
+
+    const auto in_window = [&](const Index frame) {
+        for (Index k = 0; k < window; ++k) {
+            const Index next = ahead(k);
+            if (next == cNone)
+                break;
+            if (next == frame)
+                return true;
+        }
+        return false;
+    };
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true) {
+        mWake.wait(lock, [&]() { return mStop || missing() != cNone; });
+        if (mStop)
+            return;
+
+        const Index frame = missing();
+
+        // A window frame is missing, so at least one slot holds neither a
+        // window frame nor the shown frame.
+        Slot* slot = nullptr;
+        for (Slot& candidate : mSlots) {
+            if (candidate.frame == cNone ||
+                (candidate.frame != mShown && !in_window(candidate.frame))) {
+                slot = &candidate;
+                break;
+            }
+        }
+        assertm(slot != nullptr, "no free replay slot");
+
+        slot->frame = frame;
+        slot->ready = false;
+
+        lock.unlock();
+        const bool ok = mCache.read(frame, mField, slot->values.data());
+        lock.lock();
+
+        if (!ok) {
+            eprintln("Frame {} of the field cache is corrupt", frame);
+            std::fill(slot->values.begin(), slot->values.end(), 0.0);
+        }
+        slot->ready = true;
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "field_cache.hpp"
+#include "util/common.hpp"
+
+/// @brief Plays one field of a field cache back at a fixed frame rate. A
+/// reader thread decodes the frames ahead of the playhead into a ring of
+/// buffers, so playback does not wait on decoding or page faults. When the
+/// reader falls behind, playback slows down rather than skipping frames.
+///
+/// Every method is called from the render thread.
+class FieldReplay {
+public:
+    /// @brief Opens the cache at `path` for playback of field `field`. Check
+    /// isOpen() for failure.
+    /// @param fps Playback rate in frames per second.
+    /// @param prefetch Number of frames decoded ahead of the playhead.
+    FieldReplay(const std::string& path,
+                const std::string& field,
+                const f64 fps,
+                const u32 prefetch = 8);
+
+    /// @brief Stops and joins the reader thread.
+    ~FieldReplay();
+
+    FieldReplay(const FieldReplay&) = delete;
+    FieldReplay& operator=(const FieldReplay&) = delete;
+
+    /// @brief Indicates whether the cache and field were found.
+    bool isOpen() const;
+
+    /// @brief Number of columns of the field.
+    i32 nx() const;
+
+    /// @brief Number of rows of the field.
+    i32 ny() const;
+
+    /// @brief Number of frames in the cache.
+    Size frameCount() const;
+
+    /// @brief Frame at the playhead.
+    Index position() const;
+
+    /// @brief Solver step of the frame at the playhead.
+    u64 step() const;
+
+    /// @brief Starts or pauses playback.
+    void togglePlaying();
+
+    /// @brief Whether playback wraps around at the end instead of pausing.
+    void toggleLoop();
+
+    /// @brief Pauses and moves the playhead by `delta` frames, clamped to
+    /// the cache.
+    void scrub(const i64 delta);
+
+    /// @brief Moves the playhead to `frame`, clamped to the cache. Playback
+    /// continues if it was playing.
+    void seek(const Index frame);
+
+    /// @brief Advances the playhead by the time since the last call. Returns
+    /// the row-major values of the frame at the playhead if it changed and is
+    /// decoded, or nullptr. The values stay valid until the next call.
+    const f64* update();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Buffer holding a decoded frame.
+    struct Slot {
+        std::vector<f64> values;
+
+        /// @brief Frame held by the slot, or cNone.
+        Index frame;
+
+        /// @brief Whether the values are decoded.
+        bool ready;
+    };
+
+    static constexpr Index cNone = static_cast<Index>(-1);
+
+    /// @brief Frame `k` frames after the playhead, or cNone past the end.
+    Index ahead(const Index k) const;
+
+    /// @brief Slot holding frame `frame`, or nullptr.
+    Slot* find(const Index frame);
+
+    /// @brief Moves the playhead and wakes the reader.
+    void move(const Index frame);
+
+    void work();
+
+    FieldCacheReader mCache;
+    i32 mField;
+    f64 mFps;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWake;
+
+    /// @brief Frames within the prefetch window, plus the shown frame.
+    std::vector<Slot> mSlots;
+
+    Index mPlayhead;
+
+    /// @brief Frame last returned by update(). Its slot is never reused.
+    Index mShown;
+
+    bool mPlaying;
+    bool mLoop;
+
+    /// @brief Fraction of a frame elapsed since the playhead last moved.
+    f64 mElapsed;
+    Clock::time_point mLastUpdate;
+
+    bool mStop;
+    std::thread mReader;
+};
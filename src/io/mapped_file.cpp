@@ -0,0 +1,84 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "util/format.hpp"
+
+MappedFile::MappedFile() : mData(nullptr), mSize(0) {
+}
+
+MappedFile::MappedFile(const std::string& path) : mData(nullptr), mSize(0) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        eprintln("File could not be opened: {}", path);
+        return;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+        eprintln("File could not be mapped: {}", path);
+        ::close(fd);
+        return;
+    }
+
+    void* data = ::mmap(nullptr,
+                        static_cast<size_t>(info.st_size),
+                        PROT_READ,
+                        MAP_PRIVATE,
+                        fd,
+                        0);
+
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        eprintln("File could not be mapped: {}", path);
+        return;
+    }
+
+    mData = static_cast<const u8*>(data);
+    mSize = static_cast<Size>(info.st_size);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : mData(std::exchange(other.mData, nullptr)),
+      mSize(std::exchange(other.mSize, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        mData = std::exchange(other.mData, nullptr);
+        mSize = std::exchange(other.mSize, 0);
+    }
+    return *this;
+}
+
+bool MappedFile::isOpen() const {
+    return mData != nullptr;
+}
+
+const u8* MappedFile::data() const {
+    return mData;
+}
+
+Size MappedFile::size() const {
+    return mSize;
+}
+
+void MappedFile::close() {
+    if (mData != nullptr)
+        ::munmap(const_cast<u8*>(mData), static_cast<size_t>(mSize));
+
+    mData = nullptr;
+    mSize = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include "util/common.hpp"
+
+/// @brief Read-only memory mapping of a whole file. Pages are loaded on
+/// first access, so opening is cheap regardless of the file size.
+class MappedFile {
+public:
+    MappedFile();
+
+    /// @brief Maps the file at `path`. Check isOpen() for failure.
+    explicit MappedFile(const std::string& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /// @brief Indicates whether a file is mapped.
+    bool isOpen() const;
+
+    /// @brief First byte of the mapping. The mapping is page aligned.
+    const u8* data() const;
+
+    /// @brief Size of the file in bytes.
+    Size size() const;
+
+private:
+    void close();
+
+    const u8* mData;
+    Size mSize;
+};
@@ -3,6 +3,7 @@
 #include "numeric.hpp"
 #include "util/common.hpp"
 #include "util/format.hpp"
+#include "util/memory.hpp"
 
 template <Numeric T>
 class VectorX {
@@ -48,21 +49,22 @@ using VectorXF = VectorX<f32>;
 using VectorXD = VectorX<f64>;
 
 template <Numeric T>
-VectorX<T>::VectorX(const Size size) : mSize(size), mComponents(new T[mSize]) {
+VectorX<T>::VectorX(const Size size)
+    : mSize(size), mComponents(memory::allocate<T>(mSize)) {
     assertm(size > 0, "size must be positive");
     std::fill_n(mComponents, mSize, T(0));
 }
 
 template <Numeric T>
 VectorX<T>::VectorX(const Size size, const T value)
-    : mSize(size), mComponents(new T[mSize]) {
+    : mSize(size), mComponents(memory::allocate<T>(mSize)) {
     assertm(size > 0, "size must be positive");
     for (Index i = 0; i < mSize; ++i) mComponents[i] = value;
 }
 
 template <Numeric T>
 VectorX<T>::~VectorX() {
-    delete[] mComponents;
+    memory::release(mComponents);
 }
 
 template <Numeric T>
@@ -77,7 +79,7 @@ const Size VectorX<T>::size() const {
 
 template <Numeric T>
 void VectorX<T>::resize(const Size size) {
-    T* components = new T[size];
+    T* components = memory::allocate<T>(size);
 
     std::fill_n(mComponents, mSize, T(0));
 
@@ -85,22 +87,22 @@ void VectorX<T>::resize(const Size size) {
         components[i] = mComponents[i];
 
     mSize = size;
-    delete[] mComponents;
+    memory::release(mComponents);
     mComponents = components;
 }
 
 template <Numeric T>
 VectorX<T>::VectorX(const VectorX<T>& other) {
     mSize = other.mSize;
-    mComponents = new T[mSize];
+    mComponents = memory::allocate<T>(mSize);
     ::memcpy(mComponents, other.mComponents, mSize * sizeof(T));
 }
 
 template <Numeric T>
 VectorX<T>& VectorX<T>::operator=(const VectorX<T>& other) {
-    delete[] mComponents;
+    memory::release(mComponents);
     mSize = other.mSize;
-    mComponents = new T[mSize];
+    mComponents = memory::allocate<T>(mSize);
     ::memcpy(mComponents, other.mComponents, mSize * sizeof(T));
     return *this;
 }
@@ -0,0 +1,192 @@
+#include "particle_set.hpp"
+
+#include <algorithm>
+
+ParticleSet::ParticleSet() : mNx(0), mNy(0), mCellOffsets(1, 0) {
+}
+
+Size ParticleSet::size() const {
+    return x.size();
+}
+
+void ParticleSet::add(const f64 px, const f64 py) {
+    x.push_back(px);
+    y.push_back(py);
+    u.push_back(0.0);
+    v.push_back(0.0);
+}
+
+void ParticleSet::clear() {
+    x.clear();
+    y.clear();
+    u.clear();
+    v.clear();
+    std::fill(mCellOffsets.begin(), mCellOffsets.end(), 0);
+}
+
+void ParticleSet::rebin(const i32 nx, const i32 ny, ThreadPool& pool) {
+    assertm(nx > 0 && ny > 0, "grid dimensions must be positive");
+
+    mNx = nx;
+    mNy = ny;
+
+    const Size count = size();
+    const Size cell_count = static_cast<Size>(nx) * ny;
+    const u32 threads = pool.size();
+    const u32 blocks =
+        static_cast<u32>((cell_count + cCellsPerBlock - 1) / cCellsPerBlock);
+
+    mCells.resize(count);
+    mCellOffsets.resize(cell_count + 1);
+    mNext.resize(cell_count);
+    mCounts.resize(threads);
+    mFirstCell.resize(threads);
+    mEndCell.resize(threads);
+    mBlockOffsets.resize(blocks);
+
+    mBackX.resize(count);
+    mBackY.resize(count);
+    mBackU.resize(count);
+    mBackV.resize(count);
+
+    const auto range = [&](const u32 t, Index& begin, Index& end) {
+        begin = count * t / threads;
+        end = count * (t + 1) / threads;
+    };
+
+    const auto block = [&](const u32 b, Index& begin, Index& end) {
+        begin = static_cast<Index>(b) * cCellsPerBlock;
+        end = std::min<Index>(begin + cCellsPerBlock, cell_count);
+    };
+
+    // 1. Histogram of the cells of each thread's particles. The particles
+    // were sorted by the last rebin and have moved little since, so each
+    // histogram only spans the cells its particles lie in.
+    pool.parallelFor(threads, [&](const u32 t) {
+        Index begin = 0;
+        Index end = 0;
+        range(t, begin, end);
+
+        Index first = cell_count;
+        Index last = 0;
+        for (Index p = begin; p < end; ++p) {
+            mCells[p] = cellOf(p);
+            first = std::min(first, mCells[p]);
+            last = std::max(last, mCells[p] + 1);
+        }
+        if (first >= last)
+            first = last = 0;
+
+        mFirstCell[t] = first;
+        mEndCell[t] = last;
+
+        std::vector<Index>& counts = mCounts[t];
+        counts.assign(last - first, 0);
+        for (Index p = begin; p < end; ++p) ++counts[mCells[p] - first];
+    });
+
+    // 2. Particles per cell over all threads, and per block of cells.
+    pool.parallelFor(blocks, [&](const u32 b) {
+        Index begin = 0;
+        Index end = 0;
+        block(b, begin, end);
+
+        std::fill(mNext.begin() + begin, mNext.begin() + end, 0);
+        for (u32 t = 0; t < threads; ++t) {
+            const Index first = mFirstCell[t];
+            const Index lo = std::max(begin, first);
+            const Index hi = std::min(end, mEndCell[t]);
+            for (Index c = lo; c < hi; ++c) mNext[c] += mCounts[t][c - first];
+        }
+
+        Index total = 0;
+        for (Index c = begin; c < end; ++c) total += mNext[c];
+        mBlockOffsets[b] = total;
+    });
+
+    Index offset = 0;
+    for (u32 b = 0; b < blocks; ++b) {
+        const Index total = mBlockOffsets[b];
+        mBlockOffsets[b] = offset;
+        offset += total;
+    }
+    mCellOffsets[cell_count] = offset;
+
+    // 3. Offsets of the cells, then of each thread's particles within a
+    // cell, after those of the threads before it. This keeps the sort
+    // stable. Each histogram is walked in order, one thread at a time.
+    pool.parallelFor(blocks, [&](const u32 b) {
+        Index begin = 0;
+        Index end = 0;
+        block(b, begin, end);
+
+        Index next = mBlockOffsets[b];
+        for (Index c = begin; c < end; ++c) {
+            const Index n = mNext[c];
+            mCellOffsets[c] = next;
+            mNext[c] = next;
+            next += n;
+        }
+
+        for (u32 t = 0; t < threads; ++t) {
+            const Index first = mFirstCell[t];
+            const Index lo = std::max(begin, first);
+            const Index hi = std::min(end, mEndCell[t]);
+            for (Index c = lo; c < hi; ++c) {
+                Index& slot = mCounts[t][c - first];
+                const Index n = slot;
+                slot = mNext[c];
+                mNext[c] += n;
+            }
+        }
+    });
+
+    // 4. Scatter into the back buffers.
+    pool.parallelFor(threads, [&](const u32 t) {
+        std::vector<Index>& offsets = mCounts[t];
+        const Index first = mFirstCell[t];
+
+        Index begin = 0;
+        Index end = 0;
+        range(t, begin, end);
+
+        for (Index p = begin; p < end; ++p) {
+            const Index dst = offsets[mCells[p] - first]++;
+            mBackX[dst] = x[p];
+            mBackY[dst] = y[p];
+            mBackU[dst] = u[p];
+            mBackV[dst] = v[p];
+        }
+    });
+
+    x.swap(mBackX);
+    y.swap(mBackY);
+    u.swap(mBackU);
+    v.swap(mBackV);
+}
+
+Index ParticleSet::cellBegin(const i32 i, const i32 j) const {
+    return mCellOffsets[static_cast<Index>(j) * mNx + i];
+}
+
+Index ParticleSet::cellEnd(const i32 i, const i32 j) const {
+    return mCellOffsets[static_cast<Index>(j) * mNx + i + 1];
+}
+
+Size ParticleSet::cellCount(const i32 i, const i32 j) const {
+    return cellEnd(i, j) - cellBegin(i, j);
+}
+
+i32 ParticleSet::nx() const {
+    return mNx;
+}
+
+i32 ParticleSet::ny() const {
+    return mNy;
+}
+
+Index ParticleSet::cellOf(const Index p) const {
+    const i32 i = std::clamp(static_cast<i32>(x[p]), 0, mNx - 1);
+    const i32 j = std::clamp(static_cast<i32>(y[p]), 0, mNy - 1);
+    return static_cast<Index>(j) * mNx + i;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include "util/common.hpp"
+#include "util/thread_pool.hpp"
+
+/// @brief 2D particles in structure-of-arrays layout, kept sorted by the grid
+/// cell they lie in. Positions are in cell units, so cell (i, j) spans
+/// [i, i + 1] x [j, j + 1].
+///
+/// After rebin(), the particles of each cell are contiguous and cells appear
+/// in row-major order, so a kernel that walks cells in order also walks the
+/// particle arrays in order.
+class ParticleSet {
+public:
+    ParticleSet();
+
+    std::vector<f64> x;
+    std::vector<f64> y;
+    std::vector<f64> u;
+    std::vector<f64> v;
+
+    /// @brief Number of particles.
+    Size size() const;
+
+    /// @brief Adds a particle at rest at (px, py). The cell ranges are stale
+    /// until the next rebin().
+    void add(const f64 px, const f64 py);
+
+    /// @brief Removes every particle.
+    void clear();
+
+    /// @brief Sorts the particles by cell with a parallel counting sort and
+    /// rebuilds the per-cell ranges. Particles outside the grid are binned
+    /// into the nearest edge cell.
+    void rebin(const i32 nx, const i32 ny, ThreadPool& pool);
+
+    /// @brief Index of the first particle in cell (i, j).
+    Index cellBegin(const i32 i, const i32 j) const;
+
+    /// @brief Index one past the last particle in cell (i, j).
+    Index cellEnd(const i32 i, const i32 j) const;
+
+    /// @brief Number of particles in cell (i, j).
+    Size cellCount(const i32 i, const i32 j) const;
+
+    /// @brief Number of columns of the grid used by the last rebin().
+    i32 nx() const;
+
+    /// @brief Number of rows of the grid used by the last rebin().
+    i32 ny() const;
+
+private:
+    /// @brief Cells per task of the prefix sum.
+    static constexpr Size cCellsPerBlock = 4096;
+
+    /// @brief Cell index of particle `p`.
+    Index cellOf(const Index p) const;
+
+    i32 mNx;
+    i32 mNy;
+
+    /// @brief Offset of each cell in the particle arrays, with a final end
+    /// offset.
+    std::vector<Index> mCellOffsets;
+
+    /// @brief Cell index of every particle, computed during rebin().
+    std::vector<Index> mCells;
+
+    /// @brief Per-thread histograms of the cells [mFirstCell, mEndCell) the
+    /// thread's particles lie in, turned into per-thread write offsets by the
+    /// prefix sum.
+    std::vector<std::vector<Index>> mCounts;
+    std::vector<Index> mFirstCell;
+    std::vector<Index> mEndCell;
+
+    /// @brief Particles per cell, then the next write offset of each cell
+    /// while the per-thread offsets are assigned.
+    std::vector<Index> mNext;
+
+    /// @brief Offset of the first particle of each block of cells.
+    std::vector<Index> mBlockOffsets;
+
+    /// @brief Back buffers for the scatter pass.
+    std::vector<f64> mBackX;
+    std::vector<f64> mBackY;
+    std::vector<f64> mBackU;
+    std::vector<f64> mBackV;
+};
@@ -0,0 +1,119 @@
+#include "field_texture.hpp"
+
+#include <vector>
+
+FieldTexture::FieldTexture() : mWidth(0), mHeight(0), mNext(0) {
+    glGenTextures(1, &mID);
+    glGenBuffers(2, mBuffers);
+}
+
+FieldTexture::~FieldTexture() {
+    glDeleteBuffers(2, mBuffers);
+    glDeleteTextures(1, &mID);
+}
+
+void FieldTexture::allocate(const u32 width, const u32 height) {
+    mWidth = width;
+    mHeight = height;
+
+    const std::vector<f32> zeros(static_cast<Size>(width) * height, 0.0f);
+
+    glBindTexture(GL_TEXTURE_2D, mID);
+    glep();
+
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_R32F,
+                 width,
+                 height,
+                 0,
+                 GL_RED,
+                 GL_FLOAT,
+                 zeros.data());
+    glep();
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glep();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glep();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glep();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glep();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glep();
+
+    const GLsizeiptr bytes = zeros.size() * sizeof(f32);
+    for (const GLuint buffer : mBuffers) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glep();
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        glep();
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glep();
+}
+
+void FieldTexture::bind(const u32 index) {
+    glActiveTexture(GL_TEXTURE0 + index);
+    glep();
+    glBindTexture(GL_TEXTURE_2D, mID);
+    glep();
+}
+
+f32* FieldTexture::map() {
+    assertm(mWidth > 0 && mHeight > 0, "field texture is not allocated");
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffers[mNext]);
+    glep();
+
+    // Invalidating lets the driver hand out fresh memory instead of waiting
+    // on a transfer that still reads the buffer.
+    const GLsizeiptr bytes =
+        static_cast<GLsizeiptr>(mWidth) * mHeight * sizeof(f32);
+    void* texels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                    0,
+                                    bytes,
+                                    GL_MAP_WRITE_BIT |
+                                        GL_MAP_INVALIDATE_BUFFER_BIT);
+    glep();
+
+    if (texels == nullptr)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    return static_cast<f32*>(texels);
+}
+
+void FieldTexture::unmap() {
+    // The buffer contents are undefined if the mapping was lost, so the
+    // texture keeps its previous values.
+    const bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    glep();
+
+    if (intact) {
+        glBindTexture(GL_TEXTURE_2D, mID);
+        glep();
+
+        // Sources from the bound buffer, at offset 0.
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        0,
+                        0,
+                        mWidth,
+                        mHeight,
+                        GL_RED,
+                        GL_FLOAT,
+                        nullptr);
+        glep();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glep();
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glep();
+
+    mNext = 1 - mNext;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "opengl.hpp"
+#include "util/common.hpp"
+
+/// @brief Single-channel float texture holding a scalar field, for shaders
+/// that colour the field themselves.
+///
+/// Storage is allocated once. Each upload is written into one of two pixel
+/// buffer objects and copied into the texture with glTexSubImage2D, so the
+/// next upload never waits for the previous transfer to finish.
+class FieldTexture {
+public:
+    FieldTexture();
+    FieldTexture(const FieldTexture& other) = delete;
+    ~FieldTexture();
+
+    /// @brief Allocates a `width` by `height` texture and its upload buffers.
+    /// The texture is zeroed.
+    void allocate(const u32 width, const u32 height);
+
+    void bind(const u32 index);
+
+    /// @brief Maps the next upload buffer. The caller writes width * height
+    /// row-major values, bottom row first, then calls unmap(). Returns
+    /// nullptr if the buffer could not be mapped.
+    f32* map();
+
+    /// @brief Unmaps the upload buffer and copies it into the texture.
+    void unmap();
+
+private:
+    u32 mWidth;
+    u32 mHeight;
+    GLuint mID;
+
+    /// @brief Upload buffers, used in turn.
+    GLuint mBuffers[2];
+    u32 mNext;
+};
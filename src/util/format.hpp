@@ -1,45 +1,77 @@
 #pragma once
 
+#include <unistd.h>
+
 #include <string>
 
 #include "common.hpp"
+#include "format_string.hpp"
 #include "formatter.hpp"
 #include "stringbuffer.hpp"
 
+/// @brief Formats into a StringBuffer. The format string is parsed and
+/// checked against the arguments at compile time.
+/// @tparam ...Targs Format string argument types.
+/// @param sb Buffer for the formatted string.
+/// @param format_string Format string.
+/// @param ...args Format string arguments.
+template <typename... Targs>
+void format(StringBuffer& sb,
+            const FormatString<sizeof...(Targs)> format_string,
+            const Targs&... args) {
+    Index k = 0;
+    (
+        [&] {
+            const auto& literal = format_string.literal(k++);
+            writeLiteral(sb, literal.text, literal.escaped);
+            FormatWriter<std::decay_t<decltype(args)>>::write(args, sb);
+        }(),
+        ...);
+
+    const auto& literal = format_string.literal(k);
+    writeLiteral(sb, literal.text, literal.escaped);
+}
+
 /// @brief Formatter wrapper that creates a new std::string.
 /// @tparam ...Targs Format string argument types.
 /// @param format_string Format string.
 /// @param ...args Format string arguments.
 /// @return Formatted string.
 template <typename... Targs>
-std::string formatted(const char* format_string, const Targs&... args) {
-    Formatter formatter(format_string, std::strlen(format_string));
+std::string formatted(const FormatString<sizeof...(Targs)> format_string,
+                      const Targs&... args) {
     StringBuffer sb;
+    format(sb, format_string, args...);
+    return std::string(sb.str(), sb.length());
+}
 
-    try {
-        formatter.format(sb, args...);
-    } catch (const std::runtime_error& e) {
-        std::cerr << e.what() << '\n';
-        return std::string();
-    }
-
-    return std::string(sb.str());
+/// @brief Writes a formatted string to a file descriptor, streaming large
+/// outputs in chunks instead of building them in memory.
+/// @tparam ...Targs Format string argument types.
+/// @param fd File descriptor.
+/// @param format_string Format string.
+/// @param ...args Format string arguments.
+template <typename... Targs>
+void fprint(const int fd,
+            const FormatString<sizeof...(Targs)> format_string,
+            const Targs&... args) {
+    StringBuffer sb(fd);
+    format(sb, format_string, args...);
 }
 
-/// @brief Formatter wrapper that fills a StringBuffer.
+/// @brief Writes a formatted string followed by a newline to a file
+/// descriptor, streaming large outputs in chunks.
 /// @tparam ...Targs Format string argument types.
+/// @param fd File descriptor.
 /// @param format_string Format string.
 /// @param ...args Format string arguments.
-/// @return Formatted string.
 template <typename... Targs>
-void format(StringBuffer& sb, const char* format_string, const Targs&... args) {
-    Formatter formatter(format_string, std::strlen(format_string));
-    try {
-        formatter.format(sb, args...);
-    } catch (const std::runtime_error& e) {
-        std::cerr << e.what() << '\n';
-        return;
-    }
+void fprintln(const int fd,
+              const FormatString<sizeof...(Targs)> format_string,
+              const Targs&... args) {
+    StringBuffer sb(fd);
+    format(sb, format_string, args...);
+    sb.putSafe('\n');
 }
 
 /// @brief Prints a formatted string followed by a newline.
@@ -47,10 +79,11 @@ void format(StringBuffer& sb, const char* format_string, const Targs&... args) {
 /// @param format_string Format string.
 /// @param ...args Format string arguments.
 template <typename... Targs>
-void println(const char* format_string, const Targs&... args) {
-    StringBuffer sb;
-    format(sb, format_string, args...);
-    std::cout << sb.str() << '\n';
+void println(const FormatString<sizeof...(Targs)> format_string,
+             const Targs&... args) {
+    // Write out anything printed through std::cout first.
+    std::cout.flush();
+    fprintln(STDOUT_FILENO, format_string, args...);
 }
 
 /// @brief Prints a formatted string.
@@ -58,10 +91,10 @@ void println(const char* format_string, const Targs&... args) {
 /// @param format_string Format string.
 /// @param ...args Format string arguments.
 template <typename... Targs>
-void print(const char* format_string, const Targs&... args) {
-    StringBuffer sb;
-    format(sb, format_string, args...);
-    std::cout << sb.str();
+void print(const FormatString<sizeof...(Targs)> format_string,
+           const Targs&... args) {
+    std::cout.flush();
+    fprint(STDOUT_FILENO, format_string, args...);
 }
 
 /// @brief Prints a formatted string followed by a newline to stderr.
@@ -69,10 +102,10 @@ void print(const char* format_string, const Targs&... args) {
 /// @param format_string Format string.
 /// @param ...args Format string arguments.
 template <typename... Targs>
-void eprintln(const char* format_string, const Targs&... args) {
-    StringBuffer sb;
-    format(sb, format_string, args...);
-    std::cerr << sb.str() << std::endl;
+void eprintln(const FormatString<sizeof...(Targs)> format_string,
+              const Targs&... args) {
+    std::cerr.flush();
+    fprintln(STDERR_FILENO, format_string, args...);
 }
 
 /// @brief Prints a formatted string to stderr.
@@ -80,8 +113,8 @@ void eprintln(const char* format_string, const Targs&... args) {
 /// @param format_string Format string.
 /// @param ...args Format string arguments.
 template <typename... Targs>
-void eprint(const char* format_string, const Targs&... args) {
-    StringBuffer sb;
-    format(sb, format_string, args...);
-    std::cerr << sb.str() << std::flush;
+void eprint(const FormatString<sizeof...(Targs)> format_string,
+            const Targs&... args) {
+    std::cerr.flush();
+    fprint(STDERR_FILENO, format_string, args...);
 }
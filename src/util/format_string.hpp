@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <string_view>
+
+#include "common.hpp"
+
+namespace detail {
+
+/// @brief Not constexpr, so reaching it while parsing a format string at
+/// compile time fails the build with the message in the diagnostic.
+inline void formatStringError([[maybe_unused]] const char* message) {
+}
+
+}
+
+/// @brief Brace-based format string for `count` arguments, parsed at compile
+/// time.
+///
+/// `{}` is replaced by the next argument, and `{{` and `}}` are literal
+/// braces. The constructor is consteval, so a format string that is
+/// malformed or does not have one `{}` per argument does not compile. The
+/// literal text around the formatters is located once, at compile time.
+template <Size count>
+class FormatString {
+public:
+    /// @brief Literal text before a formatter, or after the last one.
+    struct Literal {
+        std::string_view text;
+
+        /// @brief Whether the text holds escaped braces, written as one.
+        bool escaped;
+    };
+
+    template <typename S>
+        requires std::convertible_to<const S&, std::string_view>
+    consteval FormatString(const S& format_string)
+        : mString(format_string), mLiterals{} {
+        Index literal = 0;
+        Index begin = 0;
+        bool escaped = false;
+
+        for (Index i = 0; i < mString.size(); ++i) {
+            const char c = mString[i];
+            const char next = i + 1 < mString.size() ? mString[i + 1] : '\0';
+
+            if ((c == '{' && next == '{') || (c == '}' && next == '}')) {
+                escaped = true;
+                ++i;
+            } else if (c == '{' && next == '}') {
+                if (literal == count)
+                    detail::formatStringError("more formatters than arguments");
+                mLiterals[literal++] =
+                    Literal{mString.substr(begin, i - begin), escaped};
+                begin = i + 2;
+                escaped = false;
+                ++i;
+            } else if (c == '{' || c == '}') {
+                detail::formatStringError("unmatched brace in format string");
+            }
+        }
+
+        if (literal != count)
+            detail::formatStringError("fewer formatters than arguments");
+        mLiterals[count] = Literal{mString.substr(begin), escaped};
+    }
+
+    /// @brief The whole format string.
+    constexpr std::string_view string() const {
+        return mString;
+    }
+
+    /// @brief Literal text before formatter `k`, or after the last formatter
+    /// when `k` is `count`.
+    constexpr const Literal& literal(const Index k) const {
+        return mLiterals[k];
+    }
+
+private:
+    std::string_view mString;
+    std::array<Literal, count + 1> mLiterals;
+};
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <charconv>
 #include <cstring>
 #include <map>
 #include <string>
 #include <vector>
 
 #include "common.hpp"
+#include "format_string.hpp"
 #include "stringbuffer.hpp"
 
 /// @brief Stringifier template.
@@ -18,150 +20,21 @@ concept FormatWritable = requires(T value, StringBuffer& sb) {
     { FormatWriter<T>::write(value, sb) };
 };
 
-namespace {
-
-/// @brief Format string token.
-struct Token {
-    /// @brief Format string token kind.
-    enum class Kind {
-        None = 0,
-        Literal,
-        LeftBrace,
-        RightBrace,
-        Formatter,
-    };
-
-    Token() = delete;
-    Token(Kind kind, Index location) : kind(kind), location(location) {
-    }
-
-    Kind kind;
-    Index location;
-};
-
-// TODO: Format options.
-
-/// @brief Parses a brace-based format string.
-/// @param format_string Format string.
-/// @param length Length of the parse string.
-/// @return Sequence of parse tokens.
-std::vector<Token> parseFormatString(const char* format_string,
-                                     const Size length) {
-    std::vector<Token> tokens;
-    Token::Kind current = Token::Kind::None;
-
-    for (Index i = 0; i < length; ++i) {
-        if (format_string[i] == '{') {
-            if (current == Token::Kind::LeftBrace) {
-                tokens.emplace_back(current, i - 1);
-                current = Token::Kind::None;
-            } else {
-                current = Token::Kind::LeftBrace;
-            }
-        } else if (format_string[i] == '}') {
-            if (current == Token::Kind::LeftBrace) {
-                tokens.emplace_back(Token::Kind::Formatter, i - 1);
-                current = Token::Kind::None;
-            } else if (current == Token::Kind::RightBrace) {
-                tokens.emplace_back(Token::Kind::RightBrace, i - 1);
-                current = Token::Kind::None;
-            } else {
-                current = Token::Kind::RightBrace;
-            }
-        } else {
-            if (current == Token::Kind::LeftBrace ||
-                current == Token::Kind::RightBrace) {
-                StringBuffer sb;
-                sb.appendFormat("unexpected brace at index {}", i);
-                throw std::runtime_error(sb.str());
-            }
-
-            if (current == Token::Kind::None) {
-                tokens.emplace_back(Token::Kind::Literal, i);
-                current = Token::Kind::Literal;
-            }
-        }
+/// @brief Writes a literal of a format string, collapsing escaped braces.
+inline void writeLiteral(StringBuffer& sb,
+                         const std::string_view text,
+                         const bool escaped) {
+    if (!escaped) {
+        sb.append(text.data(), text.size());
+        return;
     }
-    return tokens;
-}
 
-}
-
-/// @brief Format string builder.
-class Formatter {
-public:
-    Formatter(const char* format_string, const Size length)
-        : mFormatString(format_string), mLength(length) {
-    }
-
-    /// @brief Builds a formatted string.
-    /// @tparam ...Targs Format string argument types.
-    /// @param sb Buffer for the format string.
-    /// @param ...args Format string arguments.
-    template <typename... Targs>
-    void format(StringBuffer& sb, const Targs&... args) {
-        std::vector<Token> tokens = parseFormatString(mFormatString, mLength);
-
-        u32 num_args = sizeof...(args);
-        u32 num_formatters = 0;
-        for (auto token : tokens) {
-            if (token.kind == Token::Kind::Formatter)
-                ++num_formatters;
-        }
-        if (num_args != num_formatters) {
-            StringBuffer sb;
-            sb.appendFormat(
-                "unexpected number of formatter args (num_args={}, "
-                "num_formatters={})",
-                num_args,
-                num_formatters);
-            throw std::runtime_error(sb.str());
-        }
-
-        Index i = 0;
-        (
-            [&] {
-                i = writeLiterals(sb, tokens, i);
-                FormatWriter<std::decay_t<decltype(args)>>::write(args, sb);
-                ++i;
-            }(),
-            ...);
-        writeLiterals(sb, tokens, i);
-    }
-
-private:
-    const char* mFormatString;
-    Size mLength;
-
-    Index writeLiterals(StringBuffer& sb,
-                        const std::vector<Token>& tokens,
-                        const Index start) {
-        Index i = start, n = tokens.size();
-        while (i < n && tokens[i].kind != Token::Kind::Formatter) {
-            Token token = tokens[i];
-            Index left = token.location;
-            Index right = i < n - 1 ? tokens[i + 1].location : mLength;
-            switch (token.kind) {
-            case Token::Kind::Literal:
-                for (Index j = left; j < right; ++j) {
-                    sb.putSafe(mFormatString[j]);
-                }
-                break;
-            case Token::Kind::LeftBrace:
-                sb.putSafe('{');
-                break;
-            case Token::Kind::RightBrace:
-                sb.putSafe('}');
-                break;
-            default:
-                unreachable;
-                break;
-            }
+    for (Index i = 0; i < text.size(); ++i) {
+        sb.putSafe(text[i]);
+        if (text[i] == '{' || text[i] == '}')
             ++i;
-        }
-        return i;
     }
-};
+}
 
 template <>
 struct FormatWriter<char> {
@@ -193,6 +66,13 @@ struct FormatWriter<std::string> {
     }
 };
 
+template <>
+struct FormatWriter<std::string_view> {
+    static void write(const std::string_view value, StringBuffer& sb) {
+        sb.append(value.data(), value.size());
+    }
+};
+
 template <>
 struct FormatWriter<bool> {
     static void write(bool value, StringBuffer& sb) {
@@ -203,62 +83,30 @@ struct FormatWriter<bool> {
     }
 };
 
-template <UnsignedIntegral U>
-struct FormatWriter<U> {
-    static void write(U value, StringBuffer& sb) {
-        if (value == 0) {
-            sb.putSafe('0');
-            return;
-        }
-
-        char int_buffer[20];
-        char* ptr = int_buffer;
-        while (value > 0) {
-            char digit(value % 10);
-            value /= 10;
-            *ptr++ = digit + '0';
-        }
-
-        while (ptr != int_buffer) {
-            sb.putSafe(*(--ptr));
-        }
-    }
-};
-
-template <SignedIntegral S>
-struct FormatWriter<S> {
-    static void write(S value, StringBuffer& sb) {
-        if (value == 0) {
-            sb.putSafe('0');
-            return;
-        }
-
-        char int_buffer[19];
-        char* ptr = int_buffer;
-
-        S sign = 1;
-        if (value < 0) {
-            sb.putSafe('-');
-            sign = -1;
-        }
-
-        while (value != 0) {
-            char digit((value % 10) * sign);
-            value /= 10;
-            *ptr++ = digit + '0';
-        }
-
-        while (ptr != int_buffer) {
-            sb.putSafe(*(--ptr));
-        }
+template <std::integral I>
+struct FormatWriter<I> {
+    static void write(I value, StringBuffer& sb) {
+        char buffer[24];
+        const std::to_chars_result result =
+            std::to_chars(buffer, buffer + sizeof(buffer), value);
+        sb.append(buffer, result.ptr - buffer);
     }
 };
 
 template <std::floating_point F>
 struct FormatWriter<F> {
     static void write(F value, StringBuffer& sb) {
-        // TODO: RTW for float printing.
-        sb.append(std::to_string(value).c_str());
+        // Six decimals, as std::to_string, without the locale or allocation.
+        // Enough for any double; larger long doubles fall back to
+        // scientific notation.
+        char buffer[330];
+        char* const end = buffer + sizeof(buffer);
+        std::to_chars_result result =
+            std::to_chars(buffer, end, value, std::chars_format::fixed, 6);
+        if (result.ec != std::errc())
+            result = std::to_chars(
+                buffer, end, value, std::chars_format::scientific, 6);
+        sb.append(buffer, result.ptr - buffer);
     }
 };
 
@@ -0,0 +1,240 @@
+#include "log.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<Log::Level> Log::sLevel(Log::Level::Debug);
+
+namespace {
+
+/// @brief Set once the background thread has stopped. Trivially
+/// destructible, so it can be read during static destruction.
+std::atomic<bool> gStopped(false);
+
+/// @brief Drains the rings of every logging thread on a background thread.
+class LogBackend {
+public:
+    LogBackend() : mSequence(0), mWritten(0), mDropped(0), mStop(false) {
+        mThread = std::thread([this]() { work(); });
+    }
+
+    /// @brief Writes the remaining messages and stops. Later messages are
+    /// written by the threads that log them.
+    ~LogBackend() {
+        gStopped.store(true, std::memory_order_release);
+        mStop.store(true, std::memory_order_release);
+        mThread.join();
+    }
+
+    /// @brief Creates and registers the ring of a new logging thread.
+    std::shared_ptr<LogRing> attach(const Size capacity) {
+        std::shared_ptr<LogRing> ring = std::make_shared<LogRing>(capacity);
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRings.push_back(ring);
+        return ring;
+    }
+
+    u64 nextSequence() {
+        return mSequence.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void flush() {
+        const u64 target = mSequence.load(std::memory_order_relaxed);
+        while (mWritten.load(std::memory_order_acquire) < target)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    u64 dropped() const {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    /// @brief Largest number of messages written at once.
+    static constexpr Size cBatch = 256;
+
+    /// @brief Time slept when every ring is empty.
+    static constexpr std::chrono::milliseconds cIdle{2};
+
+    void work() {
+        std::vector<std::shared_ptr<LogRing>> rings;
+        StringBuffer out;
+        StringBuffer err;
+
+        while (true) {
+            // Read the flag first, so messages logged before the stop are
+            // drained by the last pass.
+            const bool stop = mStop.load(std::memory_order_acquire);
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                std::erase_if(mRings, [](const std::shared_ptr<LogRing>& r) {
+                    return r->isClosed() && r->front() == nullptr;
+                });
+                rings = mRings;
+            }
+
+            const Size written = drain(rings, out, err);
+            report(rings, err);
+
+            if (written == 0) {
+                if (stop)
+                    return;
+                std::this_thread::sleep_for(cIdle);
+            }
+        }
+    }
+
+    /// @brief Writes the waiting messages of every ring in the order they
+    /// were logged. Returns the number of messages written.
+    Size drain(const std::vector<std::shared_ptr<LogRing>>& rings,
+               StringBuffer& out,
+               StringBuffer& err) {
+        Size written = 0;
+
+        while (true) {
+            Size batch = 0;
+            for (; batch < cBatch; ++batch) {
+                LogRing* oldest = nullptr;
+                const LogRing::Record* record = nullptr;
+                for (const std::shared_ptr<LogRing>& ring : rings) {
+                    const LogRing::Record* front = ring->front();
+                    if (front != nullptr &&
+                        (record == nullptr ||
+                         front->sequence < record->sequence)) {
+                        oldest = ring.get();
+                        record = front;
+                    }
+                }
+                if (record == nullptr)
+                    break;
+
+                const auto level = static_cast<Log::Level>(record->level);
+                StringBuffer& sb = level <= Log::Level::Error ? err : out;
+                format(sb, "{}\t| ", level);
+                record->decode(record->payload(), sb);
+                sb.putSafe('\n');
+
+                oldest->pop();
+            }
+
+            if (batch == 0)
+                return written;
+
+            if (!err.isEmpty()) {
+                std::cerr.write(err.str(), err.length());
+                std::cerr.flush();
+                err.clear();
+            }
+            if (!out.isEmpty()) {
+                std::cout.write(out.str(), out.length());
+                std::cout.flush();
+                out.clear();
+            }
+
+            written += batch;
+            mWritten.fetch_add(batch, std::memory_order_release);
+        }
+    }
+
+    /// @brief Reports the messages dropped since the last report.
+    void report(const std::vector<std::shared_ptr<LogRing>>& rings,
+                StringBuffer& err) {
+        u64 dropped = 0;
+        for (const std::shared_ptr<LogRing>& ring : rings)
+            dropped += ring->takeDropped();
+        if (dropped == 0)
+            return;
+
+        mDropped.fetch_add(dropped, std::memory_order_relaxed);
+        format(err,
+               "{}\t| Dropped {} log messages\n",
+               Log::Level::Warning,
+               dropped);
+        std::cerr.write(err.str(), err.length());
+        err.clear();
+    }
+
+    std::mutex mMutex;
+    std::vector<std::shared_ptr<LogRing>> mRings;
+
+    std::atomic<u64> mSequence;
+    std::atomic<u64> mWritten;
+    std::atomic<u64> mDropped;
+
+    std::atomic<bool> mStop;
+    std::thread mThread;
+};
+
+LogBackend& backend() {
+    static LogBackend instance;
+    return instance;
+}
+
+/// @brief Ring of a logging thread, closed when the thread exits.
+struct ThreadRing {
+    ~ThreadRing() {
+        if (ring)
+            ring->close();
+    }
+
+    std::shared_ptr<LogRing> ring;
+};
+
+thread_local ThreadRing tRing;
+
+}
+
+bool Log::parseLevel(const char* name, Level& level) {
+    const std::string_view value(name);
+    if (value == "fatal")
+        level = Level::Fatal;
+    else if (value == "error")
+        level = Level::Error;
+    else if (value == "warning")
+        level = Level::Warning;
+    else if (value == "info")
+        level = Level::Info;
+    else if (value == "debug")
+        level = Level::Debug;
+    else
+        return false;
+    return true;
+}
+
+void Log::flush() {
+    if (!gStopped.load(std::memory_order_acquire))
+        backend().flush();
+}
+
+u64 Log::dropped() {
+    if (gStopped.load(std::memory_order_acquire))
+        return 0;
+    return backend().dropped();
+}
+
+LogRing* Log::ring() {
+    if (gStopped.load(std::memory_order_acquire))
+        return nullptr;
+
+    if (!tRing.ring)
+        tRing.ring = backend().attach(cRingCapacity);
+    return tRing.ring.get();
+}
+
+u64 Log::nextSequence() {
+    return backend().nextSequence();
+}
+
+void Log::writeLine(const Level message_level, StringBuffer& sb) {
+    sb.putSafe('\n');
+    if (message_level <= Level::Error) {
+        std::cerr.write(sb.str(), sb.length());
+        std::cerr.flush();
+    } else {
+        std::cout.write(sb.str(), sb.length());
+        std::cout.flush();
+    }
+}
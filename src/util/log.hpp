@@ -1,7 +1,22 @@
 #pragma once
 
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+
 #include "format.hpp"
+#include "log_ring.hpp"
 
+/// @brief Asynchronous logger.
+///
+/// Each thread appends its messages to its own lock-free ring, holding the
+/// format string and a copy of the arguments. A background thread formats
+/// the messages in the order they were logged and writes them out, so logging
+/// never blocks on I/O or on other threads. Messages that do not fit in a
+/// full ring are dropped and counted. Fatal messages are written immediately,
+/// after every earlier message.
 class Log {
 public:
     enum class Level {
@@ -13,62 +28,66 @@ public:
     };
 
     template <typename... Targs>
-    static void d(const char* format_string, const Targs&... args);
+    static void d(const FormatString<sizeof...(Targs)> format_string,
+                  const Targs&... args);
 
     template <typename... Targs>
-    static void i(const char* format_string, const Targs&... args);
+    static void i(const FormatString<sizeof...(Targs)> format_string,
+                  const Targs&... args);
 
     template <typename... Targs>
-    static void w(const char* format_string, const Targs&... args);
+    static void w(const FormatString<sizeof...(Targs)> format_string,
+                  const Targs&... args);
 
     template <typename... Targs>
-    static void e(const char* format_string, const Targs&... args);
+    static void e(const FormatString<sizeof...(Targs)> format_string,
+                  const Targs&... args);
 
     template <typename... Targs>
-    static void f(const char* format_string, const Targs&... args);
+    static void f(const FormatString<sizeof...(Targs)> format_string,
+                  const Targs&... args);
 
-    static constexpr Level level = Level::Debug;
-};
+    /// @brief Most verbose level that is logged.
+    static Level level();
 
-template <typename... Targs>
-void Log::d(const char* format_string, const Targs&... args) {
-    if constexpr (Log::level >= Log::Level::Debug)
-        println((std::string("{}\t| ") + format_string).c_str(),
-                Log::Level::Debug,
-                args...);
-}
+    static void setLevel(const Level level);
 
-template <typename... Targs>
-void Log::i(const char* format_string, const Targs&... args) {
-    if constexpr (Log::level >= Log::Level::Info)
-        println((std::string("{}\t| ") + format_string).c_str(),
-                Log::Level::Info,
-                args...);
-}
+    /// @brief Parses a level name such as "info". Returns false if the name is
+    /// unknown.
+    static bool parseLevel(const char* name, Level& level);
 
-template <typename... Targs>
-void Log::w(const char* format_string, const Targs&... args) {
-    if constexpr (Log::level >= Log::Level::Warning)
-        println((std::string("{}\t| ") + format_string).c_str(),
-                Log::Level::Warning,
-                args...);
-}
+    /// @brief Blocks until every message logged before the call is written.
+    static void flush();
 
-template <typename... Targs>
-void Log::e(const char* format_string, const Targs&... args) {
-    if constexpr (Log::level >= Log::Level::Error)
-        eprintln((std::string("{}\t| ") + format_string).c_str(),
-                 Log::Level::Error,
-                 args...);
-}
+    /// @brief Number of messages dropped because a ring was full.
+    static u64 dropped();
 
-template <typename... Targs>
-void Log::f(const char* format_string, const Targs&... args) {
-    if constexpr (Log::level >= Log::Level::Fatal)
-        eprintln((std::string("{}\t| ") + format_string).c_str(),
-                 Log::Level::Fatal,
-                 args...);
-}
+private:
+    /// @brief Bytes of the ring of each logging thread.
+    static constexpr Size cRingCapacity = 1 << 16;
+
+    static bool enabled(const Level message_level);
+
+    template <typename... Targs>
+    static void write(const Level message_level,
+                      const FormatString<sizeof...(Targs)> format_string,
+                      const Targs&... args);
+
+    /// @brief Formats a record payload written by write().
+    template <typename... Targs>
+    static void decode(const u8* payload, StringBuffer& sb);
+
+    /// @brief Ring of the calling thread, or nullptr once the background
+    /// thread has stopped at exit.
+    static LogRing* ring();
+
+    static u64 nextSequence();
+
+    /// @brief Writes a formatted line on the calling thread.
+    static void writeLine(const Level message_level, StringBuffer& sb);
+
+    static std::atomic<Level> sLevel;
+};
 
 template <>
 struct FormatWriter<Log::Level> {
@@ -94,3 +113,210 @@ struct FormatWriter<Log::Level> {
         }
     }
 };
+
+/// @brief Length-prefixed text in a log record.
+struct LogText {
+    static Size bytes(const std::string_view text) {
+        return sizeof(u32) + text.size();
+    }
+
+    static void encode(u8*& out, const std::string_view text) {
+        const u32 length = static_cast<u32>(text.size());
+        std::memcpy(out, &length, sizeof(u32));
+        std::memcpy(out + sizeof(u32), text.data(), length);
+        out += sizeof(u32) + length;
+    }
+
+    static std::string_view decode(const u8*& in) {
+        u32 length;
+        std::memcpy(&length, in, sizeof(u32));
+        const char* text = reinterpret_cast<const char*>(in + sizeof(u32));
+        in += sizeof(u32) + length;
+        return std::string_view(text, length);
+    }
+};
+
+/// @brief Captures a log argument on the logging thread and restores it on
+/// the background thread. Types without a specialization are formatted on
+/// the logging thread, since they may refer to state that changes before the
+/// message is written.
+template <typename T>
+struct LogArgument {
+    using Decoded = std::string_view;
+
+    explicit LogArgument(const T& value) {
+        FormatWriter<T>::write(value, mText);
+    }
+
+    Size bytes() {
+        return LogText::bytes(std::string_view(mText.str(), mText.length()));
+    }
+
+    void encode(u8*& out) {
+        LogText::encode(out, std::string_view(mText.str(), mText.length()));
+    }
+
+    static Decoded decode(const u8*& in) {
+        return LogText::decode(in);
+    }
+
+    StringBuffer mText;
+};
+
+/// @brief Numbers and enums are copied.
+template <typename T>
+    requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+struct LogArgument<T> {
+    using Decoded = T;
+
+    explicit LogArgument(const T& value) : mValue(value) {
+    }
+
+    Size bytes() {
+        return sizeof(T);
+    }
+
+    void encode(u8*& out) {
+        std::memcpy(out, &mValue, sizeof(T));
+        out += sizeof(T);
+    }
+
+    static Decoded decode(const u8*& in) {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+
+    T mValue;
+};
+
+/// @brief Strings are copied.
+template <typename T>
+    requires std::is_same_v<T, const char*> || std::is_same_v<T, char*> ||
+             std::is_same_v<T, std::string> ||
+             std::is_same_v<T, std::string_view>
+struct LogArgument<T> {
+    using Decoded = std::string_view;
+
+    explicit LogArgument(const T& value) : mText(value) {
+    }
+
+    Size bytes() {
+        return LogText::bytes(mText);
+    }
+
+    void encode(u8*& out) {
+        LogText::encode(out, mText);
+    }
+
+    static Decoded decode(const u8*& in) {
+        return LogText::decode(in);
+    }
+
+    std::string_view mText;
+};
+
+template <typename... Targs>
+void Log::d(const FormatString<sizeof...(Targs)> format_string,
+            const Targs&... args) {
+    if (enabled(Log::Level::Debug))
+        write(Log::Level::Debug, format_string, args...);
+}
+
+template <typename... Targs>
+void Log::i(const FormatString<sizeof...(Targs)> format_string,
+            const Targs&... args) {
+    if (enabled(Log::Level::Info))
+        write(Log::Level::Info, format_string, args...);
+}
+
+template <typename... Targs>
+void Log::w(const FormatString<sizeof...(Targs)> format_string,
+            const Targs&... args) {
+    if (enabled(Log::Level::Warning))
+        write(Log::Level::Warning, format_string, args...);
+}
+
+template <typename... Targs>
+void Log::e(const FormatString<sizeof...(Targs)> format_string,
+            const Targs&... args) {
+    if (enabled(Log::Level::Error))
+        write(Log::Level::Error, format_string, args...);
+}
+
+template <typename... Targs>
+void Log::f(const FormatString<sizeof...(Targs)> format_string,
+            const Targs&... args) {
+    if (enabled(Log::Level::Fatal))
+        write(Log::Level::Fatal, format_string, args...);
+}
+
+inline Log::Level Log::level() {
+    return sLevel.load(std::memory_order_relaxed);
+}
+
+inline void Log::setLevel(const Level level) {
+    sLevel.store(level, std::memory_order_relaxed);
+}
+
+inline bool Log::enabled(const Level message_level) {
+    return message_level <= level();
+}
+
+template <typename... Targs>
+void Log::write(const Level message_level,
+                const FormatString<sizeof...(Targs)> format_string,
+                const Targs&... args) {
+    LogRing* thread_ring =
+        message_level == Level::Fatal ? nullptr : ring();
+
+    if (thread_ring == nullptr) {
+        flush();
+
+        StringBuffer sb;
+        format(sb, "{}\t| ", message_level);
+        format(sb, format_string, args...);
+        writeLine(message_level, sb);
+        return;
+    }
+
+    std::tuple<LogArgument<std::decay_t<const Targs&>>...> captured(args...);
+
+    const Size bytes =
+        sizeof(format_string) +
+        std::apply([](auto&... a) { return (Size(0) + ... + a.bytes()); },
+                   captured);
+
+    LogRing::Record* record = thread_ring->reserve(bytes);
+    if (record == nullptr) {
+        thread_ring->drop();
+        return;
+    }
+
+    record->sequence = nextSequence();
+    record->level = static_cast<u32>(message_level);
+    record->decode = &decode<std::decay_t<const Targs&>...>;
+
+    u8* out = record->payload();
+    std::memcpy(out, &format_string, sizeof(format_string));
+    out += sizeof(format_string);
+    std::apply([&](auto&... a) { (a.encode(out), ...); }, captured);
+
+    thread_ring->commit();
+}
+
+template <typename... Targs>
+void Log::decode(const u8* payload, StringBuffer& sb) {
+    using Format = FormatString<sizeof...(Targs)>;
+
+    // The format string was copied into the record, which is aligned for it.
+    const Format& format_string = *reinterpret_cast<const Format*>(payload);
+    [[maybe_unused]] const u8* in = payload + sizeof(Format);
+
+    // Braced initialization decodes the arguments in order.
+    const std::tuple<typename LogArgument<Targs>::Decoded...> values{
+        LogArgument<Targs>::decode(in)...};
+    std::apply([&](const auto&... v) { format(sb, format_string, v...); },
+               values);
+}
@@ -0,0 +1,85 @@
+#include "log_ring.hpp"
+
+LogRing::LogRing(const Size capacity)
+    : mCapacity(capacity),
+      mBuffer(new u8[capacity]),
+      mPending(0),
+      mHead(0),
+      mTail(0),
+      mDropped(0),
+      mClosed(false) {
+    assertm(capacity >= sizeof(Record) && (capacity & (capacity - 1)) == 0,
+            "ring capacity must be a power of two");
+}
+
+LogRing::Record* LogRing::reserve(const Size payload_bytes) {
+    const Size bytes = (sizeof(Record) + payload_bytes + cAlignment - 1) &
+                       ~(cAlignment - 1);
+
+    const Size tail = mTail.load(std::memory_order_relaxed);
+    const Size head = mHead.load(std::memory_order_acquire);
+    const Size offset = tail & (mCapacity - 1);
+
+    // Skip to the start of the ring if the record would wrap.
+    const Size skip = mCapacity - offset < bytes ? mCapacity - offset : 0;
+    if (tail + skip + bytes - head > mCapacity)
+        return nullptr;
+
+    if (skip > 0) {
+        Record* padding = reinterpret_cast<Record*>(mBuffer.get() + offset);
+        padding->bytes = static_cast<u32>(skip);
+        padding->padding = 1;
+    }
+
+    const Size start = (tail + skip) & (mCapacity - 1);
+    Record* record = reinterpret_cast<Record*>(mBuffer.get() + start);
+    record->bytes = static_cast<u32>(bytes);
+    record->padding = 0;
+
+    mPending = skip + bytes;
+    return record;
+}
+
+void LogRing::commit() {
+    mTail.store(mTail.load(std::memory_order_relaxed) + mPending,
+                std::memory_order_release);
+    mPending = 0;
+}
+
+const LogRing::Record* LogRing::front() {
+    while (true) {
+        const Size head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire))
+            return nullptr;
+
+        const Record* record = reinterpret_cast<const Record*>(
+            mBuffer.get() + (head & (mCapacity - 1)));
+        if (!record->padding)
+            return record;
+
+        mHead.store(head + record->bytes, std::memory_order_release);
+    }
+}
+
+void LogRing::pop() {
+    const Size head = mHead.load(std::memory_order_relaxed);
+    const Record* record = reinterpret_cast<const Record*>(
+        mBuffer.get() + (head & (mCapacity - 1)));
+    mHead.store(head + record->bytes, std::memory_order_release);
+}
+
+void LogRing::drop() {
+    mDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+u64 LogRing::takeDropped() {
+    return mDropped.exchange(0, std::memory_order_relaxed);
+}
+
+void LogRing::close() {
+    mClosed.store(true, std::memory_order_release);
+}
+
+bool LogRing::isClosed() const {
+    return mClosed.load(std::memory_order_acquire);
+}
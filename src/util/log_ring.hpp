@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "common.hpp"
+#include "stringbuffer.hpp"
+
+/// @brief Bounded lock-free single-producer, single-consumer ring of
+/// variable-size log records. Records are 8-byte aligned and never wrap: a
+/// record that does not fit before the end of the ring is preceded by
+/// padding and placed at the start.
+class LogRing {
+public:
+    /// @brief Header of every record, followed by the payload.
+    struct Record {
+        /// @brief Bytes of the record, header included.
+        u32 bytes;
+
+        /// @brief Padding records only skip to the start of the ring.
+        u32 padding;
+
+        /// @brief Order of the record among the records of every ring.
+        u64 sequence;
+
+        /// @brief Log level of the message.
+        u32 level;
+
+        /// @brief Formats the payload into a buffer. Called on the consumer.
+        void (*decode)(const u8* payload, StringBuffer& sb);
+
+        u8* payload() {
+            return reinterpret_cast<u8*>(this) + sizeof(Record);
+        }
+
+        const u8* payload() const {
+            return reinterpret_cast<const u8*>(this) + sizeof(Record);
+        }
+    };
+
+    /// @param capacity Bytes of the ring. Must be a power of two.
+    explicit LogRing(const Size capacity);
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    /// @brief Reserves a record with `payload_bytes` bytes of payload and
+    /// returns its header, or nullptr if the ring is full. Only valid on the
+    /// producer, which fills the record and then calls commit().
+    Record* reserve(const Size payload_bytes);
+
+    /// @brief Publishes the record returned by the last reserve().
+    void commit();
+
+    /// @brief Oldest record, or nullptr if the ring is empty. Only valid on
+    /// the consumer.
+    const Record* front();
+
+    /// @brief Removes the record returned by front().
+    void pop();
+
+    /// @brief Counts a record the producer could not fit.
+    void drop();
+
+    /// @brief Returns and clears the number of dropped records.
+    u64 takeDropped();
+
+    /// @brief Marks the producer as gone. The consumer discards the ring
+    /// once it is empty.
+    void close();
+
+    bool isClosed() const;
+
+private:
+    static constexpr Size cAlignment = 8;
+
+    Size mCapacity;
+    std::unique_ptr<u8[]> mBuffer;
+
+    /// @brief Bytes reserved but not yet committed. Producer only.
+    Size mPending;
+
+    /// @brief Bytes consumed since creation. Written by the consumer.
+    alignas(64) std::atomic<Size> mHead;
+
+    /// @brief Bytes committed since creation. Written by the producer.
+    alignas(64) std::atomic<Size> mTail;
+
+    std::atomic<u64> mDropped;
+    std::atomic<bool> mClosed;
+};
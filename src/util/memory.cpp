@@ -0,0 +1,193 @@
+#include "memory.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <new>
+#include <string_view>
+
+#include "format.hpp"
+#include "log.hpp"
+
+namespace memory {
+
+namespace {
+
+/// @brief Stored in front of every allocation, so a release knows its size
+/// and tag.
+struct alignas(std::max_align_t) Header {
+    u64 bytes;
+    Tag tag;
+};
+
+struct Counters {
+    std::atomic<u64> liveBytes{0};
+    std::atomic<u64> peakBytes{0};
+    std::atomic<u64> allocations{0};
+    std::atomic<u64> releases{0};
+};
+
+std::array<Counters, cTagCount> gCounters;
+
+thread_local Tag tTag = Tag::General;
+
+Counters& counters(const Tag tag) {
+    return gCounters[static_cast<Size>(tag)];
+}
+
+void appendColumn(StringBuffer& sb, const std::string_view text, Size width) {
+    for (Size k = text.size(); k < width; ++k) sb.putSafe(' ');
+    sb.append(text.data(), text.size());
+}
+
+void appendFixed(StringBuffer& sb, const f64 value, const Size width) {
+    char buffer[64];
+    const std::to_chars_result result = std::to_chars(
+        buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 2);
+    appendColumn(sb, std::string_view(buffer, result.ptr - buffer), width);
+}
+
+}
+
+const char* name(const Tag tag) {
+    switch (tag) {
+    case Tag::General:
+        return "general";
+    case Tag::Advection:
+        return "advection";
+    case Tag::Extrapolation:
+        return "extrapolation";
+    case Tag::Projection:
+        return "projection";
+    case Tag::Redistancing:
+        return "redistancing";
+    case Tag::Rendering:
+        return "rendering";
+    default:
+        unreachable;
+    }
+}
+
+TagScope::TagScope(const Tag tag) : mPrevious(tTag), mActive(true) {
+    tTag = tag;
+}
+
+TagScope::~TagScope() {
+    end();
+}
+
+void TagScope::end() {
+    if (!mActive)
+        return;
+
+    tTag = mPrevious;
+    mActive = false;
+}
+
+Usage usage(const Tag tag) {
+    const Counters& c = counters(tag);
+    return Usage{c.liveBytes.load(std::memory_order_relaxed),
+                 c.peakBytes.load(std::memory_order_relaxed),
+                 c.allocations.load(std::memory_order_relaxed),
+                 c.releases.load(std::memory_order_relaxed)};
+}
+
+void* allocateBytes(const Size bytes) {
+    void* raw = ::operator new(sizeof(Header) + bytes);
+    Header* header = static_cast<Header*>(raw);
+    header->bytes = bytes;
+    header->tag = tTag;
+
+    Counters& c = counters(header->tag);
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    const u64 live =
+        c.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    u64 peak = c.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !c.peakBytes.compare_exchange_weak(
+               peak, live, std::memory_order_relaxed)) {
+    }
+
+    return header + 1;
+}
+
+void releaseBytes(void* data) {
+    if (data == nullptr)
+        return;
+
+    Header* header = static_cast<Header*>(data) - 1;
+    Counters& c = counters(header->tag);
+    c.releases.fetch_add(1, std::memory_order_relaxed);
+    c.liveBytes.fetch_sub(header->bytes, std::memory_order_relaxed);
+
+    ::operator delete(header);
+}
+
+StepTracker::StepTracker() : mSteps(0) {
+    for (Size k = 0; k < cTagCount; ++k)
+        mLast[k] = usage(static_cast<Tag>(k)).allocations;
+    mSteady.fill(0);
+    mWarned.fill(false);
+}
+
+void StepTracker::step() {
+    ++mSteps;
+
+    for (Size k = 0; k < cTagCount; ++k) {
+        const Tag tag = static_cast<Tag>(k);
+        const u64 allocations = usage(tag).allocations;
+        const u64 count = allocations - mLast[k];
+        mLast[k] = allocations;
+
+        if (mSteps == 1 || count == 0)
+            continue;
+
+        mSteady[k] += count;
+        if (!mWarned[k]) {
+            mWarned[k] = true;
+            Log::w("{} allocated {} times in step {}",
+                   name(tag),
+                   count,
+                   mSteps);
+        }
+    }
+}
+
+void StepTracker::print() const {
+    constexpr Size cWidth = 14;
+    StringBuffer sb;
+    sb.append("Memory       ", 13);
+    for (const char* heading :
+         {"live MB", "peak MB", "allocations", "per step"})
+        appendColumn(sb, heading, cWidth);
+    sb.putSafe('\n');
+
+    for (Size k = 0; k < cTagCount; ++k) {
+        const Tag tag = static_cast<Tag>(k);
+        const Usage u = usage(tag);
+
+        const std::string_view label(name(tag));
+        sb.append(label.data(), label.size());
+        for (Size c = label.size(); c < 13; ++c) sb.putSafe(' ');
+
+        appendFixed(sb, u.liveBytes * 1e-6, cWidth);
+        appendFixed(sb, u.peakBytes * 1e-6, cWidth);
+
+        StringBuffer count;
+        format(count, "{}", u.allocations);
+        appendColumn(
+            sb, std::string_view(count.str(), count.length()), cWidth);
+
+        // The first step may allocate buffers it keeps, so only later steps
+        // count towards the rate.
+        appendFixed(sb,
+                    mSteps > 1 ? static_cast<f64>(mSteady[k]) / (mSteps - 1)
+                               : 0.0,
+                    cWidth);
+        sb.putSafe('\n');
+    }
+
+    Log::flush();
+    ::print("{}", std::string_view(sb.str(), sb.length()));
+}
+
+}
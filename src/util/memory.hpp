@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+#include "common.hpp"
+
+/// @brief Tracked allocation of solver buffers.
+///
+/// Buffers are allocated through memory::allocate, which attributes each
+/// allocation to the subsystem tag of the calling thread. Subsystems set
+/// their tag with a TagScope while they build or run, so the live bytes,
+/// peak bytes and allocation counts of each subsystem can be reported.
+namespace memory {
+
+/// @brief Subsystem an allocation is attributed to.
+enum class Tag : u8 {
+    General = 0,
+    Advection,
+    Extrapolation,
+    Projection,
+    Redistancing,
+    Rendering,
+    Count
+};
+
+constexpr Size cTagCount = static_cast<Size>(Tag::Count);
+
+const char* name(const Tag tag);
+
+/// @brief Attributes the allocations of the calling thread to a tag until
+/// the scope ends. Scopes nest.
+///
+/// A subsystem tags its own construction by declaring a TagScope as its
+/// first member, so the members after it are built under the tag, and
+/// calling end() at the end of its constructor.
+class TagScope {
+public:
+    explicit TagScope(const Tag tag);
+    ~TagScope();
+
+    TagScope(const TagScope&) = delete;
+    TagScope& operator=(const TagScope&) = delete;
+
+    /// @brief Restores the previous tag before the scope ends. Later calls
+    /// do nothing.
+    void end();
+
+private:
+    Tag mPrevious;
+    bool mActive;
+};
+
+/// @brief Allocation counters of a tag.
+struct Usage {
+    u64 liveBytes;
+    u64 peakBytes;
+    u64 allocations;
+    u64 releases;
+};
+
+/// @brief Current counters of a tag.
+Usage usage(const Tag tag);
+
+/// @brief Allocates `bytes` bytes attributed to the current tag, aligned for
+/// any fundamental type.
+void* allocateBytes(const Size bytes);
+
+/// @brief Releases memory from allocateBytes(). Null is ignored.
+void releaseBytes(void* data);
+
+/// @brief Allocates `count` uninitialized values.
+template <typename T>
+T* allocate(const Size count) {
+    static_assert(std::is_trivially_default_constructible_v<T> &&
+                      std::is_trivially_destructible_v<T> &&
+                      alignof(T) <= alignof(std::max_align_t),
+                  "only plain values are tracked");
+    return static_cast<T*>(allocateBytes(count * sizeof(T)));
+}
+
+/// @brief Releases values from allocate(). Null is ignored.
+template <typename T>
+void release(T* data) {
+    releaseBytes(data);
+}
+
+/// @brief Standard allocator over memory::allocate, for containers.
+template <typename T>
+struct Allocator {
+    using value_type = T;
+
+    Allocator() = default;
+
+    template <typename U>
+    Allocator(const Allocator<U>&) {
+    }
+
+    T* allocate(const Size count) {
+        return memory::allocate<T>(count);
+    }
+
+    void deallocate(T* data, const Size) {
+        memory::release(data);
+    }
+
+    template <typename U>
+    bool operator==(const Allocator<U>&) const {
+        return true;
+    }
+};
+
+/// @brief Counts the allocations of each step of a solver loop and reports
+/// them with the usage of every tag.
+class StepTracker {
+public:
+    StepTracker();
+
+    /// @brief Ends a step. The first step may allocate buffers that are kept;
+    /// allocations in a later step are logged once per tag, since the hot
+    /// loop is expected to reuse its memory.
+    void step();
+
+    /// @brief Prints the live, peak and per-step allocations of every tag.
+    void print() const;
+
+private:
+    u32 mSteps;
+    std::array<u64, cTagCount> mLast;
+
+    /// @brief Allocations after the first step.
+    std::array<u64, cTagCount> mSteady;
+
+    std::array<bool, cTagCount> mWarned;
+};
+
+}
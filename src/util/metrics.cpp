@@ -0,0 +1,254 @@
+#include "metrics.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string_view>
+
+#include "format.hpp"
+#include "log.hpp"
+#include "memory.hpp"
+
+std::atomic<bool> Metrics::sEnabled(false);
+
+namespace {
+
+/// @brief Time spent in a stage, in total and since the last write.
+struct StageTotals {
+    i64 nanoseconds = 0;
+    u64 calls = 0;
+    i64 intervalNanoseconds = 0;
+    u64 intervalCalls = 0;
+};
+
+std::mutex gMutex;
+std::string gPath;
+i64 gInterval = 0;
+i64 gLastWrite = 0;
+
+std::map<std::string_view, StageTotals> gStages;
+Metrics::StepSample gSample;
+u64 gSteps = 0;
+u64 gIntervalSteps = 0;
+
+i64 now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// @brief Appends `value` in the shortest form that reads back exactly,
+/// with the spelling Prometheus expects for infinities and NaN.
+void appendValue(StringBuffer& sb, const f64 value) {
+    if (std::isnan(value)) {
+        sb.append("NaN", 3);
+    } else if (std::isinf(value)) {
+        sb.append(value > 0.0 ? "+Inf" : "-Inf", 4);
+    } else {
+        char buffer[64];
+        const std::to_chars_result result =
+            std::to_chars(buffer, buffer + sizeof(buffer), value);
+        sb.append(buffer, result.ptr - buffer);
+    }
+}
+
+/// @brief Appends the HELP and TYPE lines of a metric.
+void appendHeader(StringBuffer& sb,
+                  const char* name,
+                  const char* type,
+                  const char* help) {
+    format(sb, "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+/// @brief Appends a metric without labels.
+void appendMetric(StringBuffer& sb,
+                  const char* name,
+                  const char* type,
+                  const char* help,
+                  const f64 value) {
+    appendHeader(sb, name, type, help);
+    format(sb, "{} ", name);
+    appendValue(sb, value);
+    sb.putSafe('\n');
+}
+
+/// @brief Appends one sample of a metric with a single label.
+void appendLabelled(StringBuffer& sb,
+                    const char* name,
+                    const char* label,
+                    const std::string_view value,
+                    const f64 sample) {
+    format(sb, "{}{{{}=\"{}\"}} ", name, label, value);
+    appendValue(sb, sample);
+    sb.putSafe('\n');
+}
+
+/// @brief Writes every metric to a temporary file and renames it over the
+/// output, so readers never see a partial file. Call with gMutex held.
+void write(const i64 time) {
+    const f64 elapsed = (time - gLastWrite) * 1e-9;
+    const f64 steps_per_second =
+        elapsed > 0.0 ? gIntervalSteps / elapsed : 0.0;
+    gLastWrite = time;
+    gIntervalSteps = 0;
+
+    const std::string temp_path = gPath + ".tmp";
+    const int fd =
+        ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        Log::e("Failed to open metrics file {}", temp_path);
+        return;
+    }
+
+    {
+        StringBuffer sb(fd);
+        appendMetric(sb,
+                     "fluid_steps_total",
+                     "counter",
+                     "Solver steps taken.",
+                     static_cast<f64>(gSteps));
+        appendMetric(sb,
+                     "fluid_steps_per_second",
+                     "gauge",
+                     "Solver steps per second since the last export.",
+                     steps_per_second);
+
+        appendHeader(sb,
+                     "fluid_stage_milliseconds",
+                     "gauge",
+                     "Mean duration of a stage since the last export.");
+        for (const auto& [name, totals] : gStages) {
+            appendLabelled(sb,
+                           "fluid_stage_milliseconds",
+                           "stage",
+                           name,
+                           totals.intervalCalls > 0
+                               ? totals.intervalNanoseconds * 1e-6 /
+                                     totals.intervalCalls
+                               : 0.0);
+        }
+        appendHeader(sb,
+                     "fluid_stage_seconds_total",
+                     "counter",
+                     "Time spent in a stage.");
+        for (const auto& [name, totals] : gStages) {
+            appendLabelled(sb,
+                           "fluid_stage_seconds_total",
+                           "stage",
+                           name,
+                           totals.nanoseconds * 1e-9);
+        }
+        for (auto& [name, totals] : gStages) {
+            totals.intervalNanoseconds = 0;
+            totals.intervalCalls = 0;
+        }
+
+        appendMetric(sb,
+                     "fluid_cg_iterations",
+                     "gauge",
+                     "CG iterations of the last pressure solve.",
+                     static_cast<f64>(gSample.cgIterations));
+        appendMetric(sb,
+                     "fluid_cg_residual",
+                     "gauge",
+                     "Final residual infinity norm of the last pressure "
+                     "solve.",
+                     gSample.cgResidual);
+        appendMetric(sb,
+                     "fluid_cells",
+                     "gauge",
+                     "Cells in the last pressure solve.",
+                     static_cast<f64>(gSample.fluidCells));
+        appendMetric(sb,
+                     "fluid_max_velocity",
+                     "gauge",
+                     "Largest velocity component after the last step.",
+                     gSample.maxVelocity);
+        appendMetric(sb,
+                     "fluid_cfl",
+                     "gauge",
+                     "Cells travelled per timestep at the largest velocity.",
+                     gSample.cfl);
+
+        appendHeader(sb,
+                     "fluid_memory_live_bytes",
+                     "gauge",
+                     "Bytes of solver buffers in use.");
+        for (Size k = 0; k < memory::cTagCount; ++k) {
+            const memory::Tag tag = static_cast<memory::Tag>(k);
+            appendLabelled(sb,
+                           "fluid_memory_live_bytes",
+                           "subsystem",
+                           memory::name(tag),
+                           static_cast<f64>(memory::usage(tag).liveBytes));
+        }
+        appendHeader(sb,
+                     "fluid_memory_peak_bytes",
+                     "gauge",
+                     "Largest number of bytes of solver buffers in use.");
+        for (Size k = 0; k < memory::cTagCount; ++k) {
+            const memory::Tag tag = static_cast<memory::Tag>(k);
+            appendLabelled(sb,
+                           "fluid_memory_peak_bytes",
+                           "subsystem",
+                           memory::name(tag),
+                           static_cast<f64>(memory::usage(tag).peakBytes));
+        }
+    }
+
+    if (::close(fd) != 0 ||
+        std::rename(temp_path.c_str(), gPath.c_str()) != 0) {
+        Log::e("Failed to write metrics file {}", gPath);
+        std::remove(temp_path.c_str());
+    }
+}
+
+}
+
+void Metrics::start(const std::string& path, const f64 interval) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    gPath = path;
+    gInterval = static_cast<i64>(interval * 1e9);
+    gLastWrite = now();
+    sEnabled.store(true, std::memory_order_relaxed);
+}
+
+void Metrics::finish() {
+    std::lock_guard<std::mutex> lock(gMutex);
+    if (gPath.empty())
+        return;
+
+    sEnabled.store(false, std::memory_order_relaxed);
+    write(now());
+    Log::i("Wrote metrics {}", gPath);
+    gPath.clear();
+}
+
+void Metrics::stage(const char* name, const i64 nanoseconds) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    StageTotals& totals = gStages[name];
+    totals.nanoseconds += nanoseconds;
+    totals.intervalNanoseconds += nanoseconds;
+    ++totals.calls;
+    ++totals.intervalCalls;
+}
+
+void Metrics::step(const StepSample& sample) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    if (gPath.empty())
+        return;
+
+    gSample = sample;
+    ++gSteps;
+    ++gIntervalSteps;
+
+    const i64 time = now();
+    if (time - gLastWrite >= gInterval)
+        write(time);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "common.hpp"
+
+/// @brief Exports solver metrics in the Prometheus text format.
+///
+/// While the exporter runs, every PROFILE_SCOPE adds its duration to the
+/// totals of its stage and solvers publish a StepSample after each step.
+/// The metrics are written to a file at a fixed interval, replacing the
+/// previous file atomically, so it can be read by the textfile collector of
+/// the Prometheus node exporter or with `cat` while a run is unattended.
+/// While stopped, the exporter costs one relaxed atomic load per scope and
+/// step.
+class Metrics {
+public:
+    /// @brief State of the solver after a step.
+    struct StepSample {
+        /// @brief CG iterations of the last pressure solve.
+        u64 cgIterations = 0;
+
+        /// @brief Infinity norm of the CG residual the solve ended at.
+        f64 cgResidual = 0.0;
+
+        /// @brief Cells the pressure was solved for.
+        u64 fluidCells = 0;
+
+        /// @brief Largest velocity component on the grid.
+        f64 maxVelocity = 0.0;
+
+        /// @brief Cells travelled in one timestep at `maxVelocity`.
+        f64 cfl = 0.0;
+    };
+
+    /// @brief Starts exporting to `path` every `interval` seconds.
+    static void start(const std::string& path, const f64 interval);
+
+    /// @brief Writes the final metrics and stops exporting. Does nothing if
+    /// the exporter was not started.
+    static void finish();
+
+    static bool enabled() {
+        return sEnabled.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Adds `nanoseconds` spent in the stage `name`.
+    static void stage(const char* name, const i64 nanoseconds);
+
+    /// @brief Records a finished solver step, writing the file when the
+    /// interval has passed.
+    static void step(const StepSample& sample);
+
+private:
+    static std::atomic<bool> sEnabled;
+};
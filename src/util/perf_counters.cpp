@@ -0,0 +1,160 @@
+#include "perf_counters.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#include "log.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+
+std::atomic<u32> gAvailable(0);
+std::atomic<bool> gWarned(false);
+
+void warnOnce(const char* reason) {
+    if (!gWarned.exchange(true, std::memory_order_relaxed)) {
+        Log::w("Hardware counters are unavailable ({}); check "
+               "/proc/sys/kernel/perf_event_paranoid",
+               reason);
+    }
+}
+
+#ifdef __linux__
+
+constexpr u64 cConfigs[PerfCounters::Count] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+/// @brief Counter group of one thread.
+struct ThreadCounters {
+    ThreadCounters() : opened(false), leader(-1), count(0) {
+        fds.fill(-1);
+    }
+
+    ~ThreadCounters() {
+        for (const int fd : fds)
+            if (fd >= 0)
+                ::close(fd);
+    }
+
+    /// @brief Opens every counter the kernel allows into one group.
+    void open() {
+        opened = true;
+
+        int error = 0;
+        for (Index k = 0; k < PerfCounters::Count; ++k) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = cConfigs[k];
+            attr.disabled = leader < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP |
+                               PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            const int fd = static_cast<int>(
+                ::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                error = errno;
+                continue;
+            }
+
+            fds[k] = fd;
+            order[count++] = static_cast<PerfCounters::Counter>(k);
+            if (leader < 0)
+                leader = fd;
+            gAvailable.fetch_or(1u << k, std::memory_order_relaxed);
+        }
+
+        if (leader < 0) {
+            warnOnce(std::strerror(error));
+            return;
+        }
+
+        ::ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    bool read(PerfCounters::Sample& sample) {
+        if (!opened)
+            open();
+        if (leader < 0)
+            return false;
+
+        // Layout of a group read: the number of counters, the enabled and
+        // running times, then one value per counter in the order opened.
+        u64 values[3 + PerfCounters::Count];
+        const ssize_t bytes = ::read(leader, values, sizeof(values));
+        if (bytes < static_cast<ssize_t>((3 + count) * sizeof(u64)))
+            return false;
+
+        // Counters share the hardware with other groups when there are more
+        // events than registers; extrapolate to the whole enabled time.
+        const u64 enabled = values[1];
+        const u64 running = values[2];
+        const f64 scale =
+            running > 0 ? static_cast<f64>(enabled) / running : 0.0;
+
+        sample.fill(0);
+        for (Index k = 0; k < count; ++k)
+            sample[order[k]] = static_cast<u64>(values[3 + k] * scale);
+        return true;
+    }
+
+    bool opened;
+    int leader;
+    std::array<int, PerfCounters::Count> fds;
+
+    /// @brief Counters in the order they were added to the group.
+    std::array<PerfCounters::Counter, PerfCounters::Count> order;
+    Size count;
+};
+
+thread_local ThreadCounters tCounters;
+
+#endif
+
+}
+
+bool PerfCounters::read(Sample& sample) {
+#ifdef __linux__
+    return tCounters.read(sample);
+#else
+    (void)sample;
+    warnOnce("perf_event_open is Linux only");
+    return false;
+#endif
+}
+
+u32 PerfCounters::availableMask() {
+    return gAvailable.load(std::memory_order_relaxed);
+}
+
+const char* PerfCounters::name(const Counter counter) {
+    switch (counter) {
+    case Cycles:
+        return "cycles";
+    case Instructions:
+        return "instructions";
+    case CacheMisses:
+        return "cache_misses";
+    case BranchMisses:
+        return "branch_misses";
+    default:
+        unreachable;
+    }
+}
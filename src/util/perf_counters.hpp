@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+
+#include "common.hpp"
+
+/// @brief Hardware performance counters of the calling thread, read through
+/// Linux perf_event_open.
+///
+/// The counters of a thread are opened as one group on its first read, so
+/// they are always scheduled together. Only user-space events of the thread
+/// itself are counted, which keeps the counters usable at the default
+/// perf_event_paranoid level but leaves out work handed to other threads.
+/// Counters the kernel refuses, such as inside most containers and virtual
+/// machines, are reported as unavailable and the rest keep working.
+class PerfCounters {
+public:
+    enum Counter {
+        Cycles = 0,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        Count
+    };
+
+    /// @brief Counter values, scaled up when the kernel multiplexes them.
+    using Sample = std::array<u64, Count>;
+
+    /// @brief Bytes moved per cache miss, used to estimate memory traffic.
+    static constexpr u64 cCacheLineBytes = 64;
+
+    /// @brief Reads the counters of the calling thread. Returns false if no
+    /// counter could be opened; the reason is logged once per process.
+    static bool read(Sample& sample);
+
+    /// @brief Bit mask of the counters opened so far, with bit `k` set for
+    /// counter `k`.
+    static u32 availableMask();
+
+    /// @brief Short name of a counter, such as "cycles".
+    static const char* name(const Counter counter);
+};
@@ -0,0 +1,376 @@
+#include "profiler.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "format.hpp"
+#include "log.hpp"
+
+std::atomic<bool> Profiler::sEnabled(false);
+std::atomic<bool> Profiler::sCounters(false);
+
+namespace {
+
+/// @brief A finished scope.
+struct Event {
+    const char* name;
+    i64 start;
+    i64 end;
+
+    /// @brief Whether `counters` holds the hardware counts of the scope.
+    bool counted;
+    PerfCounters::Sample counters;
+};
+
+/// @brief Events of one thread. The mutex is only contended while finish()
+/// collects the events.
+struct ThreadEvents {
+    std::mutex mutex;
+    std::vector<Event> events;
+    u64 dropped = 0;
+    u32 id = 0;
+};
+
+std::mutex gMutex;
+std::vector<std::shared_ptr<ThreadEvents>> gThreads;
+std::string gTracePath;
+i64 gEpoch = 0;
+
+thread_local std::shared_ptr<ThreadEvents> tEvents;
+
+/// @brief Appends `value` with three decimals.
+void appendFixed(StringBuffer& sb, const f64 value) {
+    char buffer[64];
+    const std::to_chars_result result = std::to_chars(
+        buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 3);
+    sb.append(buffer, result.ptr - buffer);
+}
+
+/// @brief Appends `text` right-aligned in a column of `width` characters.
+void appendColumn(StringBuffer& sb, const std::string_view text, Size width) {
+    for (Size k = text.size(); k < width; ++k) sb.putSafe(' ');
+    sb.append(text.data(), text.size());
+}
+
+/// @brief Appends the available counters as the arguments of a trace event.
+void appendCounters(StringBuffer& sb, const PerfCounters::Sample& counters) {
+    const u32 mask = PerfCounters::availableMask();
+    sb.append(",\"args\":{", 9);
+    bool first = true;
+    for (Index k = 0; k < PerfCounters::Count; ++k) {
+        if ((mask & (1u << k)) == 0)
+            continue;
+        format(sb,
+               "{}\"{}\":{}",
+               first ? "" : ",",
+               PerfCounters::name(static_cast<PerfCounters::Counter>(k)),
+               counters[k]);
+        first = false;
+    }
+    sb.putSafe('}');
+}
+
+/// @brief Writes the events in the Chrome trace event format. Every scope is
+/// a complete ("X") event, with times in microseconds.
+bool writeTrace(const std::string& path,
+                const std::vector<std::shared_ptr<ThreadEvents>>& threads) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    {
+        StringBuffer sb(fd);
+        sb.append("{\"traceEvents\":[\n", 17);
+
+        bool first = true;
+        for (const std::shared_ptr<ThreadEvents>& thread : threads) {
+            if (!first)
+                sb.append(",\n", 2);
+            first = false;
+            format(sb,
+                   "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"tid\":{},\"args\":{{\"name\":\"thread {}\"}}}}",
+                   thread->id,
+                   thread->id);
+
+            for (const Event& event : thread->events) {
+                sb.append(",\n", 2);
+                format(
+                    sb, "{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":", event.name);
+                appendFixed(sb, (event.start - gEpoch) * 1e-3);
+                sb.append(",\"dur\":", 7);
+                appendFixed(sb, (event.end - event.start) * 1e-3);
+                format(sb, ",\"pid\":1,\"tid\":{}", thread->id);
+                if (event.counted)
+                    appendCounters(sb, event.counters);
+                sb.putSafe('}');
+            }
+        }
+
+        sb.append("\n],\"displayTimeUnit\":\"ms\"}\n", 27);
+    }
+
+    return ::close(fd) == 0;
+}
+
+/// @brief Appends the hardware counter totals of every counted scope, in
+/// the order of the most cycles first. Memory traffic is estimated as one
+/// cache line per cache miss.
+void appendCounterSummary(
+    StringBuffer& sb,
+    const std::vector<std::shared_ptr<ThreadEvents>>& threads,
+    const Size name_width) {
+    std::map<std::string_view, PerfCounters::Sample> totals;
+    for (const std::shared_ptr<ThreadEvents>& thread : threads) {
+        for (const Event& event : thread->events) {
+            if (!event.counted)
+                continue;
+            PerfCounters::Sample& total =
+                totals.try_emplace(event.name, PerfCounters::Sample{})
+                    .first->second;
+            for (Index k = 0; k < PerfCounters::Count; ++k)
+                total[k] += event.counters[k];
+        }
+    }
+    if (totals.empty())
+        return;
+
+    std::vector<std::pair<std::string_view, PerfCounters::Sample>> rows(
+        totals.begin(), totals.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return a.second[PerfCounters::Cycles] > b.second[PerfCounters::Cycles];
+    });
+
+    const u32 mask = PerfCounters::availableMask();
+    const auto has = [&](const PerfCounters::Counter counter) {
+        return (mask & (1u << counter)) != 0;
+    };
+
+    constexpr Size cWidth = 16;
+    sb.append("\nScope", 6);
+    for (Size k = 5; k < name_width; ++k) sb.putSafe(' ');
+    for (const char* heading : {"cycles",
+                                "instructions",
+                                "IPC",
+                                "cache misses",
+                                "branch misses",
+                                "est. MB moved"})
+        appendColumn(sb, heading, cWidth);
+    sb.putSafe('\n');
+
+    StringBuffer cell;
+    const auto column = [&](const bool available, const auto value) {
+        cell.clear();
+        if (available)
+            format(cell, "{}", value);
+        else
+            cell.putSafe('-');
+        appendColumn(sb, std::string_view(cell.str(), cell.length()), cWidth);
+    };
+
+    for (const auto& [name, total] : rows) {
+        sb.append(name.data(), name.size());
+        for (Size k = name.size(); k < name_width; ++k) sb.putSafe(' ');
+
+        const u64 cycles = total[PerfCounters::Cycles];
+        const u64 instructions = total[PerfCounters::Instructions];
+        const u64 misses = total[PerfCounters::CacheMisses];
+        column(has(PerfCounters::Cycles), cycles);
+        column(has(PerfCounters::Instructions), instructions);
+
+        cell.clear();
+        if (has(PerfCounters::Cycles) && has(PerfCounters::Instructions) &&
+            cycles > 0)
+            appendFixed(cell, static_cast<f64>(instructions) / cycles);
+        else
+            cell.putSafe('-');
+        appendColumn(sb, std::string_view(cell.str(), cell.length()), cWidth);
+
+        column(has(PerfCounters::CacheMisses), misses);
+        column(has(PerfCounters::BranchMisses),
+               total[PerfCounters::BranchMisses]);
+
+        cell.clear();
+        if (has(PerfCounters::CacheMisses))
+            appendFixed(cell, misses * PerfCounters::cCacheLineBytes * 1e-6);
+        else
+            cell.putSafe('-');
+        appendColumn(sb, std::string_view(cell.str(), cell.length()), cWidth);
+        sb.putSafe('\n');
+    }
+}
+
+/// @brief Prints the duration statistics of every scope, longest total
+/// first.
+void printSummary(const std::vector<std::shared_ptr<ThreadEvents>>& threads) {
+    std::map<std::string_view, std::vector<i64>> durations;
+    for (const std::shared_ptr<ThreadEvents>& thread : threads) {
+        for (const Event& event : thread->events)
+            durations[event.name].push_back(event.end - event.start);
+    }
+
+    struct Row {
+        std::string_view name;
+        Size count;
+        f64 total;
+        f64 mean;
+        f64 p50;
+        f64 p99;
+    };
+
+    std::vector<Row> rows;
+    Size name_width = 5;
+    for (auto& [name, values] : durations) {
+        std::sort(values.begin(), values.end());
+
+        i64 total = 0;
+        for (const i64 value : values) total += value;
+
+        const auto percentile = [&](const f64 p) {
+            const Index k = static_cast<Index>(p * (values.size() - 1) + 0.5);
+            return values[k] * 1e-6;
+        };
+
+        rows.push_back(Row{name,
+                           values.size(),
+                           total * 1e-6,
+                           total * 1e-6 / values.size(),
+                           percentile(0.5),
+                           percentile(0.99)});
+        name_width = std::max(name_width, name.size());
+    }
+
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        return a.total > b.total;
+    });
+
+    constexpr Size cWidth = 12;
+    StringBuffer sb;
+    sb.append("Scope", 5);
+    for (Size k = 5; k < name_width; ++k) sb.putSafe(' ');
+    for (const char* heading :
+         {"count", "total ms", "mean ms", "p50 ms", "p99 ms"})
+        appendColumn(sb, heading, cWidth);
+    sb.putSafe('\n');
+
+    for (const Row& row : rows) {
+        sb.append(row.name.data(), row.name.size());
+        for (Size k = row.name.size(); k < name_width; ++k) sb.putSafe(' ');
+
+        StringBuffer cell;
+        format(cell, "{}", row.count);
+        appendColumn(sb, std::string_view(cell.str(), cell.length()), cWidth);
+
+        for (const f64 value : {row.total, row.mean, row.p50, row.p99}) {
+            cell.clear();
+            appendFixed(cell, value);
+            appendColumn(
+                sb, std::string_view(cell.str(), cell.length()), cWidth);
+        }
+        sb.putSafe('\n');
+    }
+
+    appendCounterSummary(sb, threads, name_width);
+
+    Log::flush();
+    print("{}", std::string_view(sb.str(), sb.length()));
+}
+
+}
+
+void Profiler::start(const std::string& trace_path) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    gTracePath = trace_path;
+    gEpoch = now();
+    sEnabled.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::finish() {
+    std::vector<std::shared_ptr<ThreadEvents>> threads;
+    {
+        std::lock_guard<std::mutex> lock(gMutex);
+        if (gTracePath.empty())
+            return;
+        sEnabled.store(false, std::memory_order_relaxed);
+        threads = gThreads;
+    }
+
+    // Take the events, so a second finish() finds none.
+    u64 dropped = 0;
+    std::vector<std::shared_ptr<ThreadEvents>> collected;
+    for (const std::shared_ptr<ThreadEvents>& thread : threads) {
+        std::shared_ptr<ThreadEvents> copy = std::make_shared<ThreadEvents>();
+        {
+            std::lock_guard<std::mutex> lock(thread->mutex);
+            copy->events.swap(thread->events);
+            dropped += thread->dropped;
+            thread->dropped = 0;
+        }
+        copy->id = thread->id;
+        collected.push_back(copy);
+    }
+
+    if (writeTrace(gTracePath, collected))
+        Log::i("Wrote profile trace {}", gTracePath);
+    else
+        Log::e("Failed to write profile trace {}", gTracePath);
+
+    if (dropped > 0)
+        Log::w("Dropped {} profile events", dropped);
+
+    printSummary(collected);
+}
+
+i64 Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void Profiler::enableCounters() {
+    sCounters.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::record(const char* name,
+                      const i64 start,
+                      const i64 end,
+                      const PerfCounters::Sample* counters) {
+    if (Metrics::enabled())
+        Metrics::stage(name, end - start);
+    if (!enabled())
+        return;
+
+    Event event{name, start, end, false, {}};
+    if (counters != nullptr && PerfCounters::read(event.counters)) {
+        event.counted = true;
+        // Scaled values of multiplexed counters are estimates and may step
+        // back slightly.
+        for (Index k = 0; k < PerfCounters::Count; ++k) {
+            const u64 begin = (*counters)[k];
+            event.counters[k] =
+                event.counters[k] > begin ? event.counters[k] - begin : 0;
+        }
+    }
+
+    if (!tEvents) {
+        tEvents = std::make_shared<ThreadEvents>();
+        std::lock_guard<std::mutex> lock(gMutex);
+        tEvents->id = static_cast<u32>(gThreads.size() + 1);
+        gThreads.push_back(tEvents);
+    }
+
+    std::lock_guard<std::mutex> lock(tEvents->mutex);
+    if (tEvents->events.size() < cMaxEvents)
+        tEvents->events.push_back(event);
+    else
+        ++tEvents->dropped;
+}
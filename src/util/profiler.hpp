@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "common.hpp"
+#include "metrics.hpp"
+#include "perf_counters.hpp"
+
+/// @brief Records the time spent in named scopes on every thread.
+///
+/// Scopes are marked with PROFILE_SCOPE. While the profiler is stopped a
+/// scope costs one relaxed atomic load. While it runs, each scope appends an
+/// event to a buffer of its thread. finish() writes the events as a Chrome
+/// trace, viewable in chrome://tracing or Perfetto, and prints the count,
+/// mean, median and 99th percentile duration of each scope. With hardware
+/// counters enabled, each scope also records the PerfCounters of its thread.
+/// Scopes are also timed while Metrics exports, which totals them by name.
+class Profiler {
+public:
+    /// @brief Starts recording. The trace is written to `trace_path` by
+    /// finish().
+    static void start(const std::string& trace_path);
+
+    /// @brief Stops recording, writes the trace and prints the summary. Does
+    /// nothing if the profiler was not started. Call once the instrumented
+    /// threads are idle, so no scope is cut short.
+    static void finish();
+
+    /// @brief Records hardware counters with every scope from now on. Scopes
+    /// are recorded without counters where they cannot be read.
+    static void enableCounters();
+
+    static bool enabled() {
+        return sEnabled.load(std::memory_order_relaxed);
+    }
+
+    static bool countersEnabled() {
+        return sCounters.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Nanoseconds on a monotonic clock.
+    static i64 now();
+
+    /// @brief Records a scope of the calling thread and adds it to the
+    /// metrics. `name` must outlive the profiler, such as a string literal.
+    /// `counters` holds the hardware counters at the start of the scope, or
+    /// is null if they were not read.
+    static void record(const char* name,
+                       const i64 start,
+                       const i64 end,
+                       const PerfCounters::Sample* counters);
+
+private:
+    /// @brief Events kept per thread. Later events are counted but dropped.
+    static constexpr Size cMaxEvents = 1 << 20;
+
+    static std::atomic<bool> sEnabled;
+    static std::atomic<bool> sCounters;
+};
+
+/// @brief Records the lifetime of a scope with the profiler.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : mName(name), mStart(-1), mCounted(false) {
+        if (Profiler::enabled() || Metrics::enabled()) {
+            mCounted = Profiler::enabled() && Profiler::countersEnabled() &&
+                       PerfCounters::read(mCounters);
+            mStart = Profiler::now();
+        }
+    }
+
+    ~ProfileScope() {
+        if (mStart >= 0)
+            Profiler::record(mName,
+                             mStart,
+                             Profiler::now(),
+                             mCounted ? &mCounters : nullptr);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* mName;
+    i64 mStart;
+    bool mCounted;
+    PerfCounters::Sample mCounters;
+};
+
+#define PROFILE_CONCAT_INNER(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_INNER(A, B)
+
+/// @brief Profiles the rest of the enclosing scope under `name`.
+#define PROFILE_SCOPE(name) \
+    const ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "common.hpp"
+
+/// @brief Bounded lock-free single-producer, single-consumer queue backed by
+/// a ring buffer. One slot is kept free to tell a full ring from an empty
+/// one, so the queue holds at most `Capacity - 1` values.
+template <typename T, Size Capacity>
+class SpscQueue {
+public:
+    static_assert(Capacity >= 2, "capacity must be at least 2");
+
+    SpscQueue();
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /// @brief Appends a value. Returns false if the queue is full. Only valid
+    /// on the producer.
+    bool push(const T& value);
+
+    /// @brief Removes the oldest value into `value`. Returns false if the
+    /// queue is empty. Only valid on the consumer.
+    bool pop(T& value);
+
+private:
+    std::array<T, Capacity> mSlots;
+
+    /// @brief Next slot to read. Written by the consumer.
+    alignas(64) std::atomic<Size> mHead;
+
+    /// @brief Next slot to write. Written by the producer.
+    alignas(64) std::atomic<Size> mTail;
+};
+
+template <typename T, Size Capacity>
+SpscQueue<T, Capacity>::SpscQueue() : mSlots(), mHead(0), mTail(0) {
+}
+
+template <typename T, Size Capacity>
+bool SpscQueue<T, Capacity>::push(const T& value) {
+    const Size tail = mTail.load(std::memory_order_relaxed);
+    const Size next = (tail + 1) % Capacity;
+    if (next == mHead.load(std::memory_order_acquire))
+        return false;
+
+    mSlots[tail] = value;
+    mTail.store(next, std::memory_order_release);
+    return true;
+}
+
+template <typename T, Size Capacity>
+bool SpscQueue<T, Capacity>::pop(T& value) {
+    const Size head = mHead.load(std::memory_order_relaxed);
+    if (head == mTail.load(std::memory_order_acquire))
+        return false;
+
+    value = mSlots[head];
+    mHead.store((head + 1) % Capacity, std::memory_order_release);
+    return true;
+}
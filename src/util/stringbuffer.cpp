@@ -1,12 +1,27 @@
 #include "stringbuffer.hpp"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
 StringBuffer::StringBuffer()
     : mCapacity(INITIAL_CAPACITY),
       mNext(0),
-      mBuffer(new char[INITIAL_CAPACITY]) {
+      mBuffer(new char[INITIAL_CAPACITY]),
+      mSink(-1) {
+}
+
+StringBuffer::StringBuffer(const int fd)
+    : mCapacity(INITIAL_CAPACITY),
+      mNext(0),
+      mBuffer(new char[INITIAL_CAPACITY]),
+      mSink(fd) {
 }
 
 StringBuffer::~StringBuffer() {
+    flush();
     delete[] mBuffer;
 }
 
@@ -18,6 +33,10 @@ Size StringBuffer::length() {
     return mNext;
 }
 
+void StringBuffer::clear() {
+    mNext = 0;
+}
+
 const char* StringBuffer::str() {
     expand(mNext + 1);
     mBuffer[mNext] = '\0';
@@ -50,12 +69,39 @@ void StringBuffer::append(const std::string& str) {
     mNext += str.size();
 }
 
+void StringBuffer::flush() {
+    if (mSink < 0)
+        return;
+
+    Index written = 0;
+    while (written < mNext) {
+        const ssize_t count = ::write(mSink, mBuffer + written, mNext - written);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+            break;
+        written += count;
+    }
+    mNext = 0;
+}
+
 void StringBuffer::expand(const Size size) {
-    if (size > mCapacity) {
-        mCapacity += (size / CAPACITY_INCREMENT + 1) * CAPACITY_INCREMENT;
-        char* new_buffer = new char[mCapacity];
-        std::memcpy(new_buffer, mBuffer, sizeof(char) * mNext);
-        delete[] mBuffer;
-        mBuffer = new_buffer;
+    if (size <= mCapacity)
+        return;
+
+    // A full sink buffer is written out rather than grown.
+    Size required = size;
+    if (mSink >= 0 && size > SINK_CAPACITY && mNext > 0) {
+        required -= mNext;
+        flush();
+        if (required <= mCapacity)
+            return;
     }
+
+    // Grow geometrically, so appending is amortized constant time.
+    mCapacity = std::max(required, 2 * mCapacity);
+    char* new_buffer = new char[mCapacity];
+    std::memcpy(new_buffer, mBuffer, sizeof(char) * mNext);
+    delete[] mBuffer;
+    mBuffer = new_buffer;
 }
@@ -1,11 +1,22 @@
 #pragma once
 
 #include "common.hpp"
+#include "format_string.hpp"
 
 // TODO: Wide characters.
 class StringBuffer {
 public:
     StringBuffer();
+
+    /// @brief Buffer that streams to the file descriptor `fd`. Once it holds
+    /// SINK_CAPACITY characters it writes them out instead of growing, so
+    /// large outputs are written in chunks without being held in memory.
+    /// The rest is written by flush() or on destruction.
+    explicit StringBuffer(const int fd);
+
+    StringBuffer(const StringBuffer&) = delete;
+    StringBuffer& operator=(const StringBuffer&) = delete;
+
     ~StringBuffer();
 
     const char* str();
@@ -14,13 +25,21 @@ public:
     Size length();
     bool isEmpty();
 
+    /// @brief Empties the buffer, keeping its capacity.
+    void clear();
+
     void put(const char c);
     void putSafe(const char c);
     void append(const char* str, const Size length);
     void append(const std::string& str);
 
+    /// @brief Writes the contents to the sink and empties the buffer. Does
+    /// nothing without a sink.
+    void flush();
+
     template <typename... Targs>
-    void appendFormat(const char* format_string, Targs... args) {
+    void appendFormat(const FormatString<sizeof...(Targs)> format_string,
+                      Targs... args) {
         format(*this, format_string, args...);
     }
 
@@ -31,6 +50,9 @@ private:
     Index mNext;
     char* mBuffer;
 
+    /// @brief File descriptor of the sink, or -1.
+    int mSink;
+
     static constexpr Size INITIAL_CAPACITY = 200;
-    static constexpr Size CAPACITY_INCREMENT = 200;
+    static constexpr Size SINK_CAPACITY = 1 << 16;
 };
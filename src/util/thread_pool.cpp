@@ -0,0 +1,82 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(const u32 thread_count)
+    : mGeneration(0),
+      mActive(0),
+      mStop(false),
+      mTask(nullptr),
+      mContext(nullptr),
+      mCount(0),
+      mNext(0) {
+    u32 count = thread_count;
+    if (count == 0)
+        count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    mWorkers.reserve(count - 1);
+    for (u32 k = 1; k < count; ++k) mWorkers.emplace_back([this] { work(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+
+    for (std::thread& worker : mWorkers) worker.join();
+}
+
+u32 ThreadPool::size() const {
+    return static_cast<u32>(mWorkers.size()) + 1;
+}
+
+void ThreadPool::run(const u32 count, Task task, void* context) {
+    if (mWorkers.empty() || count <= 1) {
+        for (u32 k = 0; k < count; ++k) task(context, k);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = task;
+        mContext = context;
+        mCount = count;
+        mNext.store(0, std::memory_order_relaxed);
+        mActive = static_cast<u32>(mWorkers.size());
+        ++mGeneration;
+    }
+    mWake.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFinished.wait(lock, [this] { return mActive == 0; });
+}
+
+void ThreadPool::runTasks() {
+    for (u32 k = mNext.fetch_add(1, std::memory_order_relaxed); k < mCount;
+         k = mNext.fetch_add(1, std::memory_order_relaxed)) {
+        mTask(mContext, k);
+    }
+}
+
+void ThreadPool::work() {
+    u64 seen = 0;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWake.wait(lock, [&] { return mStop || mGeneration != seen; });
+        if (mStop)
+            return;
+        seen = mGeneration;
+        lock.unlock();
+
+        runTasks();
+
+        lock.lock();
+        if (--mActive == 0)
+            mFinished.notify_one();
+    }
+}
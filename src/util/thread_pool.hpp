@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common.hpp"
+
+/// @brief Fixed set of worker threads that run index-parallel loops. The
+/// calling thread takes part in every loop, so a pool of size 1 runs
+/// everything inline.
+class ThreadPool {
+public:
+    /// @brief Constructs a pool of `thread_count` threads including the
+    /// caller. A count of 0 uses the hardware concurrency.
+    explicit ThreadPool(const u32 thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief Number of threads including the caller.
+    u32 size() const;
+
+    /// @brief Calls `f(k)` for every k in [0, count) and waits for all calls
+    /// to finish. Indices are handed out dynamically, one at a time.
+    template <typename F>
+    void parallelFor(const u32 count, F&& f);
+
+private:
+    using Task = void (*)(void* context, const u32 k);
+
+    void run(const u32 count, Task task, void* context);
+    void runTasks();
+    void work();
+
+    std::vector<std::thread> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mFinished;
+
+    /// @brief Incremented for every loop so sleeping workers can tell a new
+    /// loop from a spurious wakeup.
+    u64 mGeneration;
+    u32 mActive;
+    bool mStop;
+
+    Task mTask;
+    void* mContext;
+    u32 mCount;
+    std::atomic<u32> mNext;
+};
+
+template <typename F>
+void ThreadPool::parallelFor(const u32 count, F&& f) {
+    using Fn = std::remove_reference_t<F>;
+    run(
+        count,
+        [](void* context, const u32 k) { (*static_cast<Fn*>(context))(k); },
+        const_cast<void*>(static_cast<const void*>(&f)));
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "common.hpp"
+
+/// @brief Lock-free single-producer, single-consumer triple buffer. The
+/// producer writes into a back slot and publishes it; the consumer picks up
+/// the most recently published slot. Neither side ever waits for the other,
+/// and intermediate values are dropped when the producer runs ahead.
+template <typename T>
+class TripleBuffer {
+public:
+    /// @brief Constructs the buffer with every slot a copy of `initial`.
+    explicit TripleBuffer(const T& initial);
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /// @brief Slot the producer writes into. Only valid on the producer.
+    T& back();
+
+    /// @brief Publishes the back slot and takes the old middle slot as the
+    /// new back slot.
+    void publish();
+
+    /// @brief Swaps in the latest published slot, if there is one the
+    /// consumer has not seen. Returns whether the front slot changed.
+    bool update();
+
+    /// @brief Slot the consumer reads from. Only valid on the consumer.
+    const T& front() const;
+
+private:
+    /// @brief Set on the middle index when it holds a slot that has not been
+    /// picked up by update().
+    static constexpr u8 cFresh = 0x4;
+
+    std::array<T, 3> mSlots;
+
+    /// @brief Index of the slot between producer and consumer, with the
+    /// cFresh flag.
+    std::atomic<u8> mMiddle;
+
+    /// @brief Index of the producer slot.
+    u8 mBack;
+
+    /// @brief Index of the consumer slot.
+    u8 mFront;
+};
+
+template <typename T>
+TripleBuffer<T>::TripleBuffer(const T& initial)
+    : mSlots{initial, initial, initial}, mMiddle(1), mBack(0), mFront(2) {
+}
+
+template <typename T>
+T& TripleBuffer<T>::back() {
+    return mSlots[mBack];
+}
+
+template <typename T>
+void TripleBuffer<T>::publish() {
+    const u8 previous =
+        mMiddle.exchange(mBack | cFresh, std::memory_order_acq_rel);
+    mBack = previous & ~cFresh;
+}
+
+template <typename T>
+bool TripleBuffer<T>::update() {
+    if ((mMiddle.load(std::memory_order_relaxed) & cFresh) == 0)
+        return false;
+
+    const u8 previous = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+    mFront = previous & ~cFresh;
+    return true;
+}
+
+template <typename T>
+const T& TripleBuffer<T>::front() const {
+    return mSlots[mFront];
+}